@@ -0,0 +1,727 @@
+// Filename: benchmarks.cpp
+// Description: 热路径微基准：固定语料（bench/corpus），结果以 JSON 输出到标准输出，便于跨版本对比
+// Author: awkee
+//
+// 用法: benchmarks [--corpus DIR] [--filter 子串] [--min-time-ms N] [--tags DIR]
+//   每个用例先倍增迭代次数直到单轮耗时不少于 min-time（默认 100ms），
+//   再按该次数测 5 轮，输出每次操作耗时的中位数和最小值；不访问网络
+//   bench/corpus/tags 中的标签样例先逐个校验来源和完整的 LRC 内容；
+//   --tags 指定音频目录时，标签读取基准遍历该目录（如自己的音乐库），否则使用生成的样例文件；
+//   语料目录下有 lrclib/index.tsv（bench/record_lrclib.sh 录制的真实响应）时，额外测量真实响应的打分
+///////////////////////////////////////////////////////
+
+#include "../include/lrclib.h"
+#include "../include/lyrics_timeline.h"
+#include "../include/mapped_file.h"
+#include "../include/metrics.h"
+#include "../include/trace.h"
+#include "../include/tag_reader.h"
+#include "../include/track_key.h"
+#include "../include/utils.hpp"
+#include "common.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <map>
+#include <nlohmann/json.hpp>
+#include <sstream>
+#include <unistd.h>
+
+int log_level = LOG_LEVEL_NONE;
+
+#ifndef BENCH_CORPUS_DIR
+#define BENCH_CORPUS_DIR "bench/corpus"
+#endif
+
+namespace {
+
+// 阻止编译器优化掉基准中的计算结果
+template <typename T> inline void keep(const T &value) {
+  asm volatile("" : : "r,m"(value) : "memory");
+}
+
+struct Options {
+  std::filesystem::path corpus = BENCH_CORPUS_DIR;
+  std::string filter;
+  double minTimeMs = 100;
+  std::filesystem::path tagsDir;
+};
+
+class Runner {
+public:
+  explicit Runner(const Options &options) : options_(options) {}
+
+  // op 执行一次操作；items 为每次操作处理的条目数（用于计算单条耗时）
+  void run(const std::string &name, size_t items, const std::function<void()> &op) {
+    if (!options_.filter.empty() && name.find(options_.filter) == std::string::npos) {
+      return;
+    }
+    uint64_t iterations = 1;
+    while (true) {
+      double ms = measure(op, iterations) / 1e6;
+      if (ms >= options_.minTimeMs || iterations >= (1ull << 40)) {
+        break;
+      }
+      iterations *= ms < options_.minTimeMs / 16 ? 8 : 2;
+    }
+    std::vector<double> samples;
+    for (int i = 0; i < 5; ++i) {
+      samples.push_back(measure(op, iterations) / static_cast<double>(iterations));
+    }
+    std::sort(samples.begin(), samples.end());
+    double median = samples[samples.size() / 2];
+    results_.push_back({{"name", name},
+                        {"ns_per_op", median},
+                        {"ns_min", samples.front()},
+                        {"iterations", iterations},
+                        {"items_per_op", items},
+                        {"ns_per_item", median / static_cast<double>(std::max<size_t>(1, items))}});
+    fprintf(stderr, "%-40s %12.1f ns/op\n", name.c_str(), median);
+  }
+
+  const nlohmann::ordered_json &results() const { return results_; }
+
+private:
+  static double measure(const std::function<void()> &op, uint64_t iterations) {
+    auto begin = std::chrono::steady_clock::now();
+    for (uint64_t i = 0; i < iterations; ++i) {
+      op();
+    }
+    return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - begin)
+        .count();
+  }
+
+  Options options_;
+  nlohmann::ordered_json results_ = nlohmann::ordered_json::array();
+};
+
+std::string readFile(const std::filesystem::path &path) {
+  std::ifstream file(path, std::ios::binary);
+  if (!file.is_open()) {
+    fprintf(stderr, "cannot open corpus file: %s\n", path.c_str());
+    exit(1);
+  }
+  std::stringstream buffer;
+  buffer << file.rdbuf();
+  return buffer.str();
+}
+
+// 旧版按行查找（基线）：每次刷新都切分整份歌词并线性扫描时间戳
+std::string legacyGetSyncedLine(uint64_t pos, const std::string &syncedLyrics) {
+  auto strVec = split(syncedLyrics, "\n");
+  auto len = strVec.size();
+  size_t index = 0;
+  for (size_t i = 0; i < len; i++) {
+    auto &cur = strVec[i];
+    if (cur.empty()) {
+      continue;
+    }
+    uint64_t ms = timestampToMs(cur);
+    if (pos > ms) {
+      index = i;
+    } else {
+      break;
+    }
+  }
+  if (index >= len) {
+    return "";
+  }
+  auto str = strVec[index];
+  const size_t time_len = 10;
+  if (str.size() <= time_len) {
+    return "";
+  }
+  str = str.substr(time_len, str.size());
+  return trim(str);
+}
+
+// 旧版 JSON 处理（基线）：构建完整 DOM 后取第一个结果的 syncedLyrics
+std::string legacyFirstSynced(const std::string &content) {
+  auto json = nlohmann::json::parse(content, nullptr, false);
+  if (json.is_discarded() || !json.is_array() || json.empty()) {
+    return "";
+  }
+  const auto &first = json[0];
+  if (first.contains("syncedLyrics") && first["syncedLyrics"].is_string()) {
+    return first["syncedLyrics"].get<std::string>();
+  }
+  return "";
+}
+
+// string_view 切分（split 的对照实现，不复制）
+size_t countLines(std::string_view text) {
+  size_t count = 0;
+  size_t pos = 0;
+  while (true) {
+    size_t end = text.find('\n', pos);
+    std::string_view line = text.substr(pos, end == std::string_view::npos ? end : end - pos);
+    keep(line.size());
+    ++count;
+    if (end == std::string_view::npos) {
+      return count;
+    }
+    pos = end + 1;
+  }
+}
+
+// FNV-1a 64（对照）
+uint64_t fnv1a64(std::string_view s) {
+  uint64_t hash = 0xcbf29ce484222325ull;
+  for (unsigned char c : s) {
+    hash ^= c;
+    hash *= 0x100000001b3ull;
+  }
+  return hash;
+}
+
+void appendBE32(std::string &out, uint32_t value) {
+  for (int shift = 24; shift >= 0; shift -= 8) {
+    out += static_cast<char>((value >> shift) & 0xff);
+  }
+}
+
+void appendLE32(std::string &out, uint32_t value) {
+  for (int shift = 0; shift < 32; shift += 8) {
+    out += static_cast<char>((value >> shift) & 0xff);
+  }
+}
+
+void appendSyncsafe(std::string &out, uint32_t value) {
+  for (int shift = 21; shift >= 0; shift -= 7) {
+    out += static_cast<char>((value >> shift) & 0x7f);
+  }
+}
+
+// 样例 MP3：ID3v2.4 标签中一个 UTF-8 SYLT 帧（毫秒时间戳），后接 audioBytes 字节的伪音频数据
+std::string sampleMp3(const LyricsTimeline &timeline, size_t audioBytes) {
+  std::string frame = "\x03" "eng" "\x02\x01"; // UTF-8、语言、毫秒时间戳、歌词
+  frame += '\0'; // 空描述
+  for (const auto &line : timeline.lines) {
+    frame += line.text;
+    frame += '\0';
+    appendBE32(frame, static_cast<uint32_t>(line.timeMs));
+  }
+  std::string tag = "SYLT";
+  appendSyncsafe(tag, static_cast<uint32_t>(frame.size()));
+  tag += std::string(2, '\0');
+  tag += frame;
+  std::string file = "ID3\x04";
+  file += std::string(2, '\0'); // 修订号、标志
+  appendSyncsafe(file, static_cast<uint32_t>(tag.size()));
+  return file + tag + std::string(audioBytes, '\xff');
+}
+
+// 样例 FLAC：STREAMINFO + VORBIS_COMMENT（LYRICS=LRC 文本），后接伪音频数据
+std::string sampleFlac(const std::string &lrc, size_t audioBytes) {
+  std::string comment;
+  appendLE32(comment, 5);
+  comment += "bench";
+  appendLE32(comment, 1);
+  appendLE32(comment, static_cast<uint32_t>(lrc.size() + 7));
+  comment += "LYRICS=" + lrc;
+  std::string file = "fLaC";
+  appendBE32(file, 34); // STREAMINFO：类型 0，长度 34
+  file += std::string(34, '\0');
+  appendBE32(file, 0x84000000u | static_cast<uint32_t>(comment.size())); // 最后一块，类型 4
+  return file + comment + std::string(audioBytes, '\xff');
+}
+
+// 播放记录（plays.tsv）中的一行
+struct Play {
+  std::string recording; // 实际的录音，用于判断缓存命中是否拿到了别的录音的歌词
+  std::string title;
+  std::string artist;
+  uint64_t lengthMs = 0;
+};
+
+// 按播放顺序回放缓存：key 为缓存键，checkLength 时命中还要比较时长（与 getLyrics 相同），
+// 不一致时重新查询并覆盖。统计不同键的数量、命中、查询次数和拿到别的录音歌词的命中
+nlohmann::ordered_json replayPlays(const std::vector<Play> &plays,
+                                   const std::function<std::string(const Play &)> &key,
+                                   bool checkLength, size_t &wrongHits) {
+  std::map<std::string, const Play *> cache;
+  size_t hits = 0, fetches = 0;
+  wrongHits = 0;
+  for (const auto &play : plays) {
+    auto it = cache.find(key(play));
+    if (it != cache.end() &&
+        (!checkLength || (it->second->lengthMs > play.lengthMs
+                              ? it->second->lengthMs - play.lengthMs
+                              : play.lengthMs - it->second->lengthMs) <= kTrackLengthToleranceMs)) {
+      ++hits;
+      wrongHits += it->second->recording != play.recording ? 1 : 0;
+      continue;
+    }
+    ++fetches;
+    cache[key(play)] = &play;
+  }
+  return {{"plays", plays.size()},
+          {"distinct_keys", cache.size()},
+          {"hits", hits},
+          {"fetches", fetches},
+          {"hit_rate", plays.empty() ? 0.0 : static_cast<double>(hits) / plays.size()},
+          {"wrong_hits", wrongHits}};
+}
+
+// 运行期间把 stderr 重定向到 /dev/null（日志基准会大量输出）
+class SilenceStderr {
+public:
+  SilenceStderr() {
+    fflush(stderr);
+    saved_ = dup(STDERR_FILENO);
+    int null = open("/dev/null", O_WRONLY);
+    dup2(null, STDERR_FILENO);
+    close(null);
+  }
+  ~SilenceStderr() {
+    fflush(stderr);
+    dup2(saved_, STDERR_FILENO);
+    close(saved_);
+  }
+
+private:
+  int saved_;
+};
+
+} // namespace
+
+int main(int argc, char **argv) {
+  Options options;
+  for (int i = 1; i < argc; ++i) {
+    std::string arg = argv[i];
+    if (arg == "--corpus" && i + 1 < argc) {
+      options.corpus = argv[++i];
+    } else if (arg == "--filter" && i + 1 < argc) {
+      options.filter = argv[++i];
+    } else if (arg == "--min-time-ms" && i + 1 < argc) {
+      options.minTimeMs = std::max(1.0, atof(argv[++i]));
+    } else if (arg == "--tags" && i + 1 < argc) {
+      options.tagsDir = argv[++i];
+    } else {
+      fprintf(stderr, "usage: %s [--corpus DIR] [--filter SUBSTR] [--min-time-ms N] [--tags DIR]\n",
+              argv[0]);
+      return 2;
+    }
+  }
+
+  const std::string song = readFile(options.corpus / "song.lrc");
+  const std::string longSong = readFile(options.corpus / "long.lrc");
+  const std::string getJson = readFile(options.corpus / "lrclib_get.json");
+  const std::string searchJson = readFile(options.corpus / "lrclib_search.json");
+  std::vector<std::pair<std::string, std::string>> tracks;
+  {
+    std::istringstream in(readFile(options.corpus / "tracks.tsv"));
+    std::string line;
+    while (std::getline(in, line)) {
+      size_t tab = line.find('\t');
+      if (tab != std::string::npos) {
+        tracks.emplace_back(line.substr(0, tab), line.substr(tab + 1));
+      }
+    }
+  }
+  // 规范化标题用例：先校验结果，再与 tracks.tsv 一起计入 makeTrackKey 的吞吐
+  int keyMismatches = 0;
+  {
+    std::istringstream in(readFile(options.corpus / "track_keys.tsv"));
+    std::string line;
+    while (std::getline(in, line)) {
+      auto fields = split(line, "\t");
+      if (line.starts_with("#") || fields.size() < 3) {
+        continue;
+      }
+      if (std::string title = canonicalTitle(fields[0]); title != fields[2]) {
+        fprintf(stderr, "canonicalTitle(\"%s\") = \"%s\", expected \"%s\"\n",
+                fields[0].c_str(), title.c_str(), fields[2].c_str());
+        ++keyMismatches;
+      }
+      if (std::string artist = canonicalArtist(fields[1]);
+          fields.size() > 3 && artist != fields[3]) {
+        fprintf(stderr, "canonicalArtist(\"%s\") = \"%s\", expected \"%s\"\n",
+                fields[1].c_str(), artist.c_str(), fields[3].c_str());
+        ++keyMismatches;
+      }
+      tracks.emplace_back(fields[0], fields[1]);
+    }
+  }
+  std::vector<Play> plays;
+  {
+    std::istringstream in(readFile(options.corpus / "plays.tsv"));
+    std::string line;
+    while (std::getline(in, line)) {
+      auto fields = split(line, "\t");
+      if (line.starts_with("#") || fields.size() < 4) {
+        continue;
+      }
+      plays.push_back({fields[0], fields[1], fields[2],
+                       std::strtoull(fields[3].c_str(), nullptr, 10)});
+    }
+  }
+  std::vector<std::string> timedLines;
+  for (auto &line : split(song, "\n")) {
+    if (line.size() > 1 && std::isdigit(static_cast<unsigned char>(line[1]))) {
+      timedLines.push_back(line);
+    }
+  }
+  auto timeline = parseLrc(song);
+  // 查询位置：覆盖整首歌（含第一行之前和最后一行之后）
+  std::vector<uint64_t> positions;
+  for (uint64_t ms = 0; ms < 250000; ms += 250000 / 64) {
+    positions.push_back(ms);
+  }
+
+  Runner runner(options);
+
+  // 时间标签解析
+  runner.run("timestamp.timestampToMs", timedLines.size(), [&]() {
+    for (const auto &line : timedLines) {
+      keep(timestampToMs(line));
+    }
+  });
+  runner.run("timestamp.parseLrcTimeTag", timedLines.size(), [&]() {
+    for (const auto &line : timedLines) {
+      uint64_t ms = 0;
+      keep(parseLrcTimeTag(std::string_view(line).substr(1, line.find(']') - 1), ms));
+      keep(ms);
+    }
+  });
+
+  // 当前行查找：旧版逐次切分扫描 vs 预解析时间轴二分查找
+  runner.run("lookup.getSyncedLine_legacy", positions.size(), [&]() {
+    for (uint64_t pos : positions) {
+      keep(legacyGetSyncedLine(pos, song));
+    }
+  });
+  runner.run("lookup.timeline_indexAt", positions.size(), [&]() {
+    for (uint64_t pos : positions) {
+      keep(timeline->indexAt(pos));
+    }
+  });
+
+  // LRC 解析
+  runner.run("lrc.parseLrc_song", 1, [&]() { keep(parseLrc(song)); });
+  runner.run("lrc.parseLrc_long", 1, [&]() { keep(parseLrc(longSong)); });
+  runner.run("lrc.parseLrc_song_truncate30", 1, [&]() { keep(parseLrc(song, 30)); });
+
+  // 真实格式的 LRC 样例（bench/corpus/lrc/index.tsv）：先校验解析结果，再测量解析耗时
+  int lrcMismatches = 0;
+  std::vector<std::string> realLrc;
+  {
+    std::istringstream in(readFile(options.corpus / "lrc" / "index.tsv"));
+    std::string row;
+    while (std::getline(in, row)) {
+      auto fields = split(row, "\t");
+      if (row.starts_with("#") || fields.size() < 9) {
+        continue;
+      }
+      realLrc.push_back(readFile(options.corpus / "lrc" / fields[0]));
+      auto parsed = parseLrc(realLrc.back());
+      size_t words = 0, translations = 0, romanizations = 0;
+      for (const auto &parsedLine : parsed->lines) {
+        words += parsedLine.words.size();
+        translations += parsedLine.translation.empty() ? 0 : 1;
+        romanizations += parsedLine.romanization.empty() ? 0 : 1;
+      }
+      std::vector<int64_t> actual = {
+          static_cast<int64_t>(parsed->lines.size()),
+          parsed->lines.empty() ? -1 : static_cast<int64_t>(parsed->lines.front().timeMs),
+          parsed->lines.empty() ? -1 : static_cast<int64_t>(parsed->lines.back().timeMs),
+          parsed->offsetMs,
+          static_cast<int64_t>(parsed->lengthMs),
+          static_cast<int64_t>(words),
+          static_cast<int64_t>(translations),
+          static_cast<int64_t>(romanizations)};
+      static const char *names[] = {"lines",  "first_ms", "last_ms",      "offset_ms",
+                                    "length_ms", "words", "translations", "romanizations"};
+      for (size_t i = 0; i < actual.size(); ++i) {
+        if (int64_t expected = std::strtoll(fields[i + 1].c_str(), nullptr, 10);
+            actual[i] != expected) {
+          fprintf(stderr, "parseLrc(%s).%s = %lld, expected %lld\n", fields[0].c_str(),
+                  names[i], static_cast<long long>(actual[i]),
+                  static_cast<long long>(expected));
+          ++lrcMismatches;
+        }
+      }
+    }
+  }
+  runner.run("lrc.parseLrc_realworld", realLrc.size(), [&]() {
+    for (const auto &lrc : realLrc) {
+      keep(parseLrc(lrc));
+    }
+  });
+
+  // format 渲染（与刷新线程相同的字段）
+  const auto &line = timeline->lines[timeline->indexAt(60000)];
+  runner.run("format.renderFormat", 1, [&]() {
+    size_t offset = 0;
+    keep(renderFormat("{player}/{title} {lyrics}", // 默认 format
+                      {{"title", "Paper Ocean"},
+                       {"artist", "Bench Artist"},
+                       {"album", "Bench Corpus"},
+                       {"status", "playing"},
+                       {"elapsed", "01:00"},
+                       {"duration", "04:05"},
+                       {"player", "mpv"},
+                       {"lyrics", line.displayText()},
+                       {"lyrics_tr", line.displayTranslation()},
+                       {"lyrics_roma", line.displayRomanization()}},
+                      "lyrics", &offset));
+  });
+
+  // 切分
+  runner.run("split.string_copy", 1, [&]() { keep(split(song, "\n")); });
+  runner.run("split.string_view", 1, [&]() { keep(countLines(song)); });
+
+  // 哈希与歌曲键
+  std::vector<std::string> keyStrings;
+  std::vector<TrackKey> keys;
+  for (const auto &[title, artist] : tracks) {
+    keys.push_back(makeTrackKey(title, artist));
+    keyStrings.push_back(keys.back().str());
+  }
+  runner.run("hash.hash_fnv32", keyStrings.size(), [&]() {
+    for (const auto &key : keyStrings) {
+      keep(hash_fnv(key));
+    }
+  });
+  runner.run("hash.fnv1a64", keyStrings.size(), [&]() {
+    for (const auto &key : keyStrings) {
+      keep(fnv1a64(key));
+    }
+  });
+  runner.run("hash.std_hash", keyStrings.size(), [&]() {
+    for (const auto &key : keyStrings) {
+      keep(std::hash<std::string>{}(key));
+    }
+  });
+  runner.run("key.makeTrackKey", tracks.size(), [&]() {
+    for (const auto &[title, artist] : tracks) {
+      keep(makeTrackKey(title, artist));
+    }
+  });
+
+  // 播放记录回放：旧版缓存键（原始 "标题 艺术家"）、规范化键、规范化键 + 时长校验
+  nlohmann::ordered_json keyReplay;
+  size_t legacyWrong = 0, keyWrong = 0, lengthWrong = 0;
+  keyReplay["legacy"] = replayPlays(
+      plays,
+      [](const Play &play) {
+        std::string query = play.title + " " + play.artist;
+        return trim(query);
+      },
+      false, legacyWrong);
+  keyReplay["track_key"] = replayPlays(
+      plays, [](const Play &play) { return makeTrackKey(play.title, play.artist).str(); }, false,
+      keyWrong);
+  keyReplay["track_key_length"] = replayPlays(
+      plays, [](const Play &play) { return makeTrackKey(play.title, play.artist).str(); }, true,
+      lengthWrong);
+  for (const auto &[name, stats] : keyReplay.items()) {
+    fprintf(stderr, "%-40s %zu keys, %zu fetches, %zu wrong hits\n", ("plays." + name).c_str(),
+            stats["distinct_keys"].get<size_t>(), stats["fetches"].get<size_t>(),
+            stats["wrong_hits"].get<size_t>());
+  }
+  runner.run("key.replayPlays", plays.size(), [&]() {
+    size_t wrong = 0;
+    keep(replayPlays(
+        plays, [](const Play &play) { return makeTrackKey(play.title, play.artist).str(); }, true,
+        wrong));
+  });
+
+  // 缓存查找：与 getLyrics 相同的路径（键 → 哈希路径 → exists → 映射读取）
+  // 偶数下标的歌曲写入缓存（命中），奇数下标不写入（未命中，额外检查旧版文件名）
+  char cacheTemplate[] = "/tmp/waylyrics-bench-XXXXXX";
+  if (!mkdtemp(cacheTemplate)) {
+    perror("mkdtemp");
+    return 1;
+  }
+  std::filesystem::path cacheDir = cacheTemplate;
+  for (size_t i = 0; i < keys.size(); i += 2) {
+    auto path = cacheDir / "lyrics" / keys[i].cachePath();
+    std::filesystem::create_directories(path.parent_path());
+    std::ofstream(path) << song;
+  }
+  auto lookup = [&](size_t i) {
+    auto key = makeTrackKey(tracks[i].first, tracks[i].second);
+    auto path = cacheDir / "lyrics" / key.cachePath();
+    if (std::filesystem::exists(path)) {
+      MappedFile file(path.string());
+      return std::string(file.view());
+    }
+    keep(std::filesystem::exists(cacheDir / (replace_space(tracks[i].first) + ".txt")));
+    return std::string();
+  };
+  runner.run("cache.lookup_hit", (tracks.size() + 1) / 2, [&]() {
+    for (size_t i = 0; i < tracks.size(); i += 2) {
+      keep(lookup(i));
+    }
+  });
+  runner.run("cache.lookup_miss", tracks.size() / 2, [&]() {
+    for (size_t i = 1; i < tracks.size(); i += 2) {
+      keep(lookup(i));
+    }
+  });
+
+  // 标签读取样例（bench/corpus/tags/index.tsv）：逐个校验来源和完整的 LRC 内容
+  int tagMismatches = 0;
+  std::vector<std::string> tagFixtures;
+  {
+    std::istringstream in(readFile(options.corpus / "tags" / "index.tsv"));
+    std::string line;
+    while (std::getline(in, line)) {
+      auto fields = split(line, "\t");
+      if (line.starts_with("#") || fields.size() < 3) {
+        continue;
+      }
+      std::string data = readFile(options.corpus / "tags" / fields[0]);
+      std::string source = fields[1] == "-" ? "" : fields[1];
+      std::string expected =
+          fields[2] == "-" ? "" : readFile(options.corpus / "tags" / fields[2]);
+      auto result = readEmbeddedLyrics(data);
+      if (result.source != source || result.lrc != expected) {
+        fprintf(stderr, "readEmbeddedLyrics(%s) = %s \"%s\", expected %s \"%s\"\n",
+                fields[0].c_str(), result.source.c_str(), result.lrc.c_str(),
+                source.c_str(), expected.c_str());
+        ++tagMismatches;
+      }
+      tagFixtures.push_back(std::move(data));
+    }
+  }
+  runner.run("tags.readEmbeddedLyrics_fixtures", tagFixtures.size(), [&]() {
+    for (const auto &data : tagFixtures) {
+      keep(readEmbeddedLyrics(data));
+    }
+  });
+
+  // 标签读取：遍历目录中的音频文件（只映射并解析标签区域，伪音频数据不应影响耗时）
+  std::filesystem::path tagsDir = options.tagsDir;
+  if (tagsDir.empty()) {
+    tagsDir = cacheDir / "tags";
+    std::filesystem::create_directories(tagsDir);
+    for (int i = 0; i < 8; ++i) {
+      std::ofstream(tagsDir / ("sample" + std::to_string(i) + ".mp3"), std::ios::binary)
+          << sampleMp3(*timeline, 4 << 20);
+      std::ofstream(tagsDir / ("sample" + std::to_string(i) + ".flac"), std::ios::binary)
+          << sampleFlac(song, 4 << 20);
+    }
+  }
+  std::vector<std::string> audioFiles;
+  for (const auto &entry : std::filesystem::recursive_directory_iterator(
+           tagsDir, std::filesystem::directory_options::skip_permission_denied)) {
+    static const char *extensions[] = {".mp3", ".flac", ".ogg", ".opus", ".m4a", ".mp4"};
+    std::string extension = entry.path().extension().string();
+    std::transform(extension.begin(), extension.end(), extension.begin(),
+                   [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+    if (entry.is_regular_file() &&
+        std::find(std::begin(extensions), std::end(extensions), extension) != std::end(extensions)) {
+      audioFiles.push_back(entry.path().string());
+    }
+  }
+  size_t tagHits = 0;
+  for (const auto &path : audioFiles) {
+    tagHits += readEmbeddedLyricsFile(path).source.empty() ? 0 : 1;
+  }
+  if (!audioFiles.empty()) {
+    runner.run("tags.readEmbeddedLyricsFile_dir", audioFiles.size(), [&]() {
+      for (const auto &path : audioFiles) {
+        keep(readEmbeddedLyricsFile(path));
+      }
+    });
+  }
+  std::filesystem::remove_all(cacheDir);
+
+  // lrclib 响应解析：流式打分 vs 旧版 DOM
+  LrclibQuery query{"Paper Ocean", "Bench Artist", "Bench Corpus", 245000};
+  runner.run("json.extractBestLyrics_get", 1,
+             [&]() { keep(extractBestLyrics(getJson, query)); });
+  runner.run("json.extractBestLyrics_search", 1,
+             [&]() { keep(extractBestLyrics(searchJson, query)); });
+  runner.run("json.dom_first_synced_search", 1,
+             [&]() { keep(legacyFirstSynced(searchJson)); });
+
+  // 录制的真实 lrclib 响应（index.tsv：文件名、标题、艺术家、时长毫秒），仓库中的两份语料是合成的
+  std::vector<std::pair<std::string, LrclibQuery>> recorded;
+  if (std::filesystem::exists(options.corpus / "lrclib" / "index.tsv")) {
+    std::istringstream in(readFile(options.corpus / "lrclib" / "index.tsv"));
+    std::string line;
+    while (std::getline(in, line)) {
+      auto fields = split(line, "\t");
+      if (line.starts_with("#") || fields.size() < 4) {
+        continue;
+      }
+      recorded.emplace_back(readFile(options.corpus / "lrclib" / fields[0]),
+                            LrclibQuery{fields[1], fields[2], "",
+                                        std::strtoull(fields[3].c_str(), nullptr, 10)});
+    }
+  }
+  size_t recordedBytes = 0;
+  for (const auto &[json, _] : recorded) {
+    recordedBytes += json.size();
+  }
+  if (recorded.empty()) {
+    fprintf(stderr, "no recorded lrclib responses in %s: json.*_recorded skipped "
+                    "(run bench/record_lrclib.sh with network access)\n",
+            (options.corpus / "lrclib").c_str());
+  } else {
+    runner.run("json.extractBestLyrics_recorded", recorded.size(), [&]() {
+      for (const auto &[json, recordedQuery] : recorded) {
+        keep(extractBestLyrics(json, recordedQuery));
+      }
+    });
+    runner.run("json.dom_first_synced_recorded", recorded.size(), [&]() {
+      for (const auto &[json, _] : recorded) {
+        keep(legacyFirstSynced(json));
+      }
+    });
+  }
+
+  // 日志：编译期消除 / 运行期关闭 / 开启（每次 32 条并等待后台线程输出，输出到 /dev/null）
+  runner.run("log.debug_disabled", 1, [&]() { DEBUG("  >> bench %d", 1); });
+  runner.run("log.error_runtime_disabled", 1, [&]() { ERROR("  >> bench %d", 1); });
+  {
+    SilenceStderr silence;
+    log_level = LOG_LEVEL_ERROR;
+    runner.run("log.error_enabled", 32, [&]() {
+      for (int i = 0; i < 32; ++i) {
+        ERROR("  >> bench line %d: %s", i, "payload");
+      }
+      logFlush();
+    });
+    log_level = LOG_LEVEL_NONE;
+  }
+
+  // 追踪与指标
+  runner.run("trace.span_disabled", 1, [&]() { TraceSpan span("bench"); });
+  Counter &counter = metrics().counter("bench.counter");
+  Histogram &histogram = metrics().histogram("bench.histogram");
+  runner.run("metrics.counter_add", 1, [&]() { counter.add(); });
+  runner.run("metrics.histogram_observe", 1, [&]() { histogram.observe(42.0); });
+
+  nlohmann::ordered_json report = {{"suite", "waybar_cffi_lyrics"},
+                                   {"version", BUILD_VERSION},
+                                   {"build_time", BUILD_TIME},
+                                   {"log_level_compiled", LOG_LEVEL},
+                                   {"min_time_ms", options.minTimeMs},
+                                   {"track_key_mismatches", keyMismatches},
+                                   {"lrc_mismatches", lrcMismatches},
+                                   {"key_replay", keyReplay},
+                                   {"tag_fixture_mismatches", tagMismatches},
+                                   {"tag_files", audioFiles.size()},
+                                   {"tag_files_with_lyrics", tagHits},
+                                   {"lrclib_recorded_responses", recorded.size()},
+                                   {"lrclib_recorded_bytes", recordedBytes},
+                                   {"benchmarks", runner.results()}};
+  printf("%s\n", report.dump(2).c_str());
+  logShutdown();
+  // 生成的样例文件都带歌词；--tags 指定的音乐库中没有歌词的文件属于正常情况
+  bool tagsOk = !options.tagsDir.empty() || tagHits == audioFiles.size();
+  // 生产使用的规范化键 + 时长校验不允许把别的录音的歌词当作命中
+  return keyMismatches == 0 && lrcMismatches == 0 && lengthWrong == 0 && tagMismatches == 0 &&
+                 tagsOk
+             ? 0
+             : 1;
+}
@@ -0,0 +1,184 @@
+#!/usr/bin/env python3
+# Filename: generate.py
+# Description: 生成标签读取的样例文件（bench/corpus/tags），与 index.tsv 中的期望结果对应
+# Author: awkee
+#
+# 每个文件只包含标签结构和少量伪音频数据，覆盖 tag_reader 的各个分支：
+# ID3v2.2/2.3/2.4 帧头、v2.3 扩展头、整个标签/帧级反同步、ISO-8859-1/UTF-16(BOM)/UTF-16BE/UTF-8
+# 编码（含代理对）、SYLT 非毫秒时间格式回退到 USLT、Ogg 跨页数据包和多逻辑流、MP4 full box /
+# QuickTime 风格 meta 和 64 位 atom 长度。修改后重新运行本脚本并提交生成的文件：
+#   python3 bench/corpus/tags/generate.py
+import os
+import struct
+
+HERE = os.path.dirname(os.path.abspath(__file__))
+AUDIO = b"\xff\xfb\x90\x00" * 64  # 伪 MPEG 帧
+
+
+def syncsafe(n):
+    return bytes([(n >> 21) & 0x7F, (n >> 14) & 0x7F, (n >> 7) & 0x7F, n & 0x7F])
+
+
+def unsync(data):
+    out = bytearray()
+    for i, b in enumerate(data):
+        out.append(b)
+        if b == 0xFF and (i + 1 == len(data) or data[i + 1] == 0 or data[i + 1] >= 0xE0):
+            out.append(0)
+    return bytes(out)
+
+
+def id3(version, frames, flags=0, ext=b""):
+    body = ext + b"".join(frames)
+    if flags & 0x80 and version < 4:
+        body = unsync(body)
+    return b"ID3" + bytes([version, 0, flags]) + syncsafe(len(body)) + body
+
+
+def frame22(fid, data):
+    return fid + struct.pack(">I", len(data))[1:] + data
+
+
+def frame23(fid, data, flags=0):
+    return fid + struct.pack(">IH", len(data), flags) + data
+
+
+def frame24(fid, data, flags=0):
+    return fid + syncsafe(len(data)) + struct.pack(">H", flags) + data
+
+
+def sylt(encoding, lines, fmt=2, lang=b"eng"):
+    text = {0: lambda s: s.encode("latin-1") + b"\0",
+            1: lambda s: s.encode("utf-16") + b"\0\0",
+            2: lambda s: s.encode("utf-16-be") + b"\0\0",
+            3: lambda s: s.encode("utf-8") + b"\0"}[encoding]
+    data = bytes([encoding]) + lang + bytes([fmt, 1]) + text("")
+    for ms, line in lines:
+        data += text(line) + struct.pack(">I", ms)
+    return data
+
+
+def uslt(encoding, lyrics, lang=b"eng"):
+    encode = {1: lambda s: s.encode("utf-16"), 2: lambda s: s.encode("utf-16-be"),
+              3: lambda s: s.encode("utf-8")}[encoding]
+    terminator = b"\0\0" if encoding in (1, 2) else b"\0"
+    return bytes([encoding]) + lang + terminator + encode(lyrics)
+
+
+def ogg_page(serial, sequence, packets, continued=False, header_type=None):
+    """packets: [(bytes, complete)]，按 255 字节分段生成段表"""
+    table, body = bytearray(), b""
+    for data, complete in packets:
+        n = len(data)
+        table += b"\xff" * (n // 255)
+        if complete:
+            table.append(n % 255)
+        elif n % 255:
+            raise ValueError("incomplete packet must be a multiple of 255")
+        body += data
+    kind = header_type if header_type is not None else (1 if continued else 0)
+    return (b"OggS" + bytes([0, kind]) + struct.pack("<qIII", 0, serial, sequence, 0) +
+            bytes([len(table)]) + bytes(table) + body)
+
+
+def vorbis_comments(vendor, comments):
+    out = struct.pack("<I", len(vendor)) + vendor + struct.pack("<I", len(comments))
+    for c in comments:
+        out += struct.pack("<I", len(c)) + c
+    return out
+
+
+def atom(kind, payload):
+    return struct.pack(">I", 8 + len(payload)) + kind + payload
+
+
+def atom64(kind, payload):
+    return struct.pack(">I", 1) + kind + struct.pack(">Q", 16 + len(payload)) + payload
+
+
+def data_atom(text):
+    return atom(b"data", struct.pack(">II", 1, 0) + text.encode("utf-8"))
+
+
+def write(name, data):
+    with open(os.path.join(HERE, name), "wb") as f:
+        f.write(data)
+
+
+# ID3v2.2：三字符帧 ID、24 位帧长，ISO-8859-1 的 SLT
+write("id3v22_slt.mp3", id3(2, [
+    frame22(b"TT2", b"\0Caf\xe9"),
+    frame22(b"SLT", sylt(0, [(1000, "Café au lait"), (4500, "\nNaïve señor"),
+                             (83250, "Ending line ")])),
+]) + AUDIO)
+
+# ID3v2.3：扩展头（6 字节 + 4 字节长度），UTF-16 带 BOM（小端），含代理对和 CJK
+write("id3v23_ext_utf16.mp3", id3(3, [
+    frame23(b"TIT2", b"\x03Title"),
+    frame23(b"SYLT", sylt(1, [(0, "晴天 🎵"), (12340, "故事的小黄花"), (61005, "𝄞 clef")])),
+], flags=0x40, ext=struct.pack(">IHI", 6, 0, 0)) + AUDIO)
+
+# ID3v2.3：整个标签反同步（时间戳 0xFF00 和 ISO-8859-1 的 ÿ 都会产生 0xFF 0x00）
+write("id3v23_unsync.mp3", id3(3, [
+    frame23(b"SYLT", sylt(0, [(65280, "ÿ at the end ÿ"), (65535, "\xff\xfe-ish"), (130560, "done")])),
+], flags=0x80) + AUDIO)
+
+# ID3v2.4：同步安全帧长，帧级反同步 + 数据长度指示符，UTF-16BE（无 BOM）含代理对
+sylt24 = sylt(2, [(500, "Grüße 😀"), (2750, "ＦＵＬＬ ｗｉｄｔｈ"), (599990, "last")])
+write("id3v24_unsync_be.mp3", id3(4, [
+    frame24(b"TIT2", b"\x03Title"),
+    frame24(b"SYLT", syncsafe(len(sylt24)) + unsync(sylt24), flags=0x0003),
+]) + AUDIO)
+
+# ID3v2.3：SYLT 使用 MPEG 帧号（不支持）时回退到 USLT（UTF-16 大端 BOM，LRC 文本）
+write("id3v23_uslt.mp3", id3(3, [
+    frame23(b"SYLT", sylt(3, [(10, "frame based")], fmt=1)),
+    frame23(b"USLT", uslt(1, "\n[ti:Fixture]\n[00:01.50]USLT first\n[00:03.25]第二行 🎶\n")),
+]) + AUDIO)
+
+# 纯文本 USLT：没有时间标签，视为未找到
+write("id3v24_plain_uslt.mp3", id3(4, [
+    frame24(b"USLT", uslt(3, "Just words\nwithout timestamps\n")),
+]) + AUDIO)
+
+# Ogg Opus：OpusTags 跨两页（第一页段表以 255 结尾），中间夹着另一个逻辑流的页
+opus_lrc = "[00:00.80]Opus line one\n[00:02.40]" + "long " * 100 + "\n[01:05.00]Opus end\n"
+tags = b"OpusTags" + vorbis_comments(b"fixture", [b"TITLE=Opus Fixture",
+                                                  ("LYRICS=" + opus_lrc).encode()])
+split = 510
+assert len(tags) > split
+head = b"OpusHead" + bytes([1, 2]) + struct.pack("<HIhB", 312, 48000, 0, 0)
+write("opus_multipage.opus",
+      ogg_page(0x1234, 0, [(head, True)], header_type=2) +
+      ogg_page(0x9999, 0, [(b"\x01vorbis other stream", True)], header_type=2) +
+      ogg_page(0x1234, 1, [(tags[:split], False)]) +
+      ogg_page(0x9999, 1, [(b"\x03vorbis other stream comments", True)]) +
+      ogg_page(0x1234, 2, [(tags[split:], True), (b"\x00" * 40, True)], continued=True))
+
+# Ogg Vorbis：识别头一页，注释头和设置头在同一页；LYRICS 前有不带时间标签的 UNSYNCEDLYRICS
+vorbis_lrc = "[00:10.00]Vorbis line\n[00:20.5]short fraction\n"
+write("vorbis_packets.ogg",
+      ogg_page(0x42, 0, [(b"\x01vorbis" + b"\0" * 23, True)], header_type=2) +
+      ogg_page(0x42, 1, [(b"\x03vorbis" + vorbis_comments(
+          b"Xiph.Org libVorbis", [b"ARTIST=Fixture", b"UNSYNCEDLYRICS=plain text only",
+                                  ("LYRICS=" + vorbis_lrc).encode()]) + b"\x01", True),
+                         (b"\x05vorbis" + b"\0" * 30, True)]))
+
+# MP4：moov.udta.meta(full box).ilst.©lyr.data
+mp4_lrc = "[00:01.00]MP4 lyric\r\n[00:02.00]Windows line ends\r\n"
+ilst = atom(b"ilst", atom(b"\xa9nam", data_atom("MP4 Fixture")) +
+            atom(b"\xa9lyr", data_atom(mp4_lrc)))
+meta = atom(b"meta", b"\0\0\0\0" + atom(b"hdlr", b"\0" * 8 + b"mdirappl" + b"\0" * 9) + ilst)
+write("mp4_fullbox.m4a",
+      atom(b"ftyp", b"M4A \0\0\0\0M4A mp42isom") +
+      atom(b"mdat", AUDIO) +
+      atom(b"moov", atom(b"mvhd", b"\0" * 100) + atom(b"udta", meta)))
+
+# MP4：QuickTime 风格 meta（没有版本/标志）、©lyr 使用 64 位扩展长度
+qt_lrc = "[00:00.00]QuickTime style\n[00:09.99]ext size\n"
+ilst = atom(b"ilst", atom64(b"\xa9lyr", data_atom(qt_lrc)))
+meta = atom(b"meta", atom(b"hdlr", b"\0" * 8 + b"mdirappl" + b"\0" * 9) + ilst)
+write("mp4_quicktime.m4a",
+      atom(b"ftyp", b"M4A \0\0\0\0M4A ") +
+      atom(b"moov", atom(b"mvhd", b"\0" * 100) + atom(b"udta", meta)) +
+      atom(b"mdat", AUDIO))
@@ -0,0 +1,754 @@
+// Filename: harness.cpp
+// Description: 无界面端到端测试台：私有 D-Bus 会话 + 模拟 MPRIS 播放器 + 本地 lrclib 服务 + 离屏 GTK 标签
+// Author: awkee
+//
+// 在进程内运行完整的 WayLyrics + PlayerManager 流水线，按场景驱动模拟播放器，记录
+// 从播放器发出信号到标签文本更新的耗时，以及每个场景的 D-Bus 调用数和 HTTP 请求数，
+// 并从另一个连接调用导出的 org.waylyrics 服务，结果以 JSON 输出到标准输出。
+//
+// 用法: harness [--corpus DIR] [--scenario 子串] [--tracks N] [--interval 秒]
+//               [--latency-ms N] [--slow-latency-ms N] [--storm N] [--timeout-ms N]
+//               [--idle-seconds N] [--verbose]
+//   需要 dbus-daemon；GTK3 需要显示服务（CI 中可用 xvfb-run 或 broadway），没有时退出码为 77
+///////////////////////////////////////////////////////
+
+#include "../../include/metrics.h"
+#include "../../include/way_lyrics.h"
+#include "lrclib_stub.h"
+#include "mock_player.h"
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <csignal>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <gtk/gtk.h>
+#include <mutex>
+#include <nlohmann/json.hpp>
+#include <numeric>
+#include <optional>
+#include <sstream>
+#include <unistd.h>
+
+int log_level = LOG_LEVEL_NONE;
+
+#ifndef BENCH_CORPUS_DIR
+#define BENCH_CORPUS_DIR "bench/corpus"
+#endif
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+using Json = nlohmann::ordered_json;
+
+struct Options {
+  std::filesystem::path corpus = BENCH_CORPUS_DIR;
+  std::string scenario;
+  int tracks = 6;
+  int interval = 1;
+  int latencyMs = 50;
+  int slowLatencyMs = 1500;
+  int storm = 20;
+  int timeoutMs = 10000;
+  int idleSeconds = 60;
+  bool verbose = false;
+};
+
+double msSince(Clock::time_point start, Clock::time_point end) {
+  return std::chrono::duration<double, std::milli>(end - start).count();
+}
+
+// 私有会话总线：启动独立的 dbus-daemon，并让本进程后续创建的会话连接都指向它
+class PrivateBus {
+public:
+  PrivateBus() {
+    FILE *pipe = popen("dbus-daemon --session --fork --print-address=1 --print-pid=1", "r");
+    if (!pipe) {
+      throw std::runtime_error("failed to run dbus-daemon");
+    }
+    char address[512] = {0};
+    char pid[32] = {0};
+    bool ok = fgets(address, sizeof(address), pipe) && fgets(pid, sizeof(pid), pipe);
+    pclose(pipe);
+    if (!ok) {
+      throw std::runtime_error("dbus-daemon did not report its address");
+    }
+    address[strcspn(address, "\n")] = '\0';
+    pid_ = atoi(pid);
+    setenv("DBUS_SESSION_BUS_ADDRESS", address, 1);
+  }
+  ~PrivateBus() {
+    if (pid_ > 0) {
+      kill(pid_, SIGTERM);
+    }
+  }
+  PrivateBus(const PrivateBus &) = delete;
+  PrivateBus &operator=(const PrivateBus &) = delete;
+
+private:
+  pid_t pid_ = 0;
+};
+
+// 标签文本记录：GTK 线程在 notify::label 时追加，场景线程等待满足条件的文本出现
+class LabelSink {
+public:
+  void push(const char *text) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    history_.push_back({Clock::now(), text ? text : ""});
+    changed_.notify_all();
+  }
+  size_t mark() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return history_.size();
+  }
+  // 返回 since 之后第一条满足条件的文本的时间，超时返回空
+  std::optional<Clock::time_point> waitFor(size_t since,
+                                           const std::function<bool(const std::string &)> &match,
+                                           std::chrono::milliseconds timeout) {
+    auto deadline = Clock::now() + timeout;
+    std::unique_lock<std::mutex> lock(mutex_);
+    size_t next = since;
+    while (true) {
+      for (; next < history_.size(); ++next) {
+        if (match(history_[next].text)) {
+          return history_[next].time;
+        }
+      }
+      if (changed_.wait_until(lock, deadline) == std::cv_status::timeout &&
+          next == history_.size()) {
+        return std::nullopt;
+      }
+    }
+  }
+  std::string current() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return history_.empty() ? "" : history_.back().text;
+  }
+
+private:
+  struct Entry {
+    Clock::time_point time;
+    std::string text;
+  };
+  mutable std::mutex mutex_;
+  std::condition_variable changed_;
+  std::vector<Entry> history_;
+};
+
+void onLabelChanged(GObject *object, GParamSpec *, gpointer data) {
+  static_cast<LabelSink *>(data)->push(gtk_label_get_text(GTK_LABEL(object)));
+}
+
+Json summarize(std::vector<double> samples) {
+  Json result = {{"n", samples.size()}};
+  if (samples.empty()) {
+    return result;
+  }
+  std::sort(samples.begin(), samples.end());
+  auto at = [&](double q) {
+    return samples[std::min(samples.size() - 1, static_cast<size_t>(q * static_cast<double>(samples.size())))];
+  };
+  result["p50"] = at(0.5);
+  result["p90"] = at(0.9);
+  result["max"] = samples.back();
+  result["mean"] = std::accumulate(samples.begin(), samples.end(), 0.0) /
+                   static_cast<double>(samples.size());
+  return result;
+}
+
+// 场景前后的计数快照，输出差值
+class Counters {
+public:
+  Counters(const MockPlayer &player, const LrclibStub &stub) : player_(player), stub_(stub) {
+    take(before_);
+  }
+  Json delta() const {
+    Snapshot after;
+    take(after);
+    Json http = diff(after.http, before_.http);
+    uint64_t requests = 0;
+    for (const auto &[_, count] : http.items()) {
+      requests += count.get<uint64_t>();
+    }
+    return {{"dbus_calls", after.totalCalls - before_.totalCalls},
+            {"dbus_calls_by_member", diff(after.calls, before_.calls)},
+            {"http_requests", requests},
+            {"http_requests_by_endpoint", std::move(http)},
+            {"counters", diff(after.counters, before_.counters, true)}};
+  }
+
+private:
+  using CountMap = std::map<std::string, uint64_t>;
+  struct Snapshot {
+    uint64_t totalCalls = 0;
+    CountMap calls;
+    CountMap http;
+    CountMap counters;
+  };
+
+  static Json diff(const CountMap &after, const CountMap &before, bool keepZero = false) {
+    Json result = Json::object();
+    for (const auto &[name, count] : after) {
+      auto it = before.find(name);
+      uint64_t d = count - (it == before.end() ? 0 : it->second);
+      if (d || keepZero) {
+        result[name] = d;
+      }
+    }
+    return result;
+  }
+  static constexpr const char *tracked[] = {
+      "dbus.signals",       "dbus.refreshes",   "dbus.errors",     "lyrics.requests",
+      "lyrics.coalesced",   "lyrics.not_found", "lyrics.fetch_errors", "cache.hits",
+      "cache.misses",       "update.wakeups",   "update.idle_waits", "update.rendered",
+      "update.suppressed",  "service.lookups"};
+
+  void take(Snapshot &snapshot) const {
+    snapshot.totalCalls = player_.totalCalls();
+    snapshot.calls = player_.callCounts();
+    snapshot.http = stub_.requestCounts();
+    for (const char *name : tracked) {
+      snapshot.counters[name] = metrics().counter(name).value();
+    }
+  }
+
+  const MockPlayer &player_;
+  const LrclibStub &stub_;
+  Snapshot before_;
+};
+
+class Harness {
+public:
+  Harness(const Options &options, MockPlayer &player, LrclibStub &stub, LabelSink &sink,
+          std::string lyrics)
+      : options_(options), player_(player), stub_(stub), sink_(sink),
+        lyrics_(std::move(lyrics)), timeline_(parseLrc(lyrics_, maxLength)) {}
+
+  static constexpr int maxLength = 200; // 标签不截断，便于按文本判断
+
+  void run() {
+    std::vector<MockTrack> tracks;
+    for (int i = 0; i < options_.tracks; ++i) {
+      tracks.push_back(addTrack("Harness Song " + std::to_string(i + 1)));
+    }
+    scenario("cold-track-change", [&](Json &result) { trackChanges(tracks, result); });
+    scenario("warm-track-change", [&](Json &result) { trackChanges(tracks, result); });
+    scenario("lyrics-not-found", [&](Json &result) {
+      MockTrack track = makeTrack("Harness Missing Song");
+      changeTrack(track, result, false);
+    });
+    scenario("slow-server", [&](Json &result) {
+      stub_.setLatencyMs(options_.slowLatencyMs);
+      changeTrack(addTrack("Harness Slow Song"), result, true);
+      stub_.setLatencyMs(options_.latencyMs);
+    });
+    scenario("pause-resume", [&](Json &result) { pauseResume(result); });
+    scenario("paused-idle", [&](Json &result) { pausedIdle(result); });
+    scenario("seek", [&](Json &result) { seek(result); });
+    scenario("signal-storm", [&](Json &result) { storm(result); });
+    scenario("lyrics-service", [&](Json &result) { lyricsService(result); });
+    // 最后运行：连续失败可能触发熔断，影响之后的查询
+    scenario("server-errors", [&](Json &result) {
+      stub_.setFaultEvery(1);
+      changeTrack(addTrack("Harness Faulty Song"), result, false);
+      stub_.setFaultEvery(0);
+    });
+  }
+
+  const Json &results() const { return results_; }
+  int failures() const { return failures_; }
+
+private:
+  MockTrack makeTrack(const std::string &title) {
+    MockTrack track;
+    track.trackId = "/org/mpris/MediaPlayer2/Track/" + std::to_string(++trackSeq_);
+    track.title = title;
+    track.artist = "Harness Artist";
+    track.album = "Harness Album";
+    track.lengthMs = 245000;
+    return track;
+  }
+
+  MockTrack addTrack(const std::string &title) {
+    MockTrack track = makeTrack(title);
+    stub_.addTrack({track.title, track.artist, track.album, track.lengthMs, lyrics_});
+    return track;
+  }
+
+  void scenario(const std::string &name, const std::function<void(Json &)> &body) {
+    if (!options_.scenario.empty() && name.find(options_.scenario) == std::string::npos) {
+      return;
+    }
+    fprintf(stderr, "scenario %s ...\n", name.c_str());
+    Counters counters(player_, stub_);
+    timeouts_ = 0;
+    labelMs_.clear();
+    lyricsMs_.clear();
+    resolvedMs_.clear();
+    Json result = {{"name", name}};
+    auto start = Clock::now();
+    body(result);
+    result["wall_ms"] = msSince(start, Clock::now());
+    result["timeouts"] = timeouts_;
+    for (auto &[key, value] : counters.delta().items()) {
+      result[key] = value;
+    }
+    results_.push_back(std::move(result));
+  }
+
+  std::optional<double> wait(size_t since, Clock::time_point start,
+                             const std::function<bool(const std::string &)> &match,
+                             bool required = true) {
+    auto time = sink_.waitFor(since, match, std::chrono::milliseconds(options_.timeoutMs));
+    if (!time) {
+      ++timeouts_;
+      if (required) {
+        ++failures_;
+        fprintf(stderr, "  timeout, label is: [%s]\n", sink_.current().c_str());
+      }
+      return std::nullopt;
+    }
+    return msSince(start, *time);
+  }
+
+  // 换歌：label_ms 为新标题第一次出现在标签上，lyrics_ms 为第一次显示歌词行
+  void changeTrack(const MockTrack &track, Json &result, bool expectLyrics) {
+    std::string prefix = track.title + "|";
+    size_t mark = sink_.mark();
+    uint64_t resolvedBefore = resolvedCount();
+    auto start = Clock::now();
+    player_.setTrack(track);
+    auto label = wait(mark, start, [&](const std::string &text) { return text.starts_with(prefix); });
+    if (label) {
+      labelMs_.push_back(*label);
+    }
+    if (expectLyrics) {
+      auto lyrics = wait(mark, start, [&](const std::string &text) {
+        return text.starts_with(prefix) && text != prefix + "no lyrics...";
+      });
+      if (lyrics) {
+        lyricsMs_.push_back(*lyrics);
+      }
+    } else {
+      // 未找到或出错：记录查询完成（lyrics.not_found / lyrics.fetch_errors）的耗时
+      while (resolvedCount() == resolvedBefore &&
+             Clock::now() < start + std::chrono::milliseconds(options_.timeoutMs)) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(2));
+      }
+      if (resolvedCount() > resolvedBefore) {
+        resolvedMs_.push_back(msSince(start, Clock::now()));
+      } else {
+        ++timeouts_;
+      }
+    }
+    flushSamples(result);
+  }
+
+  void trackChanges(const std::vector<MockTrack> &tracks, Json &result) {
+    for (const auto &track : tracks) {
+      changeTrack(track, result, true);
+    }
+  }
+
+  void pauseResume(Json &result) {
+    std::vector<double> pauseMs, resumeMs;
+    for (int i = 0; i < 3; ++i) {
+      size_t mark = sink_.mark();
+      auto start = Clock::now();
+      player_.pause();
+      if (auto ms = wait(mark, start, [](const std::string &text) {
+            return text.starts_with("[ paused ]");
+          })) {
+        pauseMs.push_back(*ms);
+      }
+      mark = sink_.mark();
+      start = Clock::now();
+      player_.play();
+      if (auto ms = wait(mark, start, [](const std::string &text) {
+            return !text.starts_with("[ ");
+          })) {
+        resumeMs.push_back(*ms);
+      }
+    }
+    result["pause_ms"] = summarize(pauseMs);
+    result["resume_ms"] = summarize(resumeMs);
+  }
+
+  // 暂停后保持 idleSeconds 秒：刷新线程不应被任何定时器唤醒（update.wakeups 不变），
+  // 有唤醒即记为失败
+  void pausedIdle(Json &result) {
+    size_t mark = sink_.mark();
+    auto start = Clock::now();
+    player_.pause();
+    wait(mark, start, [](const std::string &text) { return text.starts_with("[ paused ]"); });
+    // 等暂停信号引起的状态刷新和标签更新全部完成后再开始计数
+    std::this_thread::sleep_for(std::chrono::milliseconds(500));
+    auto &wakeups = metrics().counter("update.wakeups");
+    auto &rendered = metrics().counter("update.rendered");
+    uint64_t wakeupsBefore = wakeups.value();
+    uint64_t renderedBefore = rendered.value();
+    size_t labelsBefore = sink_.mark();
+    std::this_thread::sleep_for(std::chrono::seconds(options_.idleSeconds));
+    uint64_t idleWakeups = wakeups.value() - wakeupsBefore;
+    result["idle_seconds"] = options_.idleSeconds;
+    result["idle_wakeups"] = idleWakeups;
+    result["idle_renders"] = rendered.value() - renderedBefore;
+    result["idle_label_updates"] = sink_.mark() - labelsBefore;
+    if (idleWakeups != 0) {
+      ++failures_;
+      fprintf(stderr, "  %llu wakeups while paused\n",
+              static_cast<unsigned long long>(idleWakeups));
+    }
+    mark = sink_.mark();
+    start = Clock::now();
+    player_.play();
+    if (auto ms = wait(mark, start, [](const std::string &text) {
+          return !text.starts_with("[ ");
+        })) {
+      result["resume_ms"] = *ms;
+    }
+  }
+
+  // 跳转：等待标签显示跳转位置附近的歌词行（模块目前不处理 Seeked，超时记为未收敛）
+  void seek(Json &result) {
+    const uint64_t target = 120000;
+    std::vector<std::string> accepted;
+    for (const auto &line : timeline_->lines) {
+      if (line.timeMs + 10000 >= target &&
+          line.timeMs <= target + static_cast<uint64_t>(options_.timeoutMs)) {
+        accepted.emplace_back(line.displayText());
+      }
+    }
+    size_t mark = sink_.mark();
+    auto start = Clock::now();
+    player_.seek(target);
+    auto ms = wait(
+        mark, start,
+        [&](const std::string &text) {
+          size_t bar = text.find('|');
+          if (bar == std::string::npos) {
+            return false;
+          }
+          return std::find(accepted.begin(), accepted.end(), text.substr(bar + 1)) !=
+                 accepted.end();
+        },
+        false);
+    result["converged"] = ms.has_value();
+    if (ms) {
+      result["seek_to_label_ms"] = *ms;
+    }
+  }
+
+  // 信号风暴：同一首歌连续发出 storm 次 Metadata 变更，等待 D-Bus 刷新处理完毕
+  void storm(Json &result) {
+    auto &refreshes = metrics().counter("dbus.refreshes");
+    uint64_t before = refreshes.value();
+    auto start = Clock::now();
+    player_.storm(options_.storm);
+    result["emit_ms"] = msSince(start, Clock::now());
+    // 刷新计数 1.5 秒不再变化视为处理完毕
+    uint64_t last = refreshes.value();
+    auto lastChange = Clock::now();
+    while (Clock::now() - lastChange < std::chrono::milliseconds(1500) &&
+           Clock::now() - start < std::chrono::milliseconds(options_.timeoutMs * 6)) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(5));
+      if (uint64_t now = refreshes.value(); now != last) {
+        last = now;
+        lastChange = Clock::now();
+      }
+    }
+    result["signals_sent"] = options_.storm;
+    result["refreshes"] = last - before;
+    result["drain_ms"] = msSince(start, lastChange);
+  }
+
+  // org.waylyrics：从另一个会话连接读取当前歌曲和时间轴，再用 Lookup 查询未播放的歌曲，
+  // 第二次 Lookup 应命中模块缓存，不再发出 HTTP 请求
+  void lyricsService(Json &result) {
+    using TimelineEntry = sdbus::Struct<uint64_t, std::string, std::string, std::string>;
+    MockTrack track = addTrack("Harness Service Song");
+    MockTrack other = addTrack("Harness Lookup Song");
+    changeTrack(track, result, true);
+    auto check = [&](bool ok, const std::string &what) {
+      if (!ok) {
+        ++failures_;
+        fprintf(stderr, "  %s\n", what.c_str());
+      }
+      return ok;
+    };
+    try {
+      auto connection = sdbus::createSessionBusConnection();
+      auto proxy = sdbus::createProxy(*connection, sdbus::ServiceName{"org.waylyrics"},
+                                      sdbus::ObjectPath{"/org/waylyrics"});
+      auto get = [&](const char *property) {
+        sdbus::Variant value;
+        proxy->callMethod("Get")
+            .onInterface("org.freedesktop.DBus.Properties")
+            .withArguments("org.waylyrics.Lyrics", property)
+            .storeResultsTo(value);
+        return value;
+      };
+      auto lookup = [&](const MockTrack &target, std::vector<double> &samples) {
+        std::string lyrics;
+        auto start = Clock::now();
+        proxy->callMethod("Lookup")
+            .onInterface("org.waylyrics.Lyrics")
+            .withTimeout(std::chrono::milliseconds(options_.timeoutMs))
+            .withArguments(target.title, target.artist,
+                           static_cast<int32_t>(target.lengthMs / 1000))
+            .storeResultsTo(lyrics);
+        samples.push_back(msSince(start, Clock::now()));
+        return lyrics;
+      };
+
+      // 与 busctl --user introspect 看到的一致：属性、信号、异步方法和时间轴的失效标注都已导出
+      std::string xml;
+      proxy->callMethod("Introspect")
+          .onInterface("org.freedesktop.DBus.Introspectable")
+          .storeResultsTo(xml);
+      for (const char *member :
+           {"<property name=\"TrackKey\"", "<property name=\"Title\"", "<property name=\"Artist\"",
+            "<property name=\"CurrentLine\"", "<property name=\"CurrentLineIndex\"",
+            "<property name=\"NextLineTime\"", "<property name=\"Timeline\"",
+            "<signal name=\"LineChanged\"", "<method name=\"Lookup\"", "\"invalidates\""}) {
+        check(xml.find(member) != std::string::npos,
+              std::string("introspection is missing ") + member);
+      }
+
+      std::string title = get("Title").get<std::string>();
+      std::string trackKey = get("TrackKey").get<std::string>();
+      std::string currentLine = get("CurrentLine").get<std::string>();
+      int32_t index = get("CurrentLineIndex").get<int32_t>();
+      int64_t nextLineTime = get("NextLineTime").get<int64_t>();
+      auto timeline = get("Timeline").get<std::vector<TimelineEntry>>();
+      result["service_title"] = title;
+      result["service_track_key_empty"] = trackKey.empty();
+      result["service_line_index"] = index;
+      result["service_next_line_ms"] = nextLineTime;
+      result["service_timeline_lines"] = timeline.size();
+      check(title == track.title, "Title is not the playing track");
+      check(!trackKey.empty(), "TrackKey is empty");
+      if (check(timeline.size() == timeline_->lines.size(), "Timeline size differs from the LRC")) {
+        bool same = true;
+        for (size_t i = 0; i < timeline.size(); ++i) {
+          same = same && std::get<1>(timeline[i]) == timeline_->lines[i].text;
+        }
+        check(same, "Timeline text differs from the LRC");
+        check(index < 0 ? currentLine.empty()
+                        : index < static_cast<int32_t>(timeline.size()) &&
+                              std::get<1>(timeline[static_cast<size_t>(index)]) == currentLine,
+              "CurrentLine is not Timeline[CurrentLineIndex]");
+      }
+
+      // 未播放的歌曲：第一次走来源链，第二次命中缓存
+      std::vector<double> coldMs, warmMs;
+      uint64_t before = stub_.totalRequests();
+      std::string cold = lookup(other, coldMs);
+      uint64_t coldRequests = stub_.totalRequests() - before;
+      before = stub_.totalRequests();
+      std::string warm = lookup(other, warmMs);
+      uint64_t warmRequests = stub_.totalRequests() - before;
+      std::string missing = lookup(makeTrack("Harness Service Missing"), coldMs);
+      result["lookup_cold_ms"] = coldMs.front();
+      result["lookup_warm_ms"] = warmMs.front();
+      result["lookup_cold_http_requests"] = coldRequests;
+      result["lookup_warm_http_requests"] = warmRequests;
+      check(!cold.empty() && parseLrc(cold, maxLength)->lines.size() == timeline_->lines.size(),
+            "Lookup did not return the stub lyrics");
+      check(warm == cold, "second Lookup returned different lyrics");
+      check(coldRequests > 0 && warmRequests == 0, "second Lookup was not served from the cache");
+      check(missing.empty(), "Lookup of an unknown song returned lyrics");
+    } catch (const sdbus::Error &e) {
+      ++failures_;
+      fprintf(stderr, "  org.waylyrics call failed: %s\n", e.getMessage().c_str());
+    }
+  }
+
+  uint64_t resolvedCount() const {
+    return metrics().counter("lyrics.not_found").value() +
+           metrics().counter("lyrics.fetch_errors").value();
+  }
+
+  void flushSamples(Json &result) {
+    result["signal_to_label_ms"] = summarize(labelMs_);
+    if (!lyricsMs_.empty()) {
+      result["signal_to_lyrics_ms"] = summarize(lyricsMs_);
+    }
+    if (!resolvedMs_.empty()) {
+      result["signal_to_resolved_ms"] = summarize(resolvedMs_);
+    }
+  }
+
+  const Options &options_;
+  MockPlayer &player_;
+  LrclibStub &stub_;
+  LabelSink &sink_;
+  std::string lyrics_;
+  std::shared_ptr<const LyricsTimeline> timeline_;
+  Json results_ = Json::array();
+  int failures_ = 0;
+  int timeouts_ = 0;
+  int trackSeq_ = 0;
+  // 当前场景的样本（每个场景开始时清空）
+  std::vector<double> labelMs_, lyricsMs_, resolvedMs_;
+};
+
+std::string readFile(const std::filesystem::path &path) {
+  std::ifstream file(path, std::ios::binary);
+  if (!file.is_open()) {
+    throw std::runtime_error("cannot open " + path.string());
+  }
+  std::stringstream buffer;
+  buffer << file.rdbuf();
+  return buffer.str();
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+  Options options;
+  for (int i = 1; i < argc; ++i) {
+    std::string arg = argv[i];
+    auto next = [&]() -> const char * { return i + 1 < argc ? argv[++i] : "0"; };
+    if (arg == "--corpus") {
+      options.corpus = next();
+    } else if (arg == "--scenario") {
+      options.scenario = next();
+    } else if (arg == "--tracks") {
+      options.tracks = std::max(2, atoi(next())); // 第二轮需要真正换歌
+    } else if (arg == "--interval") {
+      options.interval = std::max(1, atoi(next()));
+    } else if (arg == "--latency-ms") {
+      options.latencyMs = std::max(0, atoi(next()));
+    } else if (arg == "--slow-latency-ms") {
+      options.slowLatencyMs = std::max(0, atoi(next()));
+    } else if (arg == "--storm") {
+      options.storm = std::max(1, atoi(next()));
+    } else if (arg == "--timeout-ms") {
+      options.timeoutMs = std::max(100, atoi(next()));
+    } else if (arg == "--idle-seconds") {
+      options.idleSeconds = std::max(1, atoi(next()));
+    } else if (arg == "--verbose") {
+      options.verbose = true;
+    } else {
+      fprintf(stderr,
+              "usage: %s [--corpus DIR] [--scenario SUBSTR] [--tracks N] [--interval S]\n"
+              "          [--latency-ms N] [--slow-latency-ms N] [--storm N] [--timeout-ms N]\n"
+              "          [--idle-seconds N] [--verbose]\n",
+              argv[0]);
+      return 2;
+    }
+  }
+  log_level = options.verbose ? LOG_LEVEL_DEBUG : LOG_LEVEL_NONE;
+
+  // 私有总线必须在任何会话连接创建之前启动（dbus-daemon 不存在时直接退出）
+  std::unique_ptr<PrivateBus> bus;
+  try {
+    bus = std::make_unique<PrivateBus>();
+  } catch (const std::exception &e) {
+    fprintf(stderr, "harness: %s\n", e.what());
+    return 77;
+  }
+  if (!gtk_init_check(&argc, &argv)) {
+    fprintf(stderr, "harness: no display available (run under xvfb-run or GDK_BACKEND=broadway)\n");
+    return 77;
+  }
+
+  std::string lyrics = readFile(options.corpus / "song.lrc");
+  char cacheTemplate[] = "/tmp/waylyrics-harness-XXXXXX";
+  if (!mkdtemp(cacheTemplate)) {
+    perror("mkdtemp");
+    return 1;
+  }
+
+  int failures = 0;
+  Json scenarios;
+  {
+    LrclibStub stub;
+    stub.setLatencyMs(options.latencyMs);
+    MockPlayer player("harness");
+
+    // 离屏窗口中的标签：正常布局和绘制，但不显示在屏幕上
+    GtkWidget *window = gtk_offscreen_window_new();
+    GtkWidget *label = gtk_label_new("");
+    gtk_container_add(GTK_CONTAINER(window), label);
+    gtk_widget_show_all(window);
+    LabelSink sink;
+    g_signal_connect(label, "notify::label", G_CALLBACK(onLabelChanged), &sink);
+
+    ConfigParams params = {
+        .cssClass = "waylyrics-label",
+        .labelId = "waylyrics-label",
+        .destName = player.serviceName(),
+        .cacheDir = cacheTemplate,
+        .format = "{title}|{lyrics}",
+        .tooltipFormat = "",
+        .lrclibUrl = stub.baseUrl(),
+        .toggleTooltip = 0,
+        .tooltipLines = 0,
+        .updateInterval = options.interval,
+        .maxLength = Harness::maxLength,
+        .lyricsTitleMaxLength = 100,
+        .lyricsMaxDuration = 600,
+        .karaoke = 0,
+        .karaokeFps = 30,
+        .karaokeColor = "#ffcc00",
+        .marquee = 0,
+        .marqueeFps = 30,
+        .providers = "lrclib",
+        .lyricsUrl = "",
+        .lyricsDirs = "",
+        .providerDeadline = 0,
+        .providerAdaptive = 0,
+        .httpConnectTimeout = 3000,
+        .httpTimeout = 10000,
+        .httpRetries = 2,
+        .httpRateLimit = 0, // 本地服务不限流，避免限流等待计入延迟
+        .httpBreakerThreshold = 5,
+        .httpBreakerCooldown = 30,
+        .prefetch = 0,
+        .prefetchDepth = 0,
+        .prefetchLookahead = 0,
+        .prefetchConcurrency = 1,
+        .metricsInterval = 0,
+        .trace = 0,
+        .traceFile = "",
+        .traceSignal = 0,
+        .dbusRecord = "",
+        .offsetDefault = 200,
+        .offsetStep = 100,
+        .dbusService = 1,
+    };
+    auto wayLyrics = std::make_unique<WayLyrics>(params);
+    wayLyrics->start(GTK_LABEL(label));
+
+    Harness harness(options, player, stub, sink, lyrics);
+    std::thread driver([&]() {
+      harness.run();
+      g_idle_add(
+          [](gpointer) -> gboolean {
+            gtk_main_quit();
+            return FALSE;
+          },
+          nullptr);
+    });
+    gtk_main();
+    driver.join();
+    wayLyrics.reset();
+    gtk_widget_destroy(window);
+    scenarios = harness.results();
+    failures = harness.failures();
+  }
+  std::filesystem::remove_all(cacheTemplate);
+
+  Json report = {{"suite", "waybar_cffi_lyrics-e2e"},
+                 {"version", BUILD_VERSION},
+                 {"update_interval_s", options.interval},
+                 {"stub_latency_ms", options.latencyMs},
+                 {"scenarios", std::move(scenarios)}};
+  printf("%s\n", report.dump(2).c_str());
+  logShutdown();
+  return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,220 @@
+#include "lrclib_stub.h"
+#include "../../include/utils.hpp"
+#include <algorithm>
+#include <arpa/inet.h>
+#include <chrono>
+#include <netinet/in.h>
+#include <nlohmann/json.hpp>
+#include <stdexcept>
+#include <sys/socket.h>
+#include <unistd.h>
+
+namespace {
+
+std::string lower(std::string s) {
+  std::transform(s.begin(), s.end(), s.begin(),
+                 [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+  return s;
+}
+
+std::map<std::string, std::string> parseQuery(const std::string &query) {
+  std::map<std::string, std::string> params;
+  for (const auto &pair : split(query, "&")) {
+    size_t eq = pair.find('=');
+    if (eq == std::string::npos) {
+      continue;
+    }
+    std::string value = pair.substr(eq + 1);
+    std::replace(value.begin(), value.end(), '+', ' ');
+    params[pair.substr(0, eq)] = url_decode(value);
+  }
+  return params;
+}
+
+nlohmann::json trackJson(const StubTrack &track, size_t id) {
+  return {{"id", id},
+          {"name", track.title},
+          {"trackName", track.title},
+          {"artistName", track.artist},
+          {"albumName", track.album},
+          {"duration", static_cast<double>(track.durationMs) / 1000},
+          {"instrumental", false},
+          {"plainLyrics", nullptr},
+          {"syncedLyrics", track.syncedLyrics}};
+}
+
+} // namespace
+
+LrclibStub::LrclibStub() {
+  listenFd_ = ::socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+  if (listenFd_ < 0) {
+    throw std::runtime_error("lrclib stub: socket() failed");
+  }
+  int one = 1;
+  ::setsockopt(listenFd_, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+  sockaddr_in addr{};
+  addr.sin_family = AF_INET;
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  addr.sin_port = 0; // 随机端口
+  socklen_t len = sizeof(addr);
+  if (::bind(listenFd_, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) < 0 ||
+      ::listen(listenFd_, 64) < 0 ||
+      ::getsockname(listenFd_, reinterpret_cast<sockaddr *>(&addr), &len) < 0) {
+    ::close(listenFd_);
+    throw std::runtime_error("lrclib stub: bind/listen failed");
+  }
+  port_ = ntohs(addr.sin_port);
+  acceptThread_ = std::thread([this]() { acceptLoop(); });
+}
+
+LrclibStub::~LrclibStub() {
+  running_ = false;
+  ::shutdown(listenFd_, SHUT_RDWR); // 唤醒阻塞的 accept()
+  if (acceptThread_.joinable()) {
+    acceptThread_.join();
+  }
+  ::close(listenFd_);
+  // 等待进行中的连接结束（连接线程访问 this）
+  while (activeConnections_ > 0) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(5));
+  }
+}
+
+void LrclibStub::addTrack(StubTrack track) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  std::string key = lower(track.title) + '\x1f' + lower(track.artist);
+  tracks_[key] = std::move(track);
+}
+
+std::string LrclibStub::baseUrl() const {
+  return "http://127.0.0.1:" + std::to_string(port_);
+}
+
+std::map<std::string, uint64_t> LrclibStub::requestCounts() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return counts_;
+}
+
+std::vector<StubRequest> LrclibStub::requestLog() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return log_;
+}
+
+uint64_t LrclibStub::totalRequests() const {
+  uint64_t total = 0;
+  for (const auto &[_, count] : requestCounts()) {
+    total += count;
+  }
+  return total;
+}
+
+void LrclibStub::acceptLoop() {
+  while (running_) {
+    int fd = ::accept4(listenFd_, nullptr, nullptr, SOCK_CLOEXEC);
+    if (fd < 0) {
+      continue; // 关闭时 accept 返回错误，由 running_ 结束循环
+    }
+    ++activeConnections_;
+    std::thread([this, fd]() {
+      serve(fd);
+      ::close(fd);
+      --activeConnections_;
+    }).detach();
+  }
+}
+
+void LrclibStub::serve(int fd) {
+  std::string request;
+  char buffer[4096];
+  while (request.find("\r\n\r\n") == std::string::npos && request.size() < 65536) {
+    ssize_t n = ::recv(fd, buffer, sizeof(buffer), 0);
+    if (n <= 0) {
+      return;
+    }
+    request.append(buffer, static_cast<size_t>(n));
+  }
+  // 请求行：GET <path> HTTP/1.1
+  size_t first = request.find(' ');
+  size_t second = first == std::string::npos ? first : request.find(' ', first + 1);
+  if (second == std::string::npos) {
+    return;
+  }
+  std::string path = request.substr(first + 1, second - first - 1);
+
+  int status = 200;
+  std::string body = respond(path, status);
+  if (int latency = latencyMs_.load(); latency > 0) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(latency));
+  }
+  uint64_t sequence = ++sequence_;
+  if (int every = resetEvery_.load(); every > 0 && sequence % every == 0) {
+    ::shutdown(fd, SHUT_RDWR); // 不发送任何响应，客户端收到空回复
+    return;
+  }
+  std::string extraHeaders;
+  if (int every = faultEvery_.load(); every > 0 && sequence % every == 0) {
+    status = faultStatus_.load();
+    body = R"({"code":)" + std::to_string(status) +
+           R"(,"name":"InjectedFault","message":"injected fault"})";
+    if (int retryAfter = retryAfterSec_.load(); retryAfter >= 0) {
+      extraHeaders = "Retry-After: " + std::to_string(retryAfter) + "\r\n";
+    }
+  }
+  const char *reason = status == 200   ? "OK"
+                       : status == 404 ? "Not Found"
+                       : status == 429 ? "Too Many Requests"
+                       : status == 503 ? "Service Unavailable"
+                                       : "Internal Server Error";
+  std::string response = "HTTP/1.1 " + std::to_string(status) + " " + reason +
+                         "\r\nContent-Type: application/json\r\nContent-Length: " +
+                         std::to_string(body.size()) + "\r\n" + extraHeaders +
+                         "Connection: close\r\n\r\n" + body;
+  size_t sent = 0;
+  while (sent < response.size()) {
+    ssize_t n = ::send(fd, response.data() + sent, response.size() - sent, MSG_NOSIGNAL);
+    if (n <= 0) {
+      return; // 客户端已取消请求
+    }
+    sent += static_cast<size_t>(n);
+  }
+}
+
+std::string LrclibStub::respond(const std::string &path, int &status) {
+  size_t question = path.find('?');
+  std::string endpoint = path.substr(0, question);
+  auto params = parseQuery(question == std::string::npos ? "" : path.substr(question + 1));
+  std::string title = lower(params["track_name"]);
+  std::string artist = lower(params["artist_name"]);
+
+  std::string name = endpoint == "/api/get"      ? "get"
+                     : endpoint == "/api/search" ? "search"
+                                                 : "other";
+  std::lock_guard<std::mutex> lock(mutex_);
+  ++counts_[name];
+  log_.push_back({name, params["track_name"], params["artist_name"],
+                  std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() -
+                                                            startedAt_)
+                      .count()});
+  if (name == "get") {
+    auto it = tracks_.find(title + '\x1f' + artist);
+    if (it == tracks_.end()) {
+      status = 404;
+      return R"({"code":404,"name":"TrackNotFound","message":"Failed to find specified track"})";
+    }
+    return trackJson(it->second, std::distance(tracks_.begin(), it) + 1).dump();
+  }
+  if (name == "search") {
+    nlohmann::json results = nlohmann::json::array();
+    size_t id = 0;
+    for (const auto &[key, track] : tracks_) {
+      ++id;
+      if (lower(track.title).find(title) != std::string::npos &&
+          (artist.empty() || lower(track.artist).find(artist) != std::string::npos)) {
+        results.push_back(trackJson(track, id));
+      }
+    }
+    return results.dump();
+  }
+  status = 404;
+  return R"({"code":404,"name":"NotFound","message":"Not found"})";
+}
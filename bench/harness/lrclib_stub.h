@@ -0,0 +1,87 @@
+#ifndef WAYLYRICS_LRCLIB_STUB_H
+#define WAYLYRICS_LRCLIB_STUB_H
+// Filename: lrclib_stub.h
+// Description: 本地 lrclib 模拟服务（/api/get、/api/search），可配置延迟和故障
+// Author: awkee
+///////////////////////////////////////////////////////
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+struct StubTrack {
+  std::string title;
+  std::string artist;
+  std::string album;
+  uint64_t durationMs = 0;
+  std::string syncedLyrics;
+};
+
+// 收到的一个请求（按到达顺序记录，用于检查阶段的发出顺序）
+struct StubRequest {
+  std::string endpoint; // get / search / other
+  std::string title;    // track_name 参数
+  std::string artist;   // artist_name 参数（没有时为空）
+  double atMs = 0;      // 距模拟服务启动的毫秒数
+};
+
+/*
+ * 只监听 127.0.0.1 的随机端口，每个连接一个线程，响应后关闭连接（不支持 keep-alive）
+\ *   get:    按标题和艺术家（不区分大小写）精确匹配，未找到返回 404
+ *   search: 标题包含 track_name（且艺术家包含 artist_name）的全部曲目
+ * 延迟在返回响应前等待；faultEvery 为 N 时每第 N 个请求返回 faultStatus（默认 500，
+ * 429/503 时带 retryAfter 秒的 Retry-After 头），resetEvery 为 N 时每第 N 个请求不响应直接断开
+ * （0 表示不注入故障）
+ */
+class LrclibStub {
+public:
+  LrclibStub();
+  ~LrclibStub();
+  LrclibStub(const LrclibStub &) = delete;
+  LrclibStub &operator=(const LrclibStub &) = delete;
+
+  void addTrack(StubTrack track);
+  std::string baseUrl() const;
+
+  void setLatencyMs(int ms) { latencyMs_ = ms; }
+  void setFaultEvery(int n) { faultEvery_ = n; }
+  void setFaultStatus(int status, int retryAfterSec = -1) {
+    faultStatus_ = status;
+    retryAfterSec_ = retryAfterSec;
+  }
+  void setResetEvery(int n) { resetEvery_ = n; }
+
+  // 请求计数（按端点名称：get / search / other），用于统计各场景的请求数
+  std::map<std::string, uint64_t> requestCounts() const;
+  uint64_t totalRequests() const;
+  std::vector<StubRequest> requestLog() const;
+
+private:
+  void acceptLoop();
+  void serve(int fd);
+  std::string respond(const std::string &path, int &status);
+
+  int listenFd_ = -1;
+  int port_ = 0;
+  std::atomic<bool> running_{true};
+  std::atomic<int> latencyMs_{0};
+  std::atomic<int> faultEvery_{0};
+  std::atomic<int> faultStatus_{500};
+  std::atomic<int> retryAfterSec_{-1};
+  std::atomic<int> resetEvery_{0};
+  std::atomic<uint64_t> sequence_{0};
+  std::atomic<int> activeConnections_{0};
+  std::thread acceptThread_;
+  std::chrono::steady_clock::time_point startedAt_ = std::chrono::steady_clock::now();
+  mutable std::mutex mutex_; // 保护 tracks_、counts_ 和 log_
+  std::map<std::string, StubTrack> tracks_; // 键为小写的 "标题\x1f艺术家"
+  std::map<std::string, uint64_t> counts_;
+  std::vector<StubRequest> log_;
+};
+
+#endif // WAYLYRICS_LRCLIB_STUB_H
@@ -0,0 +1,224 @@
+#include "mock_player.h"
+#include <algorithm>
+#include <thread>
+#include <vector>
+
+namespace {
+constexpr const char *rootInterface = "org.mpris.MediaPlayer2";
+constexpr const char *playerInterface = "org.mpris.MediaPlayer2.Player";
+// 发出 PropertiesChanged 时 sdbus-c++ 在当前线程调用 getter 填充属性值，这部分不计入收到的调用
+thread_local bool emitting = false;
+} // namespace
+
+MockPlayer::MockPlayer(const std::string &name)
+    : serviceName_("org.mpris.MediaPlayer2." + name) {
+  connection_ = sdbus::createSessionBusConnection(sdbus::ServiceName{serviceName_});
+  object_ = sdbus::createObject(*connection_, sdbus::ObjectPath{"/org/mpris/MediaPlayer2"});
+
+  object_->addVTable(
+             sdbus::registerProperty("Identity").withGetter([this]() {
+               count("Get:Identity");
+               return std::string("waylyrics harness");
+             }),
+             sdbus::registerProperty("HasTrackList").withGetter([this]() {
+               count("Get:HasTrackList");
+               return false;
+             }),
+             sdbus::registerProperty("CanQuit").withGetter([]() { return false; }),
+             sdbus::registerProperty("CanRaise").withGetter([]() { return false; }))
+      .forInterface(sdbus::InterfaceName{rootInterface});
+
+  object_->addVTable(
+             sdbus::registerMethod("PlayPause").implementedAs([this]() {
+               count("PlayPause");
+               statusName() == "Playing" ? pause() : play();
+             }),
+             sdbus::registerMethod("Play").implementedAs([this]() {
+               count("Play");
+               play();
+             }),
+             sdbus::registerMethod("Pause").implementedAs([this]() {
+               count("Pause");
+               pause();
+             }),
+             sdbus::registerMethod("Stop").implementedAs([this]() {
+               count("Stop");
+               stop();
+             }),
+             sdbus::registerMethod("Next").implementedAs([this]() { count("Next"); }),
+             sdbus::registerMethod("Previous").implementedAs([this]() { count("Previous"); }),
+             sdbus::registerMethod("Seek").implementedAs([this](int64_t offsetUs) {
+               count("Seek");
+               int64_t target = static_cast<int64_t>(positionMs()) + offsetUs / 1000;
+               seek(static_cast<uint64_t>(std::max<int64_t>(0, target)));
+             }),
+             sdbus::registerMethod("SetPosition")
+                 .implementedAs([this](const sdbus::ObjectPath &, int64_t positionUs) {
+                   count("SetPosition");
+                   seek(static_cast<uint64_t>(std::max<int64_t>(0, positionUs / 1000)));
+                 }),
+             sdbus::registerSignal("Seeked").withParameters<int64_t>("Position"),
+             sdbus::registerProperty("PlaybackStatus").withGetter([this]() {
+               count("Get:PlaybackStatus");
+               return statusName();
+             }),
+             sdbus::registerProperty("LoopStatus").withGetter([this]() {
+               count("Get:LoopStatus");
+               return std::string("None");
+             }),
+             sdbus::registerProperty("Shuffle").withGetter([this]() {
+               count("Get:Shuffle");
+               return false;
+             }),
+             sdbus::registerProperty("Rate").withGetter([]() { return 1.0; }),
+             sdbus::registerProperty("Metadata").withGetter([this]() {
+               count("Get:Metadata");
+               return metadata();
+             }),
+             sdbus::registerProperty("Position").withGetter([this]() {
+               count("Get:Position");
+               return static_cast<int64_t>(positionMs() * 1000);
+             }),
+             sdbus::registerProperty("CanGoNext").withGetter([]() { return true; }),
+             sdbus::registerProperty("CanGoPrevious").withGetter([]() { return true; }),
+             sdbus::registerProperty("CanPlay").withGetter([]() { return true; }),
+             sdbus::registerProperty("CanPause").withGetter([]() { return true; }),
+             sdbus::registerProperty("CanSeek").withGetter([]() { return true; }),
+             sdbus::registerProperty("CanControl").withGetter([]() { return true; }))
+      .forInterface(sdbus::InterfaceName{playerInterface});
+
+  connection_->enterEventLoopAsync();
+}
+
+MockPlayer::~MockPlayer() {
+  object_.reset();
+  connection_->leaveEventLoop();
+}
+
+void MockPlayer::setTrack(const MockTrack &track) {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    track_ = track;
+    status_ = "Playing";
+    basePositionMs_ = 0;
+    baseTime_ = std::chrono::steady_clock::now();
+  }
+  emitChanged({"Metadata", "PlaybackStatus"});
+}
+
+void MockPlayer::play() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (status_ == "Playing") {
+      return;
+    }
+    status_ = "Playing";
+    baseTime_ = std::chrono::steady_clock::now();
+  }
+  emitChanged({"PlaybackStatus"});
+}
+
+void MockPlayer::pause() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (status_ != "Playing") {
+      return;
+    }
+    basePositionMs_ += static_cast<uint64_t>(
+        std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::steady_clock::now() - baseTime_)
+            .count());
+    status_ = "Paused";
+  }
+  emitChanged({"PlaybackStatus"});
+}
+
+void MockPlayer::stop() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    status_ = "Stopped";
+    basePositionMs_ = 0;
+  }
+  emitChanged({"PlaybackStatus"});
+}
+
+void MockPlayer::seek(uint64_t positionMs) {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    basePositionMs_ = positionMs;
+    baseTime_ = std::chrono::steady_clock::now();
+  }
+  object_->emitSignal("Seeked")
+      .onInterface(playerInterface)
+      .withArguments(static_cast<int64_t>(positionMs * 1000));
+}
+
+void MockPlayer::storm(int count, std::chrono::microseconds gap) {
+  for (int i = 0; i < count; ++i) {
+    emitChanged({"Metadata"});
+    if (gap.count() > 0) {
+      std::this_thread::sleep_for(gap);
+    }
+  }
+}
+
+uint64_t MockPlayer::positionMs() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (status_ != "Playing") {
+    return basePositionMs_;
+  }
+  return basePositionMs_ + static_cast<uint64_t>(
+                               std::chrono::duration_cast<std::chrono::milliseconds>(
+                                   std::chrono::steady_clock::now() - baseTime_)
+                                   .count());
+}
+
+std::map<std::string, uint64_t> MockPlayer::callCounts() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return calls_;
+}
+
+void MockPlayer::count(const std::string &name) const {
+  if (emitting) {
+    return;
+  }
+  ++totalCalls_;
+  std::lock_guard<std::mutex> lock(mutex_);
+  ++calls_[name];
+}
+
+void MockPlayer::emitChanged(std::initializer_list<const char *> properties) {
+  std::vector<sdbus::PropertyName> names;
+  for (const char *property : properties) {
+    names.emplace_back(property);
+  }
+  emitting = true;
+  object_->emitPropertiesChangedSignal(sdbus::InterfaceName{playerInterface}, names);
+  emitting = false;
+}
+
+std::map<std::string, sdbus::Variant> MockPlayer::metadata() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  std::map<std::string, sdbus::Variant> md;
+  if (track_.title.empty()) {
+    return md;
+  }
+  md["mpris:trackid"] = sdbus::Variant(sdbus::ObjectPath{
+      track_.trackId.empty() ? "/org/mpris/MediaPlayer2/Track/0" : track_.trackId});
+  md["xesam:title"] = sdbus::Variant(track_.title);
+  md["xesam:artist"] = sdbus::Variant(std::vector<std::string>{track_.artist});
+  md["xesam:album"] = sdbus::Variant(track_.album);
+  md["mpris:length"] = sdbus::Variant(static_cast<int64_t>(track_.lengthMs * 1000));
+  if (!track_.url.empty()) {
+    md["xesam:url"] = sdbus::Variant(track_.url);
+  }
+  if (!track_.asText.empty()) {
+    md["xesam:asText"] = sdbus::Variant(track_.asText);
+  }
+  return md;
+}
+
+std::string MockPlayer::statusName() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return status_;
+}
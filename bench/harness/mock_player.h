@@ -0,0 +1,76 @@
+#ifndef WAYLYRICS_MOCK_PLAYER_H
+#define WAYLYRICS_MOCK_PLAYER_H
+// Filename: mock_player.h
+// Description: 可脚本控制的 MPRIS 模拟播放器（换歌、跳转、暂停、信号风暴），统计收到的 D-Bus 调用
+// Author: awkee
+///////////////////////////////////////////////////////
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <sdbus-c++/sdbus-c++.h>
+#include <string>
+
+struct MockTrack {
+  std::string trackId; // mpris:trackid（对象路径）
+  std::string title;
+  std::string artist;
+  std::string album;
+  std::string url;
+  std::string asText; // xesam:asText（musicfox 风格的内嵌歌词，可为空）
+  uint64_t lengthMs = 0;
+};
+
+/*
+ * 在指定连接（通常是私有总线）上注册 org.mpris.MediaPlayer2.<name>，导出
+ * /org/mpris/MediaPlayer2 的 org.mpris.MediaPlayer2 和 org.mpris.MediaPlayer2.Player 接口。
+ * 播放位置按播放状态用 steady_clock 推算；状态变更通过 PropertiesChanged 通知，
+ * 跳转通过 Seeked 通知，与真实播放器一致
+ */
+class MockPlayer {
+public:
+  explicit MockPlayer(const std::string &name);
+  ~MockPlayer();
+  MockPlayer(const MockPlayer &) = delete;
+  MockPlayer &operator=(const MockPlayer &) = delete;
+
+  std::string serviceName() const { return serviceName_; }
+
+  // 换歌：更新元数据，位置归零并开始播放，发出 Metadata + PlaybackStatus 变更
+  void setTrack(const MockTrack &track);
+  void play();
+  void pause();
+  void stop();
+  // 跳转到指定位置（毫秒），发出 Seeked
+  void seek(uint64_t positionMs);
+  // 信号风暴：连续发出 count 次 Metadata 变更（元数据不变，模拟浏览器等播放器的重复信号）
+  void storm(int count, std::chrono::microseconds gap = std::chrono::microseconds(0));
+
+  uint64_t positionMs() const;
+  // 收到的 D-Bus 调用（属性读取按 "Get:<属性>"、方法按方法名计数）
+  std::map<std::string, uint64_t> callCounts() const;
+  uint64_t totalCalls() const { return totalCalls_.load(); }
+
+private:
+  void count(const std::string &name) const;
+  void emitChanged(std::initializer_list<const char *> properties);
+  std::map<std::string, sdbus::Variant> metadata() const;
+  std::string statusName() const;
+
+  std::string serviceName_;
+  std::unique_ptr<sdbus::IConnection> connection_;
+  std::unique_ptr<sdbus::IObject> object_;
+
+  mutable std::mutex mutex_; // 保护以下播放状态和 calls_
+  MockTrack track_;
+  std::string status_ = "Stopped";
+  uint64_t basePositionMs_ = 0;
+  std::chrono::steady_clock::time_point baseTime_ = std::chrono::steady_clock::now();
+  mutable std::map<std::string, uint64_t> calls_;
+  mutable std::atomic<uint64_t> totalCalls_{0};
+};
+
+#endif // WAYLYRICS_MOCK_PLAYER_H
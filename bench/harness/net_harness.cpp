@@ -0,0 +1,454 @@
+// Filename: net_harness.cpp
+// Description: 网络层测试台：本地 lrclib 服务上验证分阶段查询（get → search → 对冲变体）、
+//              超时、重试预算、令牌桶限流和熔断
+// Author: awkee
+//
+// 不需要 dbus-daemon 和显示服务。每个场景使用一个新的本地 lrclib 服务（随机端口，
+// 因此限流和熔断状态互不影响）和默认的测试策略，通过服务注入延迟、5xx、429 和断开连接，
+// 检查发出的阶段、命中阶段、各端点的请求数和主机统计，
+// 结果以 JSON 输出到标准输出，有检查失败时退出码为 1。
+//
+// 用法: net-harness [--scenario 子串] [--latency-ms N] [--verbose]
+///////////////////////////////////////////////////////
+
+#include "../../include/http_client.h"
+#include "../../include/lrclib.h"
+#include "../../include/metrics.h"
+#include "../../include/utils.hpp"
+#include "common.h"
+#include "lrclib_stub.h"
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <functional>
+#include <map>
+#include <nlohmann/json.hpp>
+#include <thread>
+
+int log_level = LOG_LEVEL_NONE;
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+using Json = nlohmann::ordered_json;
+
+struct Options {
+  std::string scenario;
+  int latencyMs = 20;
+  bool verbose = false;
+};
+
+double msSince(Clock::time_point start) {
+  return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+const char *syncedLyrics = "[00:01.00]harness line one\n[00:05.00]harness line two\n";
+
+StubTrack stubTrack(const std::string &title, const std::string &artist) {
+  return {title, artist, "Harness Album", 245000, syncedLyrics};
+}
+
+LrclibQuery query(const std::string &title, const std::string &artist) {
+  return {title, artist, "Harness Album", 245000};
+}
+
+// 测试策略：本地服务不限流（避免限流等待计入阶段耗时），退避很短，不熔断
+HttpPolicy basePolicy() {
+  HttpPolicy policy;
+  policy.retryBaseMs = 10;
+  policy.retryBudget = 1;
+  policy.rateLimit = 0;
+  policy.breakerThreshold = 0;
+  return policy;
+}
+
+HttpHostStats hostStats(const LrclibStub &stub) {
+  std::string host = stub.baseUrl().substr(std::string("http://").size());
+  for (auto &stats : httpHostStats()) {
+    if (stats.host == host) {
+      return stats;
+    }
+  }
+  return {};
+}
+
+const char *breakerName(BreakerState state) {
+  return state == BreakerState::Closed ? "closed" : state == BreakerState::Open ? "open" : "half-open";
+}
+
+Json statsJson(const HttpHostStats &stats) {
+  return {{"breaker", breakerName(stats.breaker)},
+          {"consecutive_failures", stats.consecutiveFailures},
+          {"requests", stats.requests},
+          {"retries", stats.retries},
+          {"failures", stats.failures},
+          {"rejected", stats.rejected},
+          {"throttled_ms", stats.throttledMs}};
+}
+
+Json stagesJson(const LrclibLookup &lookup) {
+  Json stages = Json::array();
+  for (const auto &stage : lookup.stages) {
+    stages.push_back({{"name", stage.name},
+                      {"status", stage.status},
+                      {"latency_ms", stage.latencyMs},
+                      {"hit", stage.hit},
+                      {"cancelled", stage.cancelled},
+                      {"failed", stage.failed}});
+  }
+  return stages;
+}
+
+class NetHarness {
+public:
+  explicit NetHarness(const Options &options) : options_(options) {}
+
+  void run() {
+    // 精确匹配命中：只发出 get
+    lookupScenario("lrclib-exact-hit", {stubTrack("Harness Exact Song", "Harness Artist")},
+                   query("Harness Exact Song", "Harness Artist"), 1500, "get",
+                   {{"get", 1}});
+    // 标题带装饰：get 和原始标题搜索都未命中，规范化标题+主艺术家命中；
+    // 对冲延迟为 0 时三个搜索同时发出，search-clean 优先级高于同样命中的 search-title
+    lookupScenario("lrclib-search-clean",
+                   {stubTrack("Harness Clean Song", "Harness Artist")},
+                   query("Harness Clean Song (Remastered 2011)", "Harness Artist feat. Guest"),
+                   0, "search-clean", {{"get", 1}, {"search", 3}});
+    // 艺术家不一致：只有不带艺术家的标题搜索命中
+    lookupScenario("lrclib-search-title",
+                   {stubTrack("Harness Title Song", "Harness Artist")},
+                   query("Harness Title Song", "Someone Else"), 1500, "search-title",
+                   {{"get", 1}, {"search", 2}});
+    // 只有标题搜索能命中时，get 之后只需一个往返：search 与 search-title 同时发出
+    scenario("lrclib-search-title-one-rtt", [&](LrclibStub &stub, Json &result) {
+      const int latency = 200;
+      stub.setLatencyMs(latency);
+      stub.addTrack(stubTrack("Harness Title Song", "Harness Artist"));
+      auto start = Clock::now();
+      auto lookup = lookupLrclib(stub.baseUrl(), query("Harness Title Song", "Someone Else"));
+      double wallMs = msSince(start);
+      result["stages"] = stagesJson(lookup);
+      result["lookup_ms"] = wallMs;
+      expect(!lookup.syncedLyrics.empty(), "lyrics found");
+      expect(wallMs < 3 * latency, "get + one search round trip (" +
+                                       std::to_string(static_cast<int>(wallMs)) + " ms)");
+    });
+    // 没有歌词：所有阶段都发出，都得到明确的“未找到”，不算服务不可用
+    lookupScenario("lrclib-miss", {}, query("Harness Missing Song", "Harness Artist feat. Guest"),
+                   1500, "", {{"get", 1}, {"search", 3}});
+    // 没有时长时跳过 get，search 和 search-title 直接同时发出，优先采用 search
+    scenario("lrclib-no-duration", [&](LrclibStub &stub, Json &result) {
+      stub.addTrack(stubTrack("Harness Radio Song", "Harness Artist"));
+      LrclibQuery q = query("Harness Radio Song", "Harness Artist");
+      q.durationMs = 0;
+      auto lookup = lookupLrclib(stub.baseUrl(), q);
+      result["stages"] = stagesJson(lookup);
+      expect(!lookup.syncedLyrics.empty(), "lyrics found");
+      expect(!lookup.stages.empty() && lookup.stages.front().name == "search" &&
+                 lookup.stages.front().hit,
+             "search wins");
+      expectCounts(stub, {{"search", 2}});
+    });
+    // 对冲：search-clean 在 search 超过对冲延迟仍无结果时发出，get 始终单独发出
+    scenario("lrclib-hedge", [&](LrclibStub &stub, Json &result) {
+      const int latency = 300, delay = 100;
+      stub.setLatencyMs(latency);
+      auto start = Clock::now();
+      auto lookup = lookupLrclib(stub.baseUrl(),
+                                 query("Harness Missing Song", "Harness Artist feat. Guest"),
+                                 delay);
+      double wallMs = msSince(start);
+      result["stages"] = stagesJson(lookup);
+      result["lookup_ms"] = wallMs;
+      expectCounts(stub, {{"get", 1}, {"search", 3}});
+      // 串行需要 4 个延迟；对冲后约为 get + 对冲延迟 + search-clean
+      expect(wallMs < 4 * latency, "search variants overlap");
+      expect(wallMs >= 2 * latency, "get is not hedged");
+    });
+    // 阶段发出顺序（按模拟服务收到请求的时间）：get 单独发出；get 未命中后 search 和
+    // search-title 同时发出；search-clean 在 search 发出对冲延迟后、search 返回前发出。
+    // 不使用 /api/get-cached
+    scenario("lrclib-stage-order", [&](LrclibStub &stub, Json &result) {
+      const int latency = 200, delay = 100;
+      stub.setLatencyMs(latency);
+      lookupLrclib(stub.baseUrl(), query("Harness Missing Song (Live)", "Harness Artist feat. Guest"),
+                   delay);
+      std::map<std::string, double> at;
+      Json log = Json::array();
+      for (const auto &request : stub.requestLog()) {
+        std::string stage = request.endpoint;
+        if (stage == "search") {
+          stage = request.artist.empty()                          ? "search-title"
+                  : request.title == "Harness Missing Song (Live)" ? "search"
+                                                                    : "search-clean";
+        }
+        at.emplace(stage, request.atMs);
+        log.push_back({{"stage", stage}, {"at_ms", request.atMs}});
+      }
+      result["requests"] = log;
+      expectCounts(stub, {{"get", 1}, {"search", 3}});
+      if (at.size() != 4) {
+        expect(false, "all four stages sent");
+        return;
+      }
+      double get = at["get"], search = at["search"];
+      expect(search - get >= latency, "searches wait for the get miss");
+      expect(std::abs(at["search-title"] - search) < delay / 2,
+             "search and search-title are sent together");
+      double hedge = at["search-clean"] - search;
+      expect(hedge >= delay && hedge < latency,
+             "search-clean is hedged behind search (" + std::to_string(static_cast<int>(hedge)) +
+                 " ms)");
+    });
+
+    // 5xx 和断开连接都会重试，重试后成功
+    scenario("http-retry-5xx", [&](LrclibStub &stub, Json &result) {
+      stub.setFaultEvery(2);
+      auto first = httpGet(searchUrl(stub));
+      auto second = httpGet(searchUrl(stub));
+      result["attempts"] = {first.attempts, second.attempts};
+      expect(first.ok() && first.attempts == 1, "first request succeeds at once");
+      expect(second.ok() && second.attempts == 2, "500 is retried once and succeeds");
+    });
+    scenario("http-retry-reset", [&](LrclibStub &stub, Json &result) {
+      stub.setResetEvery(2);
+      httpGet(searchUrl(stub));
+      auto response = httpGet(searchUrl(stub));
+      result["attempts"] = response.attempts;
+      expect(response.ok() && response.attempts == 2, "reset connection is retried and succeeds");
+    });
+    // 429：按 Retry-After 等待后重试；Retry-After 超过退避上限时不重试
+    scenario("http-429-retry-after", [&](LrclibStub &stub, Json &result) {
+      stub.setFaultEvery(2);
+      stub.setFaultStatus(429, 1);
+      httpGet(searchUrl(stub));
+      auto waited = httpGet(searchUrl(stub));
+      result["retry_after_ms"] = waited.elapsedMs;
+      expect(waited.ok() && waited.attempts == 2, "429 is retried and succeeds");
+      expect(waited.elapsedMs >= 1000, "retry waits for Retry-After");
+      stub.setFaultStatus(429, 10);
+      auto refused = httpGet(searchUrl(stub));
+      result["long_retry_after_ms"] = refused.elapsedMs;
+      expect(refused.status == 429 && refused.attempts == 1,
+             "Retry-After above retryMaxMs is not retried");
+      expect(!refused.definitive(), "429 is not a definitive answer");
+    });
+    // 总超时：黑洞服务不会让请求无限阻塞
+    scenario("http-timeout", [&](LrclibStub &stub, Json &result) {
+      HttpPolicy policy = basePolicy();
+      policy.timeoutMs = 150;
+      policy.retries = 0;
+      setHttpPolicy(policy);
+      stub.setLatencyMs(1000);
+      auto response = httpGet(searchUrl(stub));
+      result["elapsed_ms"] = response.elapsedMs;
+      result["error"] = response.error;
+      expect(!response.error.empty() && !response.definitive(), "timeout is a failure");
+      expect(response.elapsedMs < 600, "request ends near timeoutMs");
+    });
+    // 重试预算：初始 1 次额度，每个请求只积累 retryBudget，故障期间重试不会放大流量
+    scenario("http-retry-budget", [&](LrclibStub &stub, Json &result) {
+      HttpPolicy policy = basePolicy();
+      policy.retryBudget = 0.25;
+      setHttpPolicy(policy);
+      stub.setFaultEvery(1);
+      std::vector<int> attempts;
+      for (int i = 0; i < 4; ++i) {
+        attempts.push_back(httpGet(searchUrl(stub)).attempts);
+      }
+      auto stats = hostStats(stub);
+      result["attempts"] = attempts;
+      result["host"] = statsJson(stats);
+      // 第一次用掉初始额度（并积累 0.5），之后每 4 个请求才攒够 1 次重试
+      expect(attempts.front() == 2, "first failure is retried from the initial budget");
+      expect(stats.retries <= 2, "retries stay within the budget (" +
+                                     std::to_string(stats.retries) + ")");
+      expect(stats.requests == 4 + stats.retries, "no retries beyond the budget");
+    });
+    // 令牌桶：突发 2 个，之后每秒 10 个
+    scenario("http-rate-limit", [&](LrclibStub &stub, Json &result) {
+      HttpPolicy policy = basePolicy();
+      policy.rateLimit = 10;
+      policy.rateBurst = 2;
+      setHttpPolicy(policy);
+      stub.setLatencyMs(0);
+      auto start = Clock::now();
+      for (int i = 0; i < 6; ++i) {
+        httpGet(searchUrl(stub));
+      }
+      double wallMs = msSince(start);
+      auto stats = hostStats(stub);
+      result["requests_ms"] = wallMs;
+      result["host"] = statsJson(stats);
+      expect(wallMs >= 350, "4 requests beyond the burst wait for tokens");
+      expect(stats.throttledMs >= 350, "throttled time is recorded");
+    });
+    // 熔断：连续失败达到阈值后打开并拒绝请求，冷却后只放行一个探测，探测失败重新打开，成功后关闭
+    scenario("http-breaker", [&](LrclibStub &stub, Json &result) {
+      HttpPolicy policy = basePolicy();
+      policy.retries = 0;
+      policy.breakerThreshold = 3;
+      policy.breakerCooldownMs = 300;
+      setHttpPolicy(policy);
+      stub.setFaultEvery(1);
+      for (int i = 0; i < 3; ++i) {
+        httpGet(searchUrl(stub));
+      }
+      uint64_t sent = stub.totalRequests();
+      auto rejected = httpGet(searchUrl(stub));
+      expect(hostStats(stub).breaker == BreakerState::Open, "breaker opens after 3 failures");
+      expect(rejected.rejected && stub.totalRequests() == sent, "open breaker sends nothing");
+      std::this_thread::sleep_for(std::chrono::milliseconds(policy.breakerCooldownMs + 50));
+      auto probe = httpGet(searchUrl(stub));
+      expect(!probe.rejected && stub.totalRequests() == sent + 1, "cooldown admits one probe");
+      expect(hostStats(stub).breaker == BreakerState::Open, "failed probe reopens the breaker");
+      expect(httpGet(searchUrl(stub)).rejected, "reopened breaker rejects");
+      stub.setFaultEvery(0);
+      std::this_thread::sleep_for(std::chrono::milliseconds(policy.breakerCooldownMs + 50));
+      auto recovered = httpGet(searchUrl(stub));
+      auto stats = hostStats(stub);
+      result["host"] = statsJson(stats);
+      expect(recovered.ok(), "successful probe gets through");
+      expect(stats.breaker == BreakerState::Closed && stats.consecutiveFailures == 0,
+             "successful probe closes the breaker");
+    });
+    // 对冲查询整体只计一次失败：一次查询发出 4 个请求，熔断阈值按查询次数计算
+    scenario("lrclib-breaker-per-lookup", [&](LrclibStub &stub, Json &result) {
+      HttpPolicy policy = basePolicy();
+      policy.retries = 0;
+      policy.breakerThreshold = 3;
+      policy.breakerCooldownMs = 60000;
+      setHttpPolicy(policy);
+      stub.setFaultEvery(1);
+      auto q = query("Harness Missing Song", "Harness Artist feat. Guest");
+      std::vector<int> consecutive;
+      bool unavailable = true;
+      for (int i = 0; i < 3; ++i) {
+        auto lookup = lookupLrclib(stub.baseUrl(), q, 50);
+        unavailable = unavailable && lookup.unavailable();
+        consecutive.push_back(hostStats(stub).consecutiveFailures);
+      }
+      uint64_t sent = stub.totalRequests();
+      auto blocked = lookupLrclib(stub.baseUrl(), q, 50);
+      result["consecutive_failures"] = consecutive;
+      result["blocked_stages"] = stagesJson(blocked);
+      result["host"] = statsJson(hostStats(stub));
+      expect(unavailable, "failed lookups are unavailable, not \"no lyrics\"");
+      expect(consecutive == std::vector<int>{1, 2, 3}, "one failure per lookup");
+      expect(sent == 12, "each failing lookup sends get + 3 searches (" + std::to_string(sent) +
+                             ")");
+      expect(hostStats(stub).breaker == BreakerState::Open, "breaker opens on the 3rd lookup");
+      expect(blocked.unavailable() && stub.totalRequests() == sent,
+             "lookups are cache-only while the breaker is open");
+    });
+  }
+
+  const Json &results() const { return results_; }
+  int failures() const { return failures_; }
+
+private:
+  static std::string searchUrl(const LrclibStub &stub) {
+    return stub.baseUrl() + "/api/search?track_name=" + url_encode("Harness Song");
+  }
+
+  void scenario(const std::string &name, const std::function<void(LrclibStub &, Json &)> &body) {
+    if (!options_.scenario.empty() && name.find(options_.scenario) == std::string::npos) {
+      return;
+    }
+    fprintf(stderr, "scenario %s ...\n", name.c_str());
+    setHttpPolicy(basePolicy());
+    LrclibStub stub;
+    stub.setLatencyMs(options_.latencyMs);
+    checks_ = Json::array();
+    Json result = {{"name", name}};
+    auto start = Clock::now();
+    body(stub, result);
+    result["wall_ms"] = msSince(start);
+    result["http_requests_by_endpoint"] = stub.requestCounts();
+    result["checks"] = std::move(checks_);
+    results_.push_back(std::move(result));
+  }
+
+  void lookupScenario(const std::string &name, const std::vector<StubTrack> &tracks,
+                      const LrclibQuery &q, int hedgeDelayMs, const std::string &hitStage,
+                      const std::map<std::string, uint64_t> &counts) {
+    scenario(name, [&](LrclibStub &stub, Json &result) {
+      for (const auto &track : tracks) {
+        stub.addTrack(track);
+      }
+      auto lookup = lookupLrclib(stub.baseUrl(), q, hedgeDelayMs);
+      result["stages"] = stagesJson(lookup);
+      std::string hit;
+      for (const auto &stage : lookup.stages) {
+        if (stage.hit && !stage.cancelled) {
+          hit = stage.name;
+          break;
+        }
+      }
+      expect(hit == hitStage, "hit stage is [" + hitStage + "], got [" + hit + "]");
+      expect(lookup.syncedLyrics.empty() == hitStage.empty(), "lyrics returned iff hit");
+      expect(!lookup.unavailable(), "not reported as unavailable");
+      expectCounts(stub, counts);
+    });
+  }
+
+  void expect(bool ok, const std::string &what) {
+    checks_.push_back({{"check", what}, {"ok", ok}});
+    if (!ok) {
+      ++failures_;
+      fprintf(stderr, "  FAILED: %s\n", what.c_str());
+    }
+  }
+
+  void expectCounts(const LrclibStub &stub, const std::map<std::string, uint64_t> &expected) {
+    auto counts = stub.requestCounts();
+    for (const auto &[endpoint, count] : counts) {
+      auto it = expected.find(endpoint);
+      uint64_t want = it == expected.end() ? 0 : it->second;
+      expect(count == want, endpoint + " requests: " + std::to_string(count) + ", expected " +
+                                std::to_string(want));
+    }
+    for (const auto &[endpoint, count] : expected) {
+      if (!counts.contains(endpoint)) {
+        expect(false, endpoint + " requests: 0, expected " + std::to_string(count));
+      }
+    }
+  }
+
+  const Options &options_;
+  Json results_ = Json::array();
+  Json checks_;
+  int failures_ = 0;
+};
+
+} // namespace
+
+int main(int argc, char **argv) {
+  Options options;
+  for (int i = 1; i < argc; ++i) {
+    std::string arg = argv[i];
+    auto next = [&]() -> const char * { return i + 1 < argc ? argv[++i] : "0"; };
+    if (arg == "--scenario") {
+      options.scenario = next();
+    } else if (arg == "--latency-ms") {
+      options.latencyMs = std::max(0, atoi(next()));
+    } else if (arg == "--verbose") {
+      options.verbose = true;
+    } else {
+      fprintf(stderr, "usage: %s [--scenario SUBSTR] [--latency-ms N] [--verbose]\n", argv[0]);
+      return 2;
+    }
+  }
+  log_level = options.verbose ? LOG_LEVEL_DEBUG : LOG_LEVEL_NONE;
+
+  NetHarness harness(options);
+  harness.run();
+
+  Json report = {{"suite", "waybar_cffi_lyrics-net"},
+                 {"version", BUILD_VERSION},
+                 {"stub_latency_ms", options.latencyMs},
+                 {"scenarios", harness.results()}};
+  printf("%s\n", report.dump(2).c_str());
+  logShutdown();
+  return harness.failures() == 0 ? 0 : 1;
+}
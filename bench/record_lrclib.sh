@@ -0,0 +1,45 @@
+#!/bin/sh
+# Filename: record_lrclib.sh
+# Description: 录制真实的 lrclib 响应作为基准语料（benchmarks 会读取 <语料目录>/lrclib/index.tsv）
+# Author: awkee
+#
+# 用法: bench/record_lrclib.sh [曲目列表] [输出目录]
+#   曲目列表每行 "标题<TAB>艺术家[<TAB>时长毫秒]"，默认 bench/corpus/lrclib_tracks.tsv（真实曲目）；
+#   每首歌保存一次 /api/search 响应（与模块的 search 阶段相同的参数），有时长时另存一次 /api/get 响应。
+#   请求间隔 1 秒，遵守 lrclib 的使用限制；需要 curl 和网络
+###############################################################
+
+set -eu
+
+TRACKS=${1:-bench/corpus/lrclib_tracks.tsv}
+OUT=${2:-bench/corpus/lrclib}
+BASE=${LRCLIB_URL:-https://lrclib.net}
+AGENT="libwaybar_cffi_lyrics-bench"
+
+mkdir -p "$OUT"
+INDEX="$OUT/index.tsv"
+printf '# file\ttitle\tartist\tduration_ms（由 bench/record_lrclib.sh 录制自 %s）\n' "$BASE" > "$INDEX"
+
+n=0
+tab=$(printf '\t')
+while IFS="$tab" read -r title artist duration; do
+  case "$title" in ''|'#'*) continue ;; esac
+  n=$((n + 1))
+  file=$(printf 'search-%04d.json' "$n")
+  if curl -fsS -A "$AGENT" -G "$BASE/api/search" \
+      --data-urlencode "track_name=$title" --data-urlencode "artist_name=$artist" \
+      -o "$OUT/$file"; then
+    printf '%s\t%s\t%s\t%s\n' "$file" "$title" "$artist" "${duration:-0}" >> "$INDEX"
+  fi
+  if [ -n "${duration:-}" ]; then
+    file=$(printf 'get-%04d.json' "$n")
+    # 404（未找到）的响应体同样保存，它也是模块实际要解析的内容
+    if curl -sS -A "$AGENT" -G "$BASE/api/get" \
+        --data-urlencode "track_name=$title" --data-urlencode "artist_name=$artist" \
+        --data-urlencode "duration=$(( (duration + 500) / 1000 ))" -o "$OUT/$file"; then
+      printf '%s\t%s\t%s\t%s\n' "$file" "$title" "$artist" "$duration" >> "$INDEX"
+    fi
+  fi
+  sleep 1
+done < "$TRACKS"
+echo "recorded $n tracks into $OUT"
@@ -0,0 +1,201 @@
+// Filename: replay.cpp
+// Description: D-Bus 事件回放：把录制的 MPRIS 信号按虚拟时钟送入 PlayerManager，离线复现并度量
+// Author: awkee
+//
+// 用法: replay [--verbose] [--require-recorded] TRACE...
+//   录制文件由配置项 dbus-record 生成（格式见 include/dbus_recorder.h）。回放时 PlayerManager
+//   不连接 D-Bus，读取状态的回复按录制顺序给出，等待（如读取状态前的 300ms）只推进虚拟时钟，
+//   因此回放比实时快得多且结果确定。每个文件输出：
+//     - 状态回调次数、换歌次数、消耗/缺少/多余的录制回复（行为与录制时一致时后三者为 0/0/0）
+//     - 事件排队延迟（事件到达时 PlayerManager 仍在处理上一个事件的虚拟时间）
+//     - 回调序列摘要（digest），相同的录制与代码两次回放必然相同，可用于回归对比
+//   有文件的回复不一致时退出码为 1；--require-recorded 时来源不是 dbus-record 录制（如手写示例）的文件也算失败
+///////////////////////////////////////////////////////
+
+#include "../include/dbus_recorder.h"
+#include "../include/player_manager.h"
+#include "../include/track_key.h"
+#include "common.h"
+#include <chrono>
+#include <cstdio>
+#include <deque>
+#include <fstream>
+#include <nlohmann/json.hpp>
+
+int log_level = LOG_LEVEL_NONE;
+
+namespace {
+
+using Json = nlohmann::ordered_json;
+
+// FNV-1a 64，用于回调序列摘要
+void mix(uint64_t &hash, std::string_view data) {
+  for (unsigned char c : data) {
+    hash ^= c;
+    hash *= 0x100000001b3ull;
+  }
+  hash ^= 0xff; // 字段分隔
+  hash *= 0x100000001b3ull;
+}
+
+// 文件头中的来源：dbus-record 录制的为 "dbus-record"，手写示例为 "handmade"，旧录制没有该字段
+std::string traceSource(const std::string &path) {
+  std::ifstream in(path);
+  std::string line;
+  if (!std::getline(in, line)) {
+    return "";
+  }
+  auto json = Json::parse(line, nullptr, false);
+  if (json.is_discarded() || !json.is_object() || json.value("k", "") != "h") {
+    return "";
+  }
+  return json.value("src", "");
+}
+
+Json replayTrace(const std::string &path, bool requireRecorded, bool &consistent) {
+  auto events = loadDbusTrace(path);
+  auto clock = std::make_shared<VirtualEventClock>();
+
+  std::deque<const DbusEvent *> replies;
+  std::map<std::string, uint64_t> kinds;
+  uint64_t traceEndUs = 0;
+  for (const auto &event : events) {
+    traceEndUs = std::max(traceEndUs, event.timeUs);
+    switch (event.kind) {
+    case DbusEvent::Kind::Players:
+      ++kinds["players"];
+      break;
+    case DbusEvent::Kind::Owner:
+      ++kinds["owner"];
+      break;
+    case DbusEvent::Kind::Signal:
+      ++kinds["signal"];
+      break;
+    case DbusEvent::Kind::State:
+      ++kinds["reply"];
+      replies.push_back(&event);
+      break;
+    case DbusEvent::Kind::Select:
+      ++kinds["select"];
+      break;
+    }
+  }
+  const size_t recordedReplies = replies.size();
+
+  uint64_t missing = 0, mismatched = 0, callbacks = 0, trackChanges = 0;
+  uint64_t digest = 0xcbf29ce484222325ull;
+  std::string lastKey;
+  auto stateSource = [&](const std::string &player) {
+    if (replies.empty()) {
+      ++missing;
+      return PlayerState{PlaybackStatus::Stopped, {}, 0, player};
+    }
+    PlayerState state = replies.front()->state;
+    replies.pop_front();
+    if (state.playerName != player) {
+      ++mismatched;
+      state.playerName = player;
+    }
+    return state;
+  };
+  auto callback = [&](const PlayerState &state) {
+    ++callbacks;
+    std::string key = makeTrackKey(state.metadata.title, state.metadata.artist).str();
+    if (key != lastKey) {
+      ++trackChanges;
+      lastKey = key;
+    }
+    mix(digest, std::to_string(clock->nowUs()));
+    mix(digest, state.playerName);
+    mix(digest, std::to_string(static_cast<int>(state.status)));
+    mix(digest, state.metadata.title);
+    mix(digest, state.metadata.artist);
+    mix(digest, std::to_string(state.position));
+  };
+
+  uint64_t maxQueueUs = 0, totalQueueUs = 0, delivered = 0;
+  auto wallStart = std::chrono::steady_clock::now();
+  {
+    PlayerManager manager(callback, clock, stateSource);
+    for (const auto &event : events) {
+      if (event.kind == DbusEvent::Kind::State) {
+        continue;
+      }
+      // 事件到达时上一个事件仍在处理（虚拟时间已超过到达时间），差值即排队延迟
+      uint64_t queueUs = clock->nowUs() > event.timeUs ? clock->nowUs() - event.timeUs : 0;
+      maxQueueUs = std::max(maxQueueUs, queueUs);
+      totalQueueUs += queueUs;
+      ++delivered;
+      clock->advanceTo(event.timeUs);
+      manager.replay(event);
+    }
+  }
+  double wallMs = std::chrono::duration<double, std::milli>(
+                      std::chrono::steady_clock::now() - wallStart)
+                      .count();
+
+  std::string source = traceSource(path);
+  consistent = missing == 0 && mismatched == 0 && replies.empty() &&
+               (!requireRecorded || source == "dbus-record");
+  char digestHex[17];
+  snprintf(digestHex, sizeof(digestHex), "%016lx", static_cast<unsigned long>(digest));
+  return {{"trace", path},
+          {"source", source.empty() ? "unknown" : source},
+          {"events", kinds},
+          {"callbacks", callbacks},
+          {"track_changes", trackChanges},
+          {"replies", {{"recorded", recordedReplies},
+                       {"used", recordedReplies - replies.size()},
+                       {"missing", missing},
+                       {"unused", replies.size()},
+                       {"player_mismatch", mismatched}}},
+          {"consistent", consistent},
+          {"queue_delay_ms", {{"max", static_cast<double>(maxQueueUs) / 1000},
+                              {"mean", delivered ? static_cast<double>(totalQueueUs) /
+                                                       static_cast<double>(delivered) / 1000
+                                                 : 0.0}}},
+          {"trace_ms", static_cast<double>(traceEndUs) / 1000},
+          {"virtual_end_ms", static_cast<double>(clock->nowUs()) / 1000},
+          {"wall_ms", wallMs},
+          {"speedup", wallMs > 0 ? static_cast<double>(traceEndUs) / 1000 / wallMs : 0.0},
+          {"digest", digestHex}};
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+  std::vector<std::string> traces;
+  bool requireRecorded = false;
+  for (int i = 1; i < argc; ++i) {
+    std::string arg = argv[i];
+    if (arg == "--verbose") {
+      log_level = LOG_LEVEL_DEBUG;
+    } else if (arg == "--require-recorded") {
+      requireRecorded = true;
+    } else if (arg.starts_with("--")) {
+      fprintf(stderr, "usage: %s [--verbose] [--require-recorded] TRACE...\n", argv[0]);
+      return 2;
+    } else {
+      traces.push_back(arg);
+    }
+  }
+  if (traces.empty()) {
+    fprintf(stderr, "usage: %s [--verbose] [--require-recorded] TRACE...\n", argv[0]);
+    return 2;
+  }
+
+  Json results = Json::array();
+  bool allConsistent = true;
+  for (const auto &trace : traces) {
+    bool consistent = false;
+    results.push_back(replayTrace(trace, requireRecorded, consistent));
+    allConsistent = allConsistent && consistent;
+  }
+  printf("%s\n", Json{{"suite", "waybar_cffi_lyrics-replay"},
+                      {"version", BUILD_VERSION},
+                      {"results", std::move(results)}}
+                     .dump(2)
+                     .c_str());
+  logShutdown();
+  return allConsistent ? 0 : 1;
+}
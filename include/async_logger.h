@@ -0,0 +1,22 @@
+#ifndef WAYLYRICS_ASYNC_LOGGER_H
+#define WAYLYRICS_ASYNC_LOGGER_H
+// Filename: async_logger.h
+// Description: 异步日志：每个线程一个无锁环形缓冲区，后台线程按时间合并输出到 stderr
+// Author: awkee
+///////////////////////////////////////////////////////
+
+#include <cstdint>
+
+// 写入一条日志（由 LOG_PRINT 调用）：在调用线程中格式化消息到本线程的环形缓冲区，
+// 不加锁、不做系统调用；缓冲区满时丢弃并计数。tag/file/func 必须是静态字符串
+void logWrite(const char *tag, const char *file, int line, const char *func,
+              const char *format, ...) __attribute__((format(printf, 5, 6)));
+
+// 等待已写入的日志全部输出
+void logFlush();
+// 输出剩余日志并停止后台线程（插件卸载前调用；之后再写日志会重新启动后台线程）
+void logShutdown();
+// 因缓冲区满被丢弃的日志条数
+uint64_t logDropped();
+
+#endif // WAYLYRICS_ASYNC_LOGGER_H
@@ -0,0 +1,68 @@
+#ifndef WAYLYRICS_DBUS_RECORDER_H
+#define WAYLYRICS_DBUS_RECORDER_H
+// Filename: dbus_recorder.h
+// Description: D-Bus 事件录制与读取：记录 PlayerManager 收到的 MPRIS 信号和状态回复，供离线回放
+// Author: awkee
+///////////////////////////////////////////////////////
+
+#include "player_manager.h"
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// 一次 PropertiesChanged 信号中与模块相关的内容
+struct PlayerSignal {
+  std::vector<std::string> changed; // 变更的属性名
+  bool hasMetadata = false;         // 是否包含 Metadata
+  PlayerMetadata metadata;          // 解析后的 Metadata
+  std::string playbackStatus;       // PlaybackStatus 的新值（未变更为空）
+};
+
+struct DbusEvent {
+  enum class Kind {
+    Players, // 启动时发现的播放器列表（之后读取一次当前播放器状态）
+    Owner,   // NameOwnerChanged（播放器启动/退出）
+    Signal,  // 播放器的 PropertiesChanged
+    State,   // 读取当前播放器状态的结果（Get 回复）
+    Select,  // 用户切换当前播放器
+  };
+  Kind kind = Kind::Signal;
+  uint64_t timeUs = 0;              // 相对录制开始的时间（微秒）
+  std::string player;               // 播放器总线名称
+  std::vector<std::string> players; // Players
+  std::string oldOwner;             // Owner
+  std::string newOwner;             // Owner
+  std::string interfaceName;        // Signal
+  PlayerSignal signal;              // Signal
+  PlayerState state{PlaybackStatus::Stopped, {}, 0, ""}; // State
+};
+
+/*
+ * 录制文件为 JSON Lines，每行一个事件，键名尽量短：
+ *   {"k":"h","v":1,"src":"dbus-record"}                     文件头（src 为来源，手写的示例为 "handmade"）
+ *   {"t":12,"k":"l","ps":["org.mpris.MediaPlayer2.mpv"]}    Players
+ *   {"t":..,"k":"o","p":..,"old":"","new":":1.42"}          Owner
+ *   {"t":..,"k":"s","p":..,"i":..,"c":[..],"st":..,"md":{..}} Signal
+ *   {"t":..,"k":"r","p":..,"st":"Playing","pos":1234,"md":{..}} State
+ *   {"t":..,"k":"u","p":..}                                 Select
+ * md 中与上一次相同的歌词（如 musicfox 每次信号都带完整的 xesam:asText）记为 "txr":1，不重复写入
+ */
+class DbusRecorder {
+public:
+  explicit DbusRecorder(const std::filesystem::path &file);
+  bool isOpen() const { return out_.is_open(); }
+  void record(const DbusEvent &event);
+
+private:
+  std::mutex mutex_;
+  std::ofstream out_;
+  std::string lastLyrics_;
+};
+
+// 读取录制文件（格式错误的行跳过并记录警告）
+std::vector<DbusEvent> loadDbusTrace(const std::filesystem::path &file);
+
+#endif // WAYLYRICS_DBUS_RECORDER_H
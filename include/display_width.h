@@ -0,0 +1,112 @@
+#ifndef WAYLYRICS_DISPLAY_WIDTH_H
+#define WAYLYRICS_DISPLAY_WIDTH_H
+// Filename: display_width.h
+// Description: UTF-8 文本显示宽度计算与按列截断（CJK全角占2列，组合字符占0列）
+// Author: awkee
+///////////////////////////////////////////////////////
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+// 解码 pos 处的一个UTF-8字符，返回码点并前移 pos（非法字节按单字节处理）
+inline uint32_t decodeUtf8(std::string_view text, size_t &pos) {
+  auto c0 = static_cast<unsigned char>(text[pos]);
+  size_t len = c0 < 0x80 ? 1 : (c0 >> 5) == 0x6 ? 2 : (c0 >> 4) == 0xE ? 3
+             : (c0 >> 3) == 0x1E ? 4 : 1;
+  if (pos + len > text.size()) {
+    len = 1;
+  }
+  uint32_t cp = len == 1 ? c0 : len == 2 ? (c0 & 0x1F) : len == 3 ? (c0 & 0x0F) : (c0 & 0x07);
+  for (size_t i = 1; i < len; ++i) {
+    cp = (cp << 6) | (static_cast<unsigned char>(text[pos + i]) & 0x3F);
+  }
+  pos += len;
+  return cp;
+}
+
+// 将码点编码为 UTF-8 追加到 out
+inline void appendUtf8(std::string &out, uint32_t cp) {
+  if (cp < 0x80) {
+    out += static_cast<char>(cp);
+  } else if (cp < 0x800) {
+    out += static_cast<char>(0xc0 | (cp >> 6));
+    out += static_cast<char>(0x80 | (cp & 0x3f));
+  } else if (cp < 0x10000) {
+    out += static_cast<char>(0xe0 | (cp >> 12));
+    out += static_cast<char>(0x80 | ((cp >> 6) & 0x3f));
+    out += static_cast<char>(0x80 | (cp & 0x3f));
+  } else {
+    out += static_cast<char>(0xf0 | (cp >> 18));
+    out += static_cast<char>(0x80 | ((cp >> 12) & 0x3f));
+    out += static_cast<char>(0x80 | ((cp >> 6) & 0x3f));
+    out += static_cast<char>(0x80 | (cp & 0x3f));
+  }
+}
+
+// 单个码点的显示列宽：0（组合/零宽字符）、1（半角）、2（全角）
+inline int codepointWidth(uint32_t cp) {
+  if (cp == 0x200D || (cp >= 0xFE00 && cp <= 0xFE0F) ||
+      (cp >= 0x0300 && cp <= 0x036F) || (cp >= 0x1AB0 && cp <= 0x1AFF) ||
+      (cp >= 0x1DC0 && cp <= 0x1DFF) || (cp >= 0x20D0 && cp <= 0x20FF) ||
+      (cp >= 0xFE20 && cp <= 0xFE2F) || (cp >= 0x200B && cp <= 0x200F) ||
+      (cp >= 0x1F3FB && cp <= 0x1F3FF) || (cp >= 0xE0100 && cp <= 0xE01EF)) {
+    return 0;
+  }
+  if ((cp >= 0x1100 && cp <= 0x115F) || (cp >= 0x2E80 && cp <= 0x303E) ||
+      (cp >= 0x3041 && cp <= 0xA4CF) || (cp >= 0xAC00 && cp <= 0xD7A3) ||
+      (cp >= 0xF900 && cp <= 0xFAFF) || (cp >= 0xFE30 && cp <= 0xFE4F) ||
+      (cp >= 0xFF00 && cp <= 0xFF60) || (cp >= 0xFFE0 && cp <= 0xFFE6) ||
+      (cp >= 0x1F300 && cp <= 0x1F64F) || (cp >= 0x1F900 && cp <= 0x1F9FF) ||
+      (cp >= 0x20000 && cp <= 0x3FFFD)) {
+    return 2;
+  }
+  return 1;
+}
+
+// 计算文本显示宽度（按字素簇：ZWJ 连接的字符与组合字符不额外占列）
+inline size_t displayWidth(std::string_view text) {
+  size_t width = 0, pos = 0;
+  bool joined = false;
+  while (pos < text.size()) {
+    uint32_t cp = decodeUtf8(text, pos);
+    if (!joined) {
+      width += codepointWidth(cp);
+    }
+    joined = cp == 0x200D;
+  }
+  return width;
+}
+
+// 返回不超过 columns 列的最长前缀字节数，截断点不会拆开字素簇
+inline size_t fitColumns(std::string_view text, size_t columns) {
+  size_t width = 0, pos = 0, fit = 0;
+  bool joined = false;
+  while (pos < text.size()) {
+    size_t start = pos;
+    uint32_t cp = decodeUtf8(text, pos);
+    int w = joined ? 0 : codepointWidth(cp);
+    joined = cp == 0x200D;
+    if (w > 0) {
+      if (width + w > columns) {
+        return start;
+      }
+      width += w;
+    }
+    fit = pos;
+  }
+  return fit;
+}
+
+// 截断到 columns 列，超出时末尾加省略号（省略号占1列）
+inline std::string truncateColumns(std::string_view text, size_t columns) {
+  if (columns == 0 || displayWidth(text) <= columns) {
+    return std::string(text);
+  }
+  std::string result(text.substr(0, fitColumns(text, columns - 1)));
+  result += "…";
+  return result;
+}
+
+#endif // WAYLYRICS_DISPLAY_WIDTH_H
@@ -0,0 +1,55 @@
+#ifndef WAYLYRICS_EVENT_CLOCK_H
+#define WAYLYRICS_EVENT_CLOCK_H
+// Filename: event_clock.h
+// Description: 事件时钟：PlayerManager 的时间戳和等待通过它进行，回放时替换为虚拟时钟
+// Author: awkee
+///////////////////////////////////////////////////////
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <thread>
+
+class EventClock {
+public:
+  virtual ~EventClock() = default;
+  virtual uint64_t nowUs() const = 0; // 单调时间（微秒）
+  virtual void sleepFor(std::chrono::microseconds duration) = 0;
+};
+
+// 真实时钟（steady_clock，从创建时开始计时）
+class SteadyEventClock : public EventClock {
+public:
+  uint64_t nowUs() const override {
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(
+                                     std::chrono::steady_clock::now() - epoch_)
+                                     .count());
+  }
+  void sleepFor(std::chrono::microseconds duration) override {
+    std::this_thread::sleep_for(duration);
+  }
+
+private:
+  std::chrono::steady_clock::time_point epoch_ = std::chrono::steady_clock::now();
+};
+
+// 虚拟时钟：等待只推进时间不睡眠，由回放驱动按事件时间戳推进（只前进不后退）
+class VirtualEventClock : public EventClock {
+public:
+  uint64_t nowUs() const override { return now_.load(std::memory_order_relaxed); }
+  void sleepFor(std::chrono::microseconds duration) override {
+    now_.fetch_add(static_cast<uint64_t>(std::max<int64_t>(0, duration.count())),
+                   std::memory_order_relaxed);
+  }
+  void advanceTo(uint64_t us) {
+    uint64_t current = now_.load(std::memory_order_relaxed);
+    while (current < us && !now_.compare_exchange_weak(current, us, std::memory_order_relaxed)) {
+    }
+  }
+
+private:
+  std::atomic<uint64_t> now_{0};
+};
+
+#endif // WAYLYRICS_EVENT_CLOCK_H
@@ -0,0 +1,76 @@
+#ifndef WAYLYRICS_HTTP_CLIENT_H
+#define WAYLYRICS_HTTP_CLIENT_H
+// Filename: http_client.h
+// Description: 基于 libcurl 的同步 HTTP GET 封装：超时、带抖动的有限重试、按主机令牌桶限流和熔断
+// Author: awkee
+///////////////////////////////////////////////////////
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// HTTP 请求结果
+struct HttpResponse {
+  long status = 0;       // HTTP 状态码（网络错误时为 0）
+  std::string body;      // 响应内容
+  std::string error;     // curl 错误描述（成功时为空）
+  double elapsedMs = 0;  // 请求耗时（毫秒，含重试和限流等待）
+  bool cancelled = false; // 是否被取消标志中止
+  bool rejected = false;  // 熔断器打开，请求未发出
+  int attempts = 0;       // 实际发出的请求次数（含重试）
+
+  bool ok() const { return error.empty() && status == 200; }
+  // 服务端明确给出了结果（成功或 4xx，不含 429），可以据此判断“未找到”
+  bool definitive() const {
+    return error.empty() && status > 0 && status < 500 && status != 429;
+  }
+};
+
+// 网络弹性策略（进程内全局，按主机分别限流和熔断）
+struct HttpPolicy {
+  int connectTimeoutMs = 3000;  // 连接超时
+  int timeoutMs = 10000;        // 单次请求总超时
+  int retries = 2;              // 失败后最多重试次数（连接错误、超时、429、5xx）
+  int retryBaseMs = 250;        // 退避基数：第 n 次重试在 [0, base*2^n] 内随机等待
+  int retryMaxMs = 4000;        // 单次退避上限（Retry-After 超过该值时不再重试）
+  double retryBudget = 0.2;     // 重试预算：每个请求积累的重试额度，防止故障时重试放大流量
+  double rateLimit = 4;         // 令牌桶速率（请求/秒），0 表示不限流
+  int rateBurst = 8;            // 令牌桶容量（允许的突发请求数）
+  int breakerThreshold = 5;     // 连续失败多少次后熔断，0 表示不启用熔断
+  int breakerCooldownMs = 30000; // 熔断后多久放行一个探测请求
+};
+
+// 设置全局策略（插件初始化时调用）
+void setHttpPolicy(const HttpPolicy &policy);
+HttpPolicy httpPolicy();
+
+// 熔断器状态
+enum class BreakerState { Closed, Open, HalfOpen };
+
+// 单个主机的统计快照
+struct HttpHostStats {
+  std::string host;
+  BreakerState breaker = BreakerState::Closed;
+  int consecutiveFailures = 0;
+  uint64_t requests = 0;  // 发出的请求次数（含重试）
+  uint64_t retries = 0;   // 重试次数
+  uint64_t failures = 0;  // 重试后仍失败的查询次数（连接错误、超时、429、5xx）
+  uint64_t rejected = 0;  // 熔断拒绝次数
+  double throttledMs = 0; // 限流累计等待时间
+};
+std::vector<HttpHostStats> httpHostStats();
+
+// 同步阻塞 GET 请求，需要在后台线程中调用
+// 熔断器打开时立即返回（rejected），半开时只放行一个探测请求；
+// cancel 非空时在传输、限流等待和重试退避中轮询，置位后请求尽快中止；
+// reportOutcome 为 false 时不更新熔断器，由调用方对整次查询调用 reportHttpOutcome
+HttpResponse httpGet(const std::string &url,
+                     const std::atomic<bool> *cancel = nullptr,
+                     bool reportOutcome = true);
+
+// 一次逻辑查询（如对冲发出的多个请求）的最终结果只向熔断器报告一次：
+// 多个并发请求同时失败只算一次连续失败；cancelled 表示没有得到任何结果
+void reportHttpOutcome(const std::string &url, bool failed, bool cancelled = false);
+
+#endif // WAYLYRICS_HTTP_CLIENT_H
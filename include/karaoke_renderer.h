@@ -0,0 +1,50 @@
+#ifndef WAYLYRICS_KARAOKE_RENDERER_H
+#define WAYLYRICS_KARAOKE_RENDERER_H
+// Filename: karaoke_renderer.h
+// Description: 卡拉OK逐字高亮，通过 GTK 帧时钟回调只更新标签的 Pango 属性
+// Author: awkee
+///////////////////////////////////////////////////////
+
+#include "lyrics_timeline.h"
+#include "playback_clock.h"
+#include <cstddef>
+#include <cstdint>
+#include <gtk/gtk.h>
+#include <memory>
+#include <string>
+
+class KaraokeRenderer {
+public:
+  // fps: 最大刷新帧率；color: 已唱部分颜色（如 "#ffcc00"）
+  KaraokeRenderer(GtkLabel *label, std::shared_ptr<const PlaybackClock> clock,
+                  int fps, const std::string &color);
+  ~KaraokeRenderer();
+
+  // 以下方法必须在 GTK 主线程调用（标签文本更新之后）
+  // offset: 歌词在标签文本中的字节偏移；trackLengthMs: 歌曲时长（最后一行的结束时间）
+  void setLine(std::shared_ptr<const LyricsTimeline> timeline, size_t index,
+               size_t offset, uint64_t trackLengthMs);
+  void clear(); // 清除高亮并停止帧回调
+
+private:
+  static gboolean onTick(GtkWidget *widget, GdkFrameClock *frameClock,
+                         gpointer data);
+  void render(uint64_t positionMs); // 更新已唱部分的属性（无变化时跳过）
+  void startTicking();
+  void stopTicking();
+
+  GtkLabel *label_;                             // 弱引用，标签销毁后自动置空
+  std::shared_ptr<const PlaybackClock> clock_;  // 播放时钟
+  gint64 frameIntervalUs_;                      // 帧间隔上限（微秒）
+  PangoColor color_{0xffff, 0xcccc, 0x0000};    // 已唱部分颜色
+  std::shared_ptr<const LyricsTimeline> timeline_;
+  size_t index_ = LyricsTimeline::npos; // 当前行
+  size_t offset_ = 0;                   // 歌词在标签文本中的偏移
+  uint64_t trackLengthMs_ = 0;          // 歌曲时长
+  size_t lastSung_ = LyricsTimeline::npos; // 上次渲染的已唱字节数
+  size_t fullSung_ = 0;                 // 整行唱完时的已唱字节数（达到后停止帧回调）
+  guint tickId_ = 0;
+  gint64 lastFrameUs_ = 0;
+};
+
+#endif // WAYLYRICS_KARAOKE_RENDERER_H
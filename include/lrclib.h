@@ -0,0 +1,64 @@
+#ifndef WAYLYRICS_LRCLIB_H
+#define WAYLYRICS_LRCLIB_H
+// Filename: lrclib.h
+// Description: lrclib.net 响应解析：SAX 流式提取并为候选歌词打分
+// Author: awkee
+///////////////////////////////////////////////////////
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// 查询条件（来自 MPRIS 元数据），用于候选打分
+struct LrclibQuery {
+  std::string title;
+  std::string artist;
+  std::string album;
+  uint64_t durationMs = 0; // 歌曲时长（毫秒），0 表示未知
+};
+
+// 最佳候选结果
+struct LrclibMatch {
+  std::string syncedLyrics; // 最佳候选的同步歌词，无匹配时为空
+  int score = 0;            // 最佳候选得分
+  size_t candidates = 0;    // 响应中的候选数量
+};
+
+// 流式解析 /api/search（数组）或 /api/get（单个对象）的响应，不构建 JSON DOM；
+// 边解析边按 时长接近度、标题/艺术家匹配度、是否有同步歌词 打分，
+// 只保留得分最高候选的 syncedLyrics（plainLyrics 等字段不会被复制）
+LrclibMatch extractBestLyrics(std::string_view json, const LrclibQuery &query);
+
+// 单个查询阶段的记录
+struct LrclibStage {
+  std::string name;      // 阶段名称：get / search / search-clean / search-title
+  long status = 0;       // HTTP 状态码（0 表示网络错误或未发出请求）
+  double latencyMs = 0;  // 该阶段耗时（毫秒）
+  bool hit = false;      // 是否得到同步歌词
+  bool cancelled = false; // 更高优先级的阶段已命中，该阶段被取消
+  bool failed = false;    // 没有得到服务端的明确答复（网络错误、超时、熔断、429、5xx）
+};
+
+// 分阶段查询结果
+struct LrclibLookup {
+  std::string syncedLyrics;        // 命中时的同步歌词
+  std::vector<LrclibStage> stages; // 按优先级记录已发出的阶段（含被取消的阶段）
+  // 未命中且所有完成的阶段都失败：服务不可用，不能当作“没有歌词”
+  bool unavailable() const;
+};
+
+// 分阶段查询 lrclib（baseUrl 如 "https://lrclib.net"，便于指向本地测试服务）：
+//   1. /api/get    精确匹配（需要艺术家和时长），单对象响应，单独发出
+//   2. /api/search 按标题+艺术家模糊搜索（search）
+//   3. /api/search 按规范化标题（去掉 Remastered/Live 等装饰）+主艺术家搜索（search-clean）
+//   4. /api/search 只按规范化标题搜索（艺术家不匹配时的兜底，search-title）
+// 精确匹配未命中（或没有时长）后 search 和 search-title 同时发出；search-clean 在 search
+// 未命中或发出 hedgeDelayMs 后仍无结果时发出（对冲）。已发出的更高优先级阶段都未命中时
+// 才采用较低优先级的命中结果；有命中后不再发出新阶段，决出后其余请求通过 curl
+// 进度回调取消
+// 不查询 /api/get-cached：它只查 lrclib 自己的曲库，是 /api/get 的子集
+LrclibLookup lookupLrclib(const std::string &baseUrl, const LrclibQuery &query,
+                          int hedgeDelayMs = 250);
+
+#endif // WAYLYRICS_LRCLIB_H
@@ -0,0 +1,78 @@
+#ifndef WAYLYRICS_LYRICS_LIBRARY_H
+#define WAYLYRICS_LYRICS_LIBRARY_H
+// Filename: lyrics_library.h
+// Description: 本地歌词库索引：后台并行扫描歌词目录，持久化到缓存目录，inotify 增量更新
+// Author: awkee
+///////////////////////////////////////////////////////
+
+#include <atomic>
+#include <cstdint>
+#include <filesystem>
+#include <shared_mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+// 索引中的一个歌词文件（歌词内容不进入索引，命中后再 mmap 读取）
+struct LibraryEntry {
+  std::string path;
+  std::string title;    // [ti:] 标签，缺失时取自文件名 "<艺术家> - <标题>.lrc"
+  std::string artist;   // [ar:] 标签，缺失时取自文件名
+  uint64_t lengthMs = 0; // [length:] 标签，0 表示未知
+  int64_t mtime = 0;     // 文件修改时间（秒），用于启动时判断是否需要重新解析
+};
+
+// 本地歌词库
+//   start() 立即返回：后台线程先加载持久化索引（可立即查询），再按目录并行扫描，
+//   扫描期间只重新解析修改时间变化的文件，完成后写回索引文件，之后通过 inotify 增量更新
+//   lookup() 按 规范化标题+艺术家 哈希查找，同名多个文件时按时长最接近者选择
+class LyricsLibrary {
+public:
+  LyricsLibrary(std::vector<std::filesystem::path> dirs,
+                std::filesystem::path indexFile);
+  ~LyricsLibrary();
+  LyricsLibrary(const LyricsLibrary &) = delete;
+  LyricsLibrary &operator=(const LyricsLibrary &) = delete;
+
+  void start();
+  void stop();
+
+  // 查找歌词文件路径，未找到返回空字符串（durationMs 为 0 表示未知）
+  std::string lookup(const std::string &title, const std::string &artist,
+                     uint64_t durationMs) const;
+  size_t size() const;
+  bool ready() const { return ready_; } // 初次扫描是否完成
+
+private:
+  using EntryMap = std::unordered_map<std::string, LibraryEntry>;
+
+  void run();                     // 后台线程：加载 → 扫描 → 监听
+  bool loadIndex(EntryMap &entries) const;
+  void saveIndex();
+  EntryMap scanDirectories(const EntryMap &previous) const;
+  void watchLoop();
+  void addWatches(const std::filesystem::path &dir);
+  // 增量更新：重新解析或移除单个文件/目录
+  void updateFile(const std::string &path);
+  void removePath(const std::string &path);
+  // 在持有写锁时维护二级索引
+  void insertLocked(LibraryEntry entry);
+  void eraseLocked(const std::string &path);
+
+  std::vector<std::filesystem::path> dirs_;
+  std::filesystem::path indexFile_;
+  mutable std::shared_mutex mutex_;
+  EntryMap entries_;                                            // 路径 → 条目
+  std::unordered_map<std::string, std::vector<std::string>> byKey_;   // 标题+艺术家 → 路径
+  std::unordered_map<std::string, std::vector<std::string>> byTitle_; // 标题 → 路径
+  std::unordered_map<int, std::string> watches_; // inotify 监听描述符 → 目录
+  int inotifyFd_ = -1;
+  int wakeFd_ = -1; // eventfd，用于 stop() 唤醒监听线程
+  std::atomic<bool> running_{false};
+  std::atomic<bool> ready_{false};
+  std::atomic<bool> dirty_{false}; // 索引有未持久化的修改
+  std::thread thread_;
+};
+
+#endif // WAYLYRICS_LYRICS_LIBRARY_H
@@ -0,0 +1,110 @@
+#ifndef WAYLYRICS_LYRICS_PREFETCHER_H
+#define WAYLYRICS_LYRICS_PREFETCHER_H
+// Filename: lyrics_prefetcher.h
+// Description: 歌词预取：按 MPRIS TrackList 的后续曲目或历史播放顺序，在换歌前预热缓存
+// Author: awkee
+///////////////////////////////////////////////////////
+
+#include "player_manager.h"
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <filesystem>
+#include <functional>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+// 播放历史：记录每首歌之后实际播放的歌曲，用于没有 TrackList 的播放器预测下一首
+// 持久化为 TSV（<前一首键> <次数> <时间> <标题> <艺术家> <专辑> <时长> <地址>）
+class TrackHistory {
+public:
+  explicit TrackHistory(std::filesystem::path file) : file_(std::move(file)) {}
+
+  void load();
+  // 取出要保存的行并清除 dirty 标记（在调用方的锁内执行，只复制内存中的记录）
+  std::vector<std::string> snapshot() const;
+  // 写入历史文件（在锁外执行，不阻塞 record/predict）
+  void write(const std::vector<std::string> &rows) const;
+  // 记录一次换歌：from 之后播放了 next
+  void record(const std::string &fromKey, const PlayerMetadata &next);
+  // 预测 from 之后的歌曲（按出现次数从多到少）
+  std::vector<PlayerMetadata> predict(const std::string &fromKey, size_t limit) const;
+  bool dirty() const { return dirty_; }
+
+private:
+  struct Successor {
+    PlayerMetadata metadata;
+    uint32_t count = 0;
+    int64_t lastSeen = 0; // 最后一次出现的时间（秒）
+  };
+  void trim(); // 超过容量时淘汰最久未出现的记录
+
+  std::filesystem::path file_;
+  std::unordered_map<std::string, std::vector<Successor>> successors_;
+  mutable bool dirty_ = false;
+};
+
+// 预取参数
+struct PrefetchOptions {
+  size_t depth = 2;          // 每次预取的后续曲目数
+  int lookaheadMs = 30000;   // 没有 TrackList 时，在当前歌曲结束前多久按历史预测预取
+  size_t concurrency = 1;    // 预取并发数（工作线程数）
+};
+
+// 歌词预取器
+//   换歌时先尝试从 TrackList 读取后续曲目并立即排队；播放器不提供 TrackList 时，
+//   在播放时钟接近歌曲末尾（lookaheadMs）时按播放历史预测下一首。
+//   预取在低优先级工作线程中执行，前台查询进行中时暂停等待，队列有上限且换歌时清空。
+class LyricsPrefetcher {
+public:
+  using FetchFn = std::function<void(const PlayerMetadata &)>; // 预热缓存
+  using UpcomingFn = std::function<std::vector<PlayerMetadata>(size_t)>; // 读取 TrackList
+  using BusyFn = std::function<bool()>; // 前台查询是否进行中
+
+  LyricsPrefetcher(FetchFn fetch, UpcomingFn upcoming, BusyFn busy,
+                   std::filesystem::path historyFile, PrefetchOptions options);
+  ~LyricsPrefetcher();
+  LyricsPrefetcher(const LyricsPrefetcher &) = delete;
+  LyricsPrefetcher &operator=(const LyricsPrefetcher &) = delete;
+
+  // 停止工作线程并保存播放历史（可重复调用）；之后的通知只更新状态，不再预取
+  void stop();
+  // 换歌（D-Bus 线程调用，不阻塞）：记录历史，清空过期队列，请求读取 TrackList
+  void onTrackChanged(const PlayerMetadata &metadata);
+  // 播放进度/状态变化：重新安排曲末预取时间，暂停或停止时取消
+  void onPlayback(uint64_t positionMs, int64_t lengthMs, bool playing);
+
+private:
+  using Clock = std::chrono::steady_clock;
+  void workerLoop();
+  void enqueueLocked(std::vector<PlayerMetadata> tracks);
+  // 保存播放历史：锁内取快照，锁外写文件（lock 持有 mutex_，返回时仍持有）
+  void saveHistory(std::unique_lock<std::mutex> &lock);
+
+  FetchFn fetch_;
+  UpcomingFn upcoming_;
+  BusyFn busy_;
+  PrefetchOptions options_;
+  TrackHistory history_;
+  std::mutex mutex_;
+  std::mutex saveMutex_;      // 串行化历史文件写入
+  uint64_t snapshotSeq_ = 0;  // 历史快照序号（mutex_ 保护）
+  uint64_t savedSeq_ = 0;     // 已写入的最新快照序号（saveMutex_ 保护），更旧的快照不再写入
+  std::condition_variable cv_;
+  std::deque<PlayerMetadata> queue_;
+  std::vector<std::string> queuedKeys_;        // 当前歌曲已排队过的键，避免重复预取
+  std::string currentKey_;                     // 当前歌曲的规范化键
+  uint64_t generation_ = 0;                    // 换歌计数，过期的 TrackList 结果被丢弃
+  bool upcomingPending_ = false;               // 需要读取 TrackList
+  bool hasTrackList_ = false;                  // 当前播放器提供了后续曲目
+  std::optional<Clock::time_point> lookaheadAt_; // 曲末预取时间
+  bool stopping_ = false;
+  std::vector<std::thread> workers_;
+};
+
+#endif // WAYLYRICS_LYRICS_PREFETCHER_H
@@ -0,0 +1,176 @@
+#ifndef WAYLYRICS_LYRICS_PROVIDER_H
+#define WAYLYRICS_LYRICS_PROVIDER_H
+// Filename: lyrics_provider.h
+// Description: 歌词来源接口与可配置的查询链（顺序/并行截止时间，按耗时和命中率自适应排序）
+// Author: awkee
+///////////////////////////////////////////////////////
+
+#include "player_manager.h"
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// 歌词来源接口：fetch 可能在任意后台线程调用，实现需保证线程安全
+class LyricsProvider {
+public:
+  virtual ~LyricsProvider() = default;
+  // 来源名称（与配置项 providers 中的名称一致，用于日志和统计）
+  virtual std::string name() const = 0;
+  // 查询同步歌词，未找到返回空字符串；网络等错误可抛出异常（计入错误统计）
+  virtual std::string fetch(const PlayerMetadata &metadata) = 0;
+  // 结果是否需要写入本地缓存（播放器自带、本地文件等来源无需缓存）
+  virtual bool cacheable() const { return true; }
+  // 是否为本地来源（不访问网络），本地来源总是先于网络来源按配置顺序查询
+  virtual bool local() const { return false; }
+};
+
+// 播放器元数据中的歌词（musicfox 通过 xesam:asText 直接提供）
+class PlayerMetadataProvider : public LyricsProvider {
+public:
+  std::string name() const override { return "player"; }
+  std::string fetch(const PlayerMetadata &metadata) override {
+    return metadata.lyrics;
+  }
+  bool cacheable() const override { return false; }
+  bool local() const override { return true; }
+};
+
+// 本地 .lrc 歌词文件（mmap 读取），依次查找：
+//   1. 音频文件同目录下的 <文件名>.lrc（来自 xesam:url）
+//   2. 歌词目录中的 <文件名>.lrc
+//   3. 歌词目录中的 "<艺术家> - <标题>.lrc" 和 "<标题>.lrc"（无本地地址的播放器）
+class SidecarLrcProvider : public LyricsProvider {
+public:
+  explicit SidecarLrcProvider(std::vector<std::filesystem::path> lyricsDirs)
+      : lyricsDirs_(std::move(lyricsDirs)) {}
+  std::string name() const override { return "file"; }
+  std::string fetch(const PlayerMetadata &metadata) override;
+  bool cacheable() const override { return false; }
+  bool local() const override { return true; }
+
+private:
+  std::vector<std::filesystem::path> lyricsDirs_;
+};
+
+class LyricsLibrary;
+
+// 本地歌词库索引（lyrics-dirs 目录树），按规范化标题/艺术家哈希查找后 mmap 读取
+class LibraryProvider : public LyricsProvider {
+public:
+  explicit LibraryProvider(std::shared_ptr<LyricsLibrary> library)
+      : library_(std::move(library)) {}
+  std::string name() const override { return "library"; }
+  std::string fetch(const PlayerMetadata &metadata) override;
+  bool cacheable() const override { return false; }
+  bool local() const override { return true; }
+
+private:
+  std::shared_ptr<LyricsLibrary> library_;
+};
+
+// 音频文件标签中内嵌的同步歌词（ID3 SYLT/USLT、Vorbis 注释、MP4 ©lyr），来自 xesam:url
+class EmbeddedTagProvider : public LyricsProvider {
+public:
+  std::string name() const override { return "tags"; }
+  std::string fetch(const PlayerMetadata &metadata) override;
+  bool cacheable() const override { return false; }
+  bool local() const override { return true; }
+};
+
+// lrclib 分阶段查询（/api/get → /api/search 变体对冲）
+class LrclibProvider : public LyricsProvider {
+public:
+  explicit LrclibProvider(std::string baseUrl) : baseUrl_(std::move(baseUrl)) {}
+  std::string name() const override { return "lrclib"; }
+  std::string fetch(const PlayerMetadata &metadata) override;
+
+private:
+  std::string baseUrl_;
+};
+
+// 通过 URL 模板查询任意 HTTP 歌词服务
+// 模板支持 {title} {artist} {album} {duration}（秒） {duration_ms}，值会做 URL 编码；
+// 响应为 LRC 文本，或与 lrclib 格式兼容的 JSON（对象或数组，取 syncedLyrics 得分最高者）
+class UrlTemplateProvider : public LyricsProvider {
+public:
+  UrlTemplateProvider(std::string name, std::string urlTemplate)
+      : name_(std::move(name)), urlTemplate_(std::move(urlTemplate)) {}
+  std::string name() const override { return name_; }
+  std::string fetch(const PlayerMetadata &metadata) override;
+
+private:
+  std::string name_;
+  std::string urlTemplate_;
+};
+
+// 单个来源的统计
+struct ProviderStats {
+  std::string name;
+  uint64_t calls = 0;     // 查询次数
+  uint64_t hits = 0;      // 命中次数
+  uint64_t errors = 0;    // 异常次数
+  double latencyMs = 0;   // 耗时（指数加权平均，毫秒）
+
+  // 期望代价：平均耗时 / 平滑后的命中率，越小越优先；未查询过的来源为 0（优先试探）
+  double cost() const {
+    return latencyMs * static_cast<double>(calls + 2) / static_cast<double>(hits + 1);
+  }
+};
+
+// 查询结果
+struct LyricsResult {
+  std::string lyrics;    // 歌词文本，未找到为空
+  std::string provider;  // 命中的来源名称
+  bool cacheable = false; // 是否需要写入本地缓存
+  // 所有来源都出错或超时（网络不可用、熔断）：未找到不代表没有歌词，稍后应重试
+  bool failed = false;
+};
+
+// 歌词来源查询链
+//   本地来源（local()）总是先按配置顺序逐个查询，不参与并行和重新排序
+//   网络来源：
+//   deadlineMs == 0：按顺序查询，第一个非空结果即返回
+//   deadlineMs  > 0：所有来源并行查询，第一个非空结果即返回（先到先得），
+//                    超过截止时间仍无结果则返回空；未完成的查询在后台结束后只更新统计
+//   adaptive：每次查询前按 ProviderStats::cost() 重新排序（代价相同保持配置顺序）
+class LyricsProviderChain {
+public:
+  LyricsProviderChain(std::vector<std::shared_ptr<LyricsProvider>> providers,
+                      int deadlineMs, bool adaptive);
+
+  LyricsResult fetch(const PlayerMetadata &metadata); // 本地来源 + 网络来源
+  LyricsResult fetchLocal(const PlayerMetadata &metadata);  // 只查询本地来源
+  LyricsResult fetchRemote(const PlayerMetadata &metadata); // 只查询网络来源
+  std::vector<ProviderStats> stats() const; // 按当前查询顺序返回统计快照
+  bool empty() const;
+
+private:
+  struct Slot {
+    std::shared_ptr<LyricsProvider> provider;
+    ProviderStats stats;
+  };
+  // 并行模式下后台线程可能比查询链存活更久，统计放在共享状态中
+  struct Shared {
+    mutable std::mutex mutex;
+    std::vector<Slot> slots;
+  };
+
+  std::vector<size_t> order(bool local) const; // 本地或网络来源的查询顺序
+  LyricsResult fetchSequential(const PlayerMetadata &metadata,
+                               const std::vector<size_t> &order);
+  LyricsResult fetchParallel(const PlayerMetadata &metadata,
+                             const std::vector<size_t> &order);
+  // 执行一次查询并记录统计（异常计入错误并返回空，failed 非空时返回是否出错）
+  static std::string runProvider(Shared &shared, size_t index,
+                                 const PlayerMetadata &metadata,
+                                 bool *failed = nullptr);
+
+  std::shared_ptr<Shared> shared_;
+  int deadlineMs_;
+  bool adaptive_;
+};
+
+#endif // WAYLYRICS_LYRICS_PROVIDER_H
@@ -0,0 +1,64 @@
+#ifndef WAYLYRICS_LYRICS_SERVICE_H
+#define WAYLYRICS_LYRICS_SERVICE_H
+// Filename: lyrics_service.h
+// Description: 歌词 D-Bus 服务：在会话总线上导出 org.waylyrics，供锁屏、通知、OBS 脚本等复用当前歌词
+// Author: awkee
+///////////////////////////////////////////////////////
+
+#include "lyrics_timeline.h"
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <sdbus-c++/sdbus-c++.h>
+#include <string>
+
+/*
+ * 总线名 org.waylyrics，对象 /org/waylyrics，接口 org.waylyrics.Lyrics：
+ *   属性  TrackKey s / Title s / Artist s      当前歌曲（TrackKey 与缓存使用同一个规范化键）
+ *         CurrentLine s / CurrentLineIndex i   当前歌词行（无歌词时为 "" / -1）
+ *         NextLineTime x                       下一行开始时间（毫秒，播放位置坐标，没有下一行为 -1）
+ *         Timeline a(tsss)                     完整时间轴（开始时间、原文、翻译、罗马音），
+ *                                              已应用 [offset:] 和同步偏移；变更时只发送失效通知
+ *   信号  LineChanged(i index, s text, t timeMs, x nextTimeMs)
+ *   方法  Lookup(s title, s artist, i durationSec) -> s lyrics
+ *         按与模块相同的来源链和缓存查询 LRC 歌词（未找到返回空字符串），在后台线程执行，
+ *         与模块自己的同一首歌查询合并
+ * 所有状态来自刷新线程已解析好的时间轴，服务本身不解析歌词；只在行或歌曲变化时发出信号
+ */
+class LyricsService {
+public:
+  // 查询歌词（在工作线程中调用，可阻塞）
+  using LookupFn = std::function<std::string(const std::string &title,
+                                             const std::string &artist, int64_t durationMs)>;
+
+  // 申请总线名失败（如已有实例占用）时抛出 sdbus::Error
+  LyricsService(sdbus::IConnection &connection, LookupFn lookup);
+  ~LyricsService(); // 释放总线名并等待进行中的 Lookup 结束
+
+  // 刷新线程每次刷新时调用：与上次发布的状态比较，只在歌曲、时间轴或当前行变化时发出通知
+  void publish(const std::string &trackKey, const std::string &title, const std::string &artist,
+               std::shared_ptr<const LyricsTimeline> timeline, uint64_t positionMs);
+
+private:
+  void handleLookup(sdbus::Result<std::string> &&result, std::string title,
+                    std::string artist, int32_t durationSec);
+
+  sdbus::IConnection &connection_;
+  LookupFn lookup_;
+  std::unique_ptr<sdbus::IObject> object_;
+
+  mutable std::mutex mutex_; // 保护以下发布状态（属性 getter 在 D-Bus 线程读取）
+  std::string trackKey_;
+  std::string title_;
+  std::string artist_;
+  std::shared_ptr<const LyricsTimeline> timeline_;
+  size_t lineIndex_ = LyricsTimeline::npos;
+
+  std::mutex lookupMutex_;
+  std::condition_variable lookupDone_;
+  int activeLookups_ = 0; // 进行中的 Lookup 线程数（超过上限时直接返回错误）
+};
+
+#endif // WAYLYRICS_LYRICS_SERVICE_H
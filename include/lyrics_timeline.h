@@ -0,0 +1,158 @@
+#ifndef WAYLYRICS_LYRICS_TIMELINE_H
+#define WAYLYRICS_LYRICS_TIMELINE_H
+// Filename: lyrics_timeline.h
+// Description: 歌词时间轴，由 LRC 文本解析得到，按时间排序，支持逐字时间
+// Author: awkee
+///////////////////////////////////////////////////////
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// 逐字时间（增强LRC中的 <mm:ss.xx> 标签）
+struct LyricWord {
+  uint64_t startMs; // 该字/词开始演唱的时间（毫秒）
+  uint32_t begin;   // 在 LyricLine::text 中的字节起始偏移
+  uint32_t end;     // 在 LyricLine::text 中的字节结束偏移（不含）
+};
+
+// 一行歌词
+struct LyricLine {
+  uint64_t timeMs = 0;          // 行开始时间（毫秒）
+  uint64_t endMs = 0;           // 逐字时间的结束标签（0 表示未给出）
+  std::string text;             // 去掉时间标签后的歌词文本（原文）
+  std::string translation;      // 同一时间戳的翻译行（双语歌词）
+  std::string romanization;     // 同一时间戳的罗马音行
+  std::vector<LyricWord> words; // 逐字时间，为空表示普通LRC行
+
+  // 预计算的显示信息（解析时按 max-length 计算一次，刷新时不再测量）
+  uint32_t width = 0;             // 原文显示宽度（列，CJK全角占2列）
+  std::string fitted;             // 超长时截断后的原文，未超长为空
+  std::string fittedTranslation;  // 超长时截断后的翻译，未超长为空
+  std::string fittedRomanization; // 超长时截断后的罗马音，未超长为空
+
+  std::string_view displayText() const { return fitted.empty() ? text : fitted; }
+  // displayText() 中与 text 相同的前缀字节数（截断时不含末尾的省略号）
+  size_t displayPrefix() const {
+    return fitted.empty() ? text.size() : fitted.size() - (sizeof("…") - 1);
+  }
+  std::string_view displayTranslation() const {
+    return fittedTranslation.empty() ? translation : fittedTranslation;
+  }
+  std::string_view displayRomanization() const {
+    return fittedRomanization.empty() ? romanization : fittedRomanization;
+  }
+};
+
+class LyricsTimeline {
+public:
+  static constexpr size_t npos = static_cast<size_t>(-1);
+
+  std::vector<LyricLine> lines; // 按 timeMs 升序排列（已应用 [offset:]）
+
+  // LRC 元数据标签 [ti:] [ar:] [al:] [by:] [length:] [offset:]
+  std::string title;
+  std::string artist;
+  std::string album;
+  std::string by;
+  uint64_t lengthMs = 0;
+  int64_t offsetMs = 0;
+  int64_t syncOffsetMs = 0; // 解析时叠加的同步校准偏移（按播放器/歌曲保存的用户校准值）
+  size_t maxColumns = 0;    // 解析时每行（原文/翻译/罗马音分别）截断到的列数，0 表示未截断
+
+  bool empty() const { return lines.empty(); }
+
+  // 查找 posMs 时刻应显示的行：最后一个 timeMs < posMs 的行
+  // 还未到第一行时返回第一行（与旧的 getSyncedLine 行为一致），无歌词返回 npos
+  size_t indexAt(uint64_t posMs) const {
+    if (lines.empty()) {
+      return npos;
+    }
+    auto it = std::lower_bound(
+        lines.begin(), lines.end(), posMs,
+        [](const LyricLine &line, uint64_t pos) { return line.timeMs < pos; });
+    if (it == lines.begin()) {
+      return 0;
+    }
+    return static_cast<size_t>(it - lines.begin()) - 1;
+  }
+
+  // 行结束时间：优先逐字结束标签，其次下一行开始时间，最后一行使用 trackLength
+  uint64_t lineEndMs(size_t index, uint64_t trackLength = 0) const {
+    if (index >= lines.size()) {
+      return 0;
+    }
+    const auto &line = lines[index];
+    if (line.endMs > line.timeMs) {
+      return line.endMs;
+    }
+    if (index + 1 < lines.size()) {
+      return lines[index + 1].timeMs;
+    }
+    return std::max(trackLength, line.timeMs);
+  }
+
+  // 计算 posMs 时刻第 index 行已唱部分在 displayText() 中的字节长度（按UTF-8字符边界对齐，
+  // 不超过截断前缀）；当前字按时间线性插值，便于卡拉OK效果平滑推进。
+  // trackLength 为歌曲时长，用于确定最后一行最后一个字的结束时间
+  size_t sungBytes(size_t index, uint64_t posMs, uint64_t trackLength = 0) const {
+    if (index >= lines.size()) {
+      return 0;
+    }
+    const auto &line = lines[index];
+    return std::min(sungTextBytes(index, posMs, trackLength), line.displayPrefix());
+  }
+
+private:
+  // sungBytes 的未截断版本：已唱部分在 text 中的字节长度
+  size_t sungTextBytes(size_t index, uint64_t posMs, uint64_t trackLength) const {
+    const auto &line = lines[index];
+    const auto &words = line.words;
+    if (words.empty() || posMs < words.front().startMs) {
+      return 0;
+    }
+    for (size_t i = 0; i < words.size(); ++i) {
+      const auto &word = words[i];
+      uint64_t wordEnd = i + 1 < words.size() ? words[i + 1].startMs
+                                              : lineEndMs(index, trackLength);
+      if (posMs >= wordEnd) {
+        continue;
+      }
+      if (posMs < word.startMs) {
+        return word.begin;
+      }
+      // 当前正在演唱的字：按时间比例插值，并回退到UTF-8字符起始位置
+      size_t len = word.end - word.begin;
+      uint64_t span = wordEnd - word.startMs;
+      size_t cut = span ? static_cast<size_t>(len * (posMs - word.startMs) / span)
+                        : len;
+      size_t pos = word.begin + cut;
+      while (pos > word.begin && pos < line.text.size() &&
+             (static_cast<unsigned char>(line.text[pos]) & 0xC0) == 0x80) {
+        --pos;
+      }
+      return pos;
+    }
+    return words.back().end;
+  }
+};
+
+// 解析时间标签内容（不含括号），支持 "mm:ss"、"mm:ss.xx"、"mm:ss.xxx"
+// 成功返回 true，结果写入 ms
+bool parseLrcTimeTag(std::string_view tag, uint64_t &ms);
+
+// 解析LRC文本，直接在原始缓冲区的 string_view 上工作，只为歌词正文分配一次内存
+// 支持：一行多个时间标签（展开为多行）、[offset:]、元数据标签、增强LRC逐字时间、
+// 同一时间戳的多行歌词合并为 原文/翻译/罗马音
+// maxColumns > 0 时为每行预计算显示宽度和截断文本
+// syncOffsetMs 与 [offset:] 叠加后一次性应用到所有时间（正数表示歌词提前），刷新时没有额外开销
+// 返回不可变的时间轴，供多线程共享
+std::shared_ptr<const LyricsTimeline> parseLrc(std::string_view raw,
+                                               size_t maxColumns = 0,
+                                               int64_t syncOffsetMs = 0);
+
+#endif // WAYLYRICS_LYRICS_TIMELINE_H
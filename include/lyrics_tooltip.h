@@ -0,0 +1,52 @@
+#ifndef WAYLYRICS_LYRICS_TOOLTIP_H
+#define WAYLYRICS_LYRICS_TOOLTIP_H
+// Filename: lyrics_tooltip.h
+// Description: 歌词工具提示，悬停时按需生成 上N行/当前行/下N行 + 歌曲信息
+// Author: awkee
+///////////////////////////////////////////////////////
+
+#include "lyrics_timeline.h"
+#include <cstddef>
+#include <functional>
+#include <gtk/gtk.h>
+#include <memory>
+#include <string>
+#include <unordered_map>
+
+// 工具提示所需的当前状态快照（由 WayLyrics 提供）
+struct TooltipSnapshot {
+  std::shared_ptr<const LyricsTimeline> timeline;
+  std::string title;
+  std::string artist;
+  uint64_t position = 0;
+};
+
+// 只在 GTK 触发 query-tooltip 时才生成内容，无人悬停时没有任何开销；
+// 每行的 Pango markup 按行号缓存，时间轴变化时清空
+class LyricsTooltip {
+public:
+  // contextLines: 当前行前后各显示的行数；footer: 附加在末尾的静态文本（tooltip-format）
+  LyricsTooltip(GtkWidget *widget, std::function<TooltipSnapshot()> snapshot,
+                int contextLines, const std::string &footer);
+  ~LyricsTooltip();
+
+private:
+  static gboolean onQueryTooltip(GtkWidget *widget, gint x, gint y,
+                                 gboolean keyboardMode, GtkTooltip *tooltip,
+                                 gpointer data);
+  const std::string &lineMarkup(size_t index); // 获取（或生成并缓存）单行markup
+  std::string buildMarkup(const TooltipSnapshot &snapshot);
+
+  GtkWidget *widget_; // 弱引用，部件销毁后自动置空
+  std::function<TooltipSnapshot()> snapshot_;
+  int contextLines_;
+  std::string footer_; // 已转义的静态文本
+  gulong handler_ = 0;
+  std::shared_ptr<const LyricsTimeline> timeline_; // 缓存对应的时间轴
+  std::unordered_map<size_t, std::string> lineCache_; // 行号 → markup
+  size_t lastIndex_ = LyricsTimeline::npos;          // 上次生成时的当前行
+  std::string lastTrack_;                            // 上次生成时的歌曲信息
+  std::string lastMarkup_;                           // 上次生成的完整markup
+};
+
+#endif // WAYLYRICS_LYRICS_TOOLTIP_H
@@ -0,0 +1,53 @@
+#ifndef WAYLYRICS_MAPPED_FILE_H
+#define WAYLYRICS_MAPPED_FILE_H
+// Filename: mapped_file.h
+// Description: 只读内存映射文件，用于零拷贝读取本地歌词和音频标签
+// Author: awkee
+///////////////////////////////////////////////////////
+
+#include <cstddef>
+#include <fcntl.h>
+#include <string>
+#include <string_view>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// 打开失败、不是普通文件或文件为空时 valid() 返回 false，不抛出异常
+// （本地歌词是可选来源，找不到文件属于正常情况）
+class MappedFile {
+public:
+  explicit MappedFile(const std::string &path) {
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+      return;
+    }
+    struct stat st {};
+    if (::fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0) {
+      void *data = ::mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ,
+                          MAP_PRIVATE, fd, 0);
+      if (data != MAP_FAILED) {
+        data_ = static_cast<const char *>(data);
+        size_ = static_cast<size_t>(st.st_size);
+      }
+    }
+    ::close(fd); // 映射建立后即可关闭文件描述符
+  }
+  ~MappedFile() {
+    if (data_) {
+      ::munmap(const_cast<char *>(data_), size_);
+    }
+  }
+  MappedFile(const MappedFile &) = delete;
+  MappedFile &operator=(const MappedFile &) = delete;
+
+  bool valid() const { return data_ != nullptr; }
+  size_t size() const { return size_; }
+  std::string_view view() const { return {data_, size_}; }
+
+private:
+  const char *data_ = nullptr;
+  size_t size_ = 0;
+};
+
+#endif // WAYLYRICS_MAPPED_FILE_H
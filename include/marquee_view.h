@@ -0,0 +1,55 @@
+#ifndef WAYLYRICS_MARQUEE_VIEW_H
+#define WAYLYRICS_MARQUEE_VIEW_H
+// Filename: marquee_view.h
+// Description: 跑马灯歌词显示，超长歌词行在其显示时间内平滑滚动
+// Author: awkee
+///////////////////////////////////////////////////////
+
+#include "playback_clock.h"
+#include <cstdint>
+#include <gtk/gtk.h>
+#include <memory>
+#include <string>
+
+// 使用 GtkDrawingArea 绘制缓存的 PangoLayout，每帧只改变绘制偏移，
+// 文本只在歌词行切换时重新排版；暂停、隐藏（unmap）时停止帧回调
+class MarqueeView {
+public:
+  // area: 绘制区域；maxColumns: 可见宽度（列）；fps: 最大刷新帧率
+  MarqueeView(GtkWidget *area, std::shared_ptr<const PlaybackClock> clock,
+              int maxColumns, int fps);
+  ~MarqueeView();
+
+  // GTK线程调用：设置显示文本及该行的显示时间段（毫秒，均为0表示不滚动）
+  void setText(const std::string &text, uint64_t startMs, uint64_t endMs);
+  GtkWidget *widget() const { return area_; } // 部件已销毁时返回 nullptr
+
+private:
+  static gboolean onDraw(GtkWidget *widget, cairo_t *cr, gpointer data);
+  static gboolean onTick(GtkWidget *widget, GdkFrameClock *frameClock,
+                         gpointer data);
+  static void onMap(GtkWidget *widget, gpointer data);
+  static void onUnmap(GtkWidget *widget, gpointer data);
+  int offsetAt(uint64_t positionMs) const; // 计算当前滚动偏移（像素）
+  void updateTicking();                    // 根据溢出/播放/可见状态启停帧回调
+  void stopTicking();
+
+  GtkWidget *area_;                            // 弱引用，部件销毁后自动置空
+  std::shared_ptr<const PlaybackClock> clock_;
+  gint64 frameIntervalUs_;
+  int visibleWidth_ = 0;        // 可见宽度（像素）
+  PangoLayout *layout_ = nullptr; // 当前行的缓存排版
+  std::string text_;            // 当前行文本（用于判断是否需要重新排版）
+  int textWidth_ = 0;           // 当前行排版宽度（像素）
+  int textHeight_ = 0;
+  uint64_t startMs_ = 0;
+  uint64_t endMs_ = 0;
+  int offset_ = 0;              // 当前绘制偏移（像素）
+  guint tickId_ = 0;
+  gint64 lastFrameUs_ = 0;
+  gulong drawHandler_ = 0;
+  gulong mapHandler_ = 0;
+  gulong unmapHandler_ = 0;
+};
+
+#endif // WAYLYRICS_MARQUEE_VIEW_H
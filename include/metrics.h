@@ -0,0 +1,89 @@
+#ifndef WAYLYRICS_METRICS_H
+#define WAYLYRICS_METRICS_H
+// Filename: metrics.h
+// Description: 运行指标：无锁计数器和固定分桶的耗时直方图，按名称注册，可导出 JSON 快照
+// Author: awkee
+///////////////////////////////////////////////////////
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <nlohmann/json_fwd.hpp>
+#include <string>
+#include <vector>
+
+// 计数器（只增不减，relaxed 原子操作）
+class Counter {
+public:
+  void add(uint64_t n = 1) { value_.fetch_add(n, std::memory_order_relaxed); }
+  uint64_t value() const { return value_.load(std::memory_order_relaxed); }
+
+private:
+  std::atomic<uint64_t> value_{0};
+};
+
+// 耗时直方图（毫秒，固定分桶；最后一个桶收集超过最大上界的样本）
+class Histogram {
+public:
+  static constexpr std::array<double, 14> bounds = {
+      1, 2, 5, 10, 20, 50, 100, 200, 500, 1000, 2000, 5000, 10000, 30000};
+
+  struct Snapshot {
+    uint64_t count = 0;
+    double sumMs = 0;
+    std::array<uint64_t, bounds.size() + 1> buckets{};
+    // 按分桶线性插值估算分位数（q 取 0~1），无样本时为 0
+    double percentile(double q) const;
+  };
+
+  void observe(double ms);
+  Snapshot snapshot() const;
+
+private:
+  std::array<std::atomic<uint64_t>, bounds.size() + 1> buckets_{};
+  std::atomic<uint64_t> sumUs_{0}; // 总耗时（微秒）
+};
+
+// 作用域计时：析构时把经过的时间记入直方图
+class ScopedTimer {
+public:
+  explicit ScopedTimer(Histogram &histogram)
+      : histogram_(histogram), start_(std::chrono::steady_clock::now()) {}
+  ~ScopedTimer() {
+    histogram_.observe(std::chrono::duration<double, std::milli>(
+                           std::chrono::steady_clock::now() - start_)
+                           .count());
+  }
+  ScopedTimer(const ScopedTimer &) = delete;
+  ScopedTimer &operator=(const ScopedTimer &) = delete;
+
+private:
+  Histogram &histogram_;
+  std::chrono::steady_clock::time_point start_;
+};
+
+// 指标注册表（进程内全局）
+//   注册时加锁，返回的引用在进程生命周期内有效；调用方应缓存引用，热路径上只做原子加
+class MetricsRegistry {
+public:
+  Counter &counter(const std::string &name);
+  Histogram &histogram(const std::string &name);
+  // {"uptime_s":..,"counters":{..},"histograms":{name:{count,sum_ms,p50,p90,p99,bounds_ms,buckets}}}
+  nlohmann::json snapshot() const;
+  // 文本摘要，每个指标一行（用于日志）
+  std::vector<std::string> summary() const;
+
+private:
+  mutable std::mutex mutex_;
+  std::map<std::string, std::unique_ptr<Counter>> counters_;
+  std::map<std::string, std::unique_ptr<Histogram>> histograms_;
+  std::chrono::steady_clock::time_point started_ = std::chrono::steady_clock::now();
+};
+
+MetricsRegistry &metrics();
+
+#endif // WAYLYRICS_METRICS_H
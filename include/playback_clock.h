@@ -0,0 +1,62 @@
+#ifndef WAYLYRICS_PLAYBACK_CLOCK_H
+#define WAYLYRICS_PLAYBACK_CLOCK_H
+// Filename: playback_clock.h
+// Description: 播放时钟，根据最近一次从播放器获取的位置推算当前播放位置
+// Author: awkee
+///////////////////////////////////////////////////////
+
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+
+// D-Bus 只在状态变化时提供 Position，两次校准之间由本地单调时钟推算，
+// 这样刷新线程和 GTK 帧回调都可以随时读取精确到毫秒的播放位置
+class PlaybackClock {
+public:
+  // 用播放器返回的位置校准时钟
+  void reset(uint64_t positionMs, bool playing) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    basePosition_ = positionMs;
+    baseTime_ = std::chrono::steady_clock::now();
+    playing_ = playing;
+  }
+
+  // 播放/暂停切换时冻结或恢复推算
+  void setPlaying(bool playing) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (playing_ == playing) {
+      return;
+    }
+    basePosition_ = positionLocked();
+    baseTime_ = std::chrono::steady_clock::now();
+    playing_ = playing;
+  }
+
+  uint64_t positionMs() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return positionLocked();
+  }
+
+  bool isPlaying() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return playing_;
+  }
+
+private:
+  uint64_t positionLocked() const {
+    if (!playing_) {
+      return basePosition_;
+    }
+    auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now() - baseTime_);
+    return basePosition_ + static_cast<uint64_t>(elapsed.count());
+  }
+
+  mutable std::mutex mutex_;
+  uint64_t basePosition_ = 0;
+  std::chrono::steady_clock::time_point baseTime_ =
+      std::chrono::steady_clock::now();
+  bool playing_ = false;
+};
+
+#endif // WAYLYRICS_PLAYBACK_CLOCK_H
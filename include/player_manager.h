@@ -1,6 +1,7 @@
 #ifndef WAYLYRICS_PLAYER_MANAGER_H
 #define WAYLYRICS_PLAYER_MANAGER_H
 
+#include "event_clock.h"
 #include <cstdint>
 #include <functional>
 #include <memory>
@@ -9,6 +10,10 @@
 #include <string>
 #include <vector>
 
+class DbusRecorder;
+struct DbusEvent;
+struct PlayerSignal;
+
 // 播放器状态枚举（播放/暂停/停止）
 enum class PlaybackStatus { Playing, Paused, Stopped, Unknown };
 
@@ -18,8 +23,9 @@ struct PlayerMetadata {
   std::string title;   // 歌曲名
   std::string artist;  // 艺术家
   std::string album;   // 专辑
+  std::string url;     // 媒体地址（xesam:url，本地播放器为 file:// 路径）
   std::string lyrics;  // 歌词内容（仅musicfox直接从dbus获取，其他查询网络获取）
-  std::int64_t length; // 歌曲时长（毫秒）
+  std::int64_t length = 0; // 歌曲时长（毫秒）
 };
 
 enum class LoopStatus {
@@ -39,10 +45,20 @@ struct PlayerState {
 class PlayerManager {
 public:
   // 构造函数：传入D-Bus连接和状态变更回调（用于通知WayLyrics）
+  // recorder 非空时录制收到的信号和状态回复（见 dbus_recorder.h）
   PlayerManager(std::shared_ptr<sdbus::IConnection> dbusConn,
-                std::function<void(const PlayerState &)> stateCallback);
+                std::function<void(const PlayerState &)> stateCallback,
+                std::shared_ptr<DbusRecorder> recorder = nullptr);
+  // 回放：不连接 D-Bus，由 replay() 注入录制的事件，读取状态时由 stateSource 给出回复，
+  // 等待和时间戳使用 clock（通常为虚拟时钟）
+  PlayerManager(std::function<void(const PlayerState &)> stateCallback,
+                std::shared_ptr<EventClock> clock,
+                std::function<PlayerState(const std::string &)> stateSource);
   ~PlayerManager();
 
+  // 回放一个录制的事件（State 事件由 stateSource 消费，这里忽略）
+  void replay(const DbusEvent &event);
+
   // 启动D-Bus信号监听（NameOwnerChanged/PropertiesChanged）
   void startMonitoring();
   // 停止监听并清理资源
@@ -61,12 +77,18 @@ public:
   void setLoopStatus(LoopStatus status); // 设置循环模式
   void setShuffle(bool enable);          // 设置随机播放
   bool isShuffle() const;                // 获取随机播放状态
+  // 当前曲目之后的曲目（org.mpris.MediaPlayer2.TrackList），播放器不支持时返回空
+  std::vector<PlayerMetadata> getUpcomingTracks(size_t limit) const;
 
 private :
   // D-Bus信号处理函数
   void handleNameOwnerChanged(const std::string &name, const std::string &oldOwner,
                            const std::string &newOwner);
-  void handlePropertiesChanged(const sdbus::Signal &signal);
+  void handlePlayerSignal(const std::string &serviceName, const std::string &interfaceName,
+                          const PlayerSignal &signal);
+  // 加入启动时发现的播放器并读取一次当前播放器状态
+  void initPlayers(const std::vector<std::string> &names);
+  void record(DbusEvent event) const;
   void addNewPlayer(const std::string &playerName);
   std::vector<std::string> listPlayerNames();
   PlayerState getPlayerState() const; // 根据 currentPlayer_ 获取状态信息
@@ -84,6 +106,9 @@ private :
   std::string currentPlayer_; // 当前活跃的播放器名称
   bool isShuffle_ = false; // 随机播放标记
   std::function<void(const PlayerState &)> stateCallback_; // 状态变更回调（通知WayLyrics）
+  std::shared_ptr<EventClock> clock_ = std::make_shared<SteadyEventClock>(); // 等待和事件时间戳
+  std::shared_ptr<DbusRecorder> recorder_; // 事件录制（未启用为空）
+  std::function<PlayerState(const std::string &)> stateSource_; // 回放时的状态回复（否则为空）
 };
 
 #endif // WAYLYRICS_PLAYER_MANAGER_H
\ No newline at end of file
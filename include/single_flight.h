@@ -0,0 +1,65 @@
+#ifndef WAYLYRICS_SINGLE_FLIGHT_H
+#define WAYLYRICS_SINGLE_FLIGHT_H
+// Filename: single_flight.h
+// Description: 进行中请求合并：同一个键同时只执行一次，并发调用者共享同一个结果
+// Author: awkee
+///////////////////////////////////////////////////////
+
+#include <atomic>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <unordered_map>
+
+// 第一个调用者（leader）在自己的线程中执行 fn，之后到达的同键调用者等待并共享它的结果；
+// fn 抛出的异常会传递给所有等待者。执行结束后键即被移除，不缓存结果
+template <typename Key, typename Value, typename Hash = std::hash<Key>>
+class SingleFlight {
+public:
+  template <typename Fn> Value run(const Key &key, Fn &&fn) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    auto it = calls_.find(key);
+    if (it != calls_.end()) {
+      auto future = it->second;
+      lock.unlock();
+      ++joined_;
+      return future.get();
+    }
+    std::promise<Value> promise;
+    calls_.emplace(key, promise.get_future().share());
+    lock.unlock();
+    try {
+      Value value = fn();
+      promise.set_value(value);
+      finish(key);
+      return value;
+    } catch (...) {
+      promise.set_exception(std::current_exception());
+      finish(key);
+      throw;
+    }
+  }
+
+  // 该键是否有进行中的调用
+  bool pending(const Key &key) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return calls_.find(key) != calls_.end();
+  }
+
+  // 合并到进行中调用的次数（省下的重复请求数）
+  uint64_t joined() const { return joined_; }
+
+private:
+  void finish(const Key &key) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    calls_.erase(key);
+  }
+
+  mutable std::mutex mutex_;
+  std::unordered_map<Key, std::shared_future<Value>, Hash> calls_;
+  std::atomic<uint64_t> joined_{0};
+};
+
+#endif // WAYLYRICS_SINGLE_FLIGHT_H
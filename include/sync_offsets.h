@@ -0,0 +1,52 @@
+#ifndef WAYLYRICS_SYNC_OFFSETS_H
+#define WAYLYRICS_SYNC_OFFSETS_H
+// Filename: sync_offsets.h
+// Description: 歌词同步偏移：按播放器和歌曲保存用户校准的偏移，并学习每个播放器的默认偏移
+// Author: awkee
+///////////////////////////////////////////////////////
+
+#include <cstdint>
+#include <filesystem>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+// 偏移单位为毫秒，正数表示歌词提前显示（与 LRC 的 [offset:] 相同），在解析时间轴时一次性应用
+// 查找顺序：歌曲的校准值 → 播放器的学习默认值 → 配置的默认值
+//   播放器的学习默认值为该播放器已校准歌曲偏移的中位数（至少校准过 learnMinTracks 首歌），
+//   输出延迟（蓝牙耳机等）这类对所有歌曲相同的偏差校准几首歌后新歌曲即可自动套用
+// 持久化为 TSV（<播放器简称> <歌曲键哈希> <偏移> <最后调整时间>），每次调整后立即写入
+class SyncOffsets {
+public:
+  static constexpr size_t learnMinTracks = 3;
+
+  SyncOffsets(std::filesystem::path file, int64_t defaultMs);
+
+  int64_t offsetFor(const std::string &player, const std::string &trackKey) const;
+  // 在歌曲当前偏移上调整 deltaMs（首次调整从播放器默认值开始），返回新的偏移
+  int64_t adjust(const std::string &player, const std::string &trackKey, int64_t deltaMs);
+  // 清除歌曲的校准值，返回之后使用的偏移（播放器默认值）
+  int64_t reset(const std::string &player, const std::string &trackKey);
+  int64_t playerDefault(const std::string &player) const;
+
+private:
+  struct Entry {
+    int64_t offsetMs = 0;
+    int64_t lastUsed = 0; // 最后一次调整的时间（秒）
+  };
+  using TrackOffsets = std::unordered_map<uint64_t, Entry>; // 歌曲键哈希 -> 偏移
+
+  void load();
+  void save() const;
+  void learn(const std::string &player); // 重新计算播放器的学习默认值
+  void trim();                           // 超过容量时淘汰最久未调整的记录
+  int64_t playerDefaultLocked(const std::string &player) const;
+
+  std::filesystem::path file_;
+  int64_t defaultMs_;
+  mutable std::mutex mutex_;
+  std::unordered_map<std::string, TrackOffsets> players_; // 播放器简称 -> 歌曲偏移
+  std::unordered_map<std::string, int64_t> learned_;      // 播放器简称 -> 学习默认值
+};
+
+#endif // WAYLYRICS_SYNC_OFFSETS_H
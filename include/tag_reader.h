@@ -0,0 +1,28 @@
+#ifndef WAYLYRICS_TAG_READER_H
+#define WAYLYRICS_TAG_READER_H
+// Filename: tag_reader.h
+// Description: 无依赖的音频标签歌词读取（ID3v2 SYLT/USLT、FLAC/Ogg Vorbis 注释、MP4 ©lyr）
+// Author: awkee
+///////////////////////////////////////////////////////
+
+#include <string>
+#include <string_view>
+
+// 标签中读取到的歌词
+struct EmbeddedLyrics {
+  std::string lrc;     // LRC 文本（SYLT 已转换为 [mm:ss.xx] 行，可直接交给 parseLrc）
+  std::string source;  // 来源标签：SYLT / USLT / VORBIS / MP4，未找到为空
+};
+
+// 从音频文件内容中提取歌词（按文件头识别格式，只解析标签区域，不读取音频数据）
+//   MP3  : ID3v2.2/2.3/2.4 的 SYLT（毫秒时间戳）优先，其次 USLT
+//   FLAC : VORBIS_COMMENT 块中的 LYRICS / UNSYNCEDLYRICS / SYNCEDLYRICS
+//   Ogg  : Vorbis / Opus 注释头中的同名字段
+//   MP4  : moov.udta.meta.ilst.©lyr
+// 只返回带时间戳的歌词：不含时间标签的纯文本歌词无法同步显示，视为未找到
+EmbeddedLyrics readEmbeddedLyrics(std::string_view data);
+
+// 打开（mmap）并读取文件中的歌词，文件不存在或无法识别时返回空结果
+EmbeddedLyrics readEmbeddedLyricsFile(const std::string &path);
+
+#endif // WAYLYRICS_TAG_READER_H
@@ -0,0 +1,73 @@
+#ifndef WAYLYRICS_TRACE_H
+#define WAYLYRICS_TRACE_H
+// Filename: trace.h
+// Description: 轻量级追踪：作用域耗时区间写入每个线程的缓冲区，导出为 Chrome trace-event JSON
+// Author: awkee
+///////////////////////////////////////////////////////
+
+#include <atomic>
+#include <cstdint>
+#include <filesystem>
+#include <string>
+
+/*
+ * 用法:
+ *   TraceSpan span("getLyrics", metadata.title); // 作用域结束时记录一个完整区间（ph: X）
+ *   uint64_t id = traceAsyncBegin("track-change", title); // 跨线程的异步区间（ph: b/e）
+ *   traceAsyncEnd("track-change", id);
+ *
+ *   默认关闭，关闭时每个追踪点只有一次 relaxed 原子读取；开启后事件追加到本线程的缓冲区
+ *   （线程退出后事件仍保留到导出），traceStop() 时合并写出，可用 chrome://tracing 或
+ *   Perfetto 打开，一个文件即可看到换歌时 D-Bus、查询、解析和界面刷新各环节的耗时
+ */
+
+// 是否正在记录（由 traceStart/traceStop 切换）
+extern std::atomic<bool> traceActive;
+inline bool traceEnabled() { return traceActive.load(std::memory_order_relaxed); }
+
+// 开始记录（清空上一次的事件）
+void traceStart();
+// 停止记录并写出 JSON 文件，返回写出的事件数（写入失败返回 -1）
+long traceStop(const std::filesystem::path &file);
+// 设置当前线程在追踪中显示的名称（静态字符串；关闭时也可调用，开销很小）
+void traceThreadName(const char *name);
+
+// 异步区间：返回 id（追踪关闭时返回 0，traceAsyncEnd 对 0 不做任何事）
+uint64_t traceAsyncBegin(const char *name, const std::string &arg = {});
+void traceAsyncEnd(const char *name, uint64_t id);
+
+// 作用域区间（name 必须是静态字符串；arg 只在追踪开启时复制）
+class TraceSpan {
+public:
+  explicit TraceSpan(const char *name) {
+    if (traceEnabled()) {
+      begin(name, nullptr);
+    }
+  }
+  TraceSpan(const char *name, const std::string &arg) {
+    if (traceEnabled()) {
+      begin(name, &arg);
+    }
+  }
+  ~TraceSpan() { finish(); }
+  // 提前结束区间（之后析构不再记录）
+  void finish() {
+    if (session_) {
+      end();
+      session_ = 0;
+    }
+  }
+  TraceSpan(const TraceSpan &) = delete;
+  TraceSpan &operator=(const TraceSpan &) = delete;
+
+private:
+  void begin(const char *name, const std::string *arg);
+  void end();
+
+  const char *name_ = nullptr;
+  uint64_t session_ = 0; // 开始时的记录批次，0 表示未记录；跨批次的区间被丢弃
+  double startUs_ = 0;
+  std::string arg_;
+};
+
+#endif // WAYLYRICS_TRACE_H
@@ -0,0 +1,58 @@
+#ifndef WAYLYRICS_TRACK_KEY_H
+#define WAYLYRICS_TRACK_KEY_H
+// Filename: track_key.h
+// Description: 歌曲规范化键：缓存文件名、本地歌词库索引和网络查询变体共用同一套规范化规则
+// Author: awkee
+///////////////////////////////////////////////////////
+
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// 文本折叠：大小写折叠（拉丁/希腊/西里尔字母）、全角→半角、统一引号/破折号/方括号、
+// 去掉零宽字符、合并空白并去除首尾空白
+std::string foldText(std::string_view text);
+
+// 规范化标题：foldText 后去掉装饰后缀，如 "(Remastered 2011)" "- Live" "[Radio Edit]"
+// "(feat. X)" "(2011)"；Remix/Instrumental/Acoustic 等不同版本的标记会保留
+std::string canonicalTitle(std::string_view title);
+
+// 规范化艺术家：按 ; 、 " / " " x " feat. ft. vs 拆分多艺术家（逗号和 & 不拆分，保留
+// "Earth, Wind & Fire" 这样的乐队名），逐个 foldText 后排序去重，以 ", " 连接
+std::string canonicalArtist(std::string_view artist);
+
+// 主艺术家：拆分后的第一个艺术家（已折叠）
+std::string primaryArtist(std::string_view artist);
+
+// 歌曲键（标题 + 艺术家，均已规范化）
+struct TrackKey {
+  std::string title;
+  std::string artist;
+
+  std::string str() const { return title + '\x1f' + artist; }
+  uint64_t hash() const { return hashOf(str()); } // FNV-1a 64
+  static uint64_t hashOf(std::string_view key);    // 只有 str() 结果时使用
+  // 缓存文件相对路径："ab/ab0123456789cdef.lrc"，与标题中的 '/' 等字符无关，按哈希前缀分目录
+  std::filesystem::path cachePath() const;
+};
+
+// 键不含时长：缓存命中时还要比较时长，相差超过该值视为不同录音（现场版、加长版等）
+inline constexpr uint64_t kTrackLengthToleranceMs = 3000;
+
+// 标题中 "(feat. X)" 的艺术家会并入艺术家列表，与 "A feat. X" 形式的元数据得到同一个键
+TrackKey makeTrackKey(std::string_view title, std::string_view artist);
+
+// 网络查询变体（按优先级，去重）：
+//   1. 原始标题 + 原始艺术家
+//   2. 规范化标题 + 主艺术家
+//   3. 规范化标题（不带艺术家）
+struct QueryVariant {
+  std::string title;
+  std::string artist;
+};
+std::vector<QueryVariant> queryVariants(std::string_view title,
+                                        std::string_view artist);
+
+#endif // WAYLYRICS_TRACK_KEY_H
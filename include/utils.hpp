@@ -1,10 +1,13 @@
 #include "common.h"
+#include "lyrics_timeline.h"
 #include <algorithm>
 #include <cinttypes>
 #include <curl/curl.h>
+#include <filesystem>
 #include <fstream>
-#include <nlohmann/json.hpp>
+#include <initializer_list>
 #include <string>
+#include <string_view>
 #include <vector>
 inline std::vector<std::string> split(std::string s, std::string delimiter) {
   size_t pos_start = 0, pos_end, delim_len = delimiter.length();
@@ -39,6 +42,48 @@ inline std::string url_encode(const std::string &decoded) {
   return result;
 }
 
+inline std::string url_decode(const std::string &encoded) {
+  int length = 0;
+  const auto decoded_value = curl_easy_unescape(
+      nullptr, encoded.c_str(), static_cast<int>(encoded.length()), &length);
+  if (!decoded_value) {
+    return "";
+  }
+  std::string result(decoded_value, length);
+  curl_free(decoded_value);
+  return result;
+}
+
+// file:// 地址转换为本地路径（如 "file:///music/a%20b.mp3" → "/music/a b.mp3"），
+// 非本地地址返回空字符串
+inline std::string fileUrlToPath(const std::string &url) {
+  constexpr std::string_view scheme = "file://";
+  if (!url.starts_with(scheme)) {
+    return "";
+  }
+  std::string path = url_decode(url.substr(scheme.size()));
+  // 允许 file://localhost/path 形式
+  if (path.starts_with("localhost/")) {
+    path.erase(0, 9);
+  }
+  return path.starts_with("/") ? path : "";
+}
+
+// 展开路径开头的 ~ 或 $HOME（不检查路径是否存在）
+inline std::string expandHome(const std::string &path) {
+  const char *home = getenv("HOME");
+  if (!home) {
+    return path;
+  }
+  if (path == "~" || path.starts_with("~/")) {
+    return home + path.substr(1);
+  }
+  if (path == "$HOME" || path.starts_with("$HOME/")) {
+    return home + path.substr(5);
+  }
+  return path;
+}
+
 inline std::string replace_space(const std::string &str) {
   std::string result = str;
   std::replace(result.begin(), result.end(), ' ', '_');
@@ -85,128 +130,109 @@ inline std::string formatMilliseconds(uint64_t ms) {
 }
 
 // 将 "[MM:SS.ss]" 格式的时间字符串转换为毫秒数（如 "[04:58.94]" → 298940ms）
+// 同时支持 "[MM:SS]" 与毫秒精度 "[MM:SS.sss]"，解析由 parseLrcTimeTag 完成
 // 返回：成功时为毫秒数，失败时返回 0
-inline uint64_t timestampToMs(const std::string &timestampStr) {
-
-  // 步骤1：提取方括号内的时间部分（如 "[04:58.94]" → "04:58.94"）
+inline uint64_t timestampToMs(std::string_view timestampStr) {
   size_t start = timestampStr.find('[');
   size_t end = timestampStr.find(']');
-  if (start == std::string::npos || end == std::string::npos || start >= end) {
+  if (start == std::string_view::npos || end == std::string_view::npos ||
+      start >= end) {
     return 0;
   }
-  std::string timePart =
-      timestampStr.substr(start + 1, end - start - 1); // 提取 "04:58.94"
-
-  // 步骤2：按 ":" 和 "." 分割时间单元（支持 "MM:SS" 或 "MM:SS.ss"）
-  size_t colonPos = timePart.find(':');
-  size_t dotPos = timePart.find('.');
-  if (colonPos == std::string::npos) {
+  uint64_t ms = 0;
+  if (!parseLrcTimeTag(timestampStr.substr(start + 1, end - start - 1), ms)) {
     return 0;
   }
+  return ms;
+}
 
-  // 解析分钟（MM）
-  std::string minStr = timePart.substr(0, colonPos);
-  if (!std::all_of(minStr.begin(), minStr.end(), ::isdigit)) {
-    return 0;
-  }
-  int minutes = std::stoi(minStr);
-
-  // 解析秒（SS）
-  std::string secStr;
-  std::string centiSecStr = "0"; // 百分秒默认0
-  if (dotPos != std::string::npos) {
-    secStr = timePart.substr(colonPos + 1, dotPos - colonPos - 1);
-    centiSecStr = timePart.substr(dotPos + 1);
-  } else {
-    secStr = timePart.substr(colonPos + 1);
+// 格式化占位符：{name} → value
+struct FormatField {
+  std::string_view name;
+  std::string_view value;
+};
+
+// 单次扫描替换 format 中的 {name} 占位符，未知占位符原样保留
+// markName 非空时，通过 markOffset 返回该占位符的值在结果中的字节偏移（未出现为 npos）
+inline std::string renderFormat(std::string_view format,
+                                std::initializer_list<FormatField> fields,
+                                std::string_view markName = {},
+                                size_t *markOffset = nullptr) {
+  std::string result;
+  result.reserve(format.size() + 64);
+  if (markOffset) {
+    *markOffset = std::string::npos;
   }
-  if (!std::all_of(secStr.begin(), secStr.end(), ::isdigit)) {
-    return 0;
+  size_t pos = 0;
+  while (pos < format.size()) {
+    size_t open = format.find('{', pos);
+    size_t close = open == std::string_view::npos ? open : format.find('}', open);
+    if (close == std::string_view::npos) {
+      result.append(format.substr(pos));
+      break;
+    }
+    result.append(format.substr(pos, open - pos));
+    std::string_view name = format.substr(open + 1, close - open - 1);
+    auto it = std::find_if(fields.begin(), fields.end(),
+                           [name](const FormatField &f) { return f.name == name; });
+    if (it == fields.end()) {
+      result.append(format.substr(open, close - open + 1));
+    } else {
+      if (markOffset && name == markName) {
+        *markOffset = result.size();
+      }
+      result.append(it->value);
+    }
+    pos = close + 1;
   }
-  int seconds = std::stoi(secStr);
+  return result;
+}
 
-  // 解析百分秒（ss，最多取两位）
-  if (centiSecStr.length() > 2)
-    centiSecStr = centiSecStr.substr(0, 2); // 截断多余位数
-  if (!std::all_of(centiSecStr.begin(), centiSecStr.end(), ::isdigit)) {
-    return 0;
+// 提取播放器简称（如 org.mpris.MediaPlayer2.firefox.instancexxx 只解析为 firefox）
+inline std::string_view shortPlayerName(std::string_view playerName) {
+  constexpr std::string_view prefix = "org.mpris.MediaPlayer2.";
+  if (!playerName.starts_with(prefix)) {
+    return playerName;
   }
-  int centiSeconds = centiSecStr.empty() ? 0 : std::stoi(centiSecStr);
-
-  // 步骤3：计算总毫秒数（分钟×60×1000 + 秒×1000 + 百分秒×10）
-  uint64_t ms = minutes * 60 * 1000 + seconds * 1000 + centiSeconds * 10;
-  return ms;
+  playerName.remove_prefix(prefix.size());
+  return playerName.substr(0, playerName.find('.'));
 }
 
-inline size_t WriteCallback(void *contents, size_t size, size_t nmemb,
-                            void *userp) {
-  ((std::string *)userp)->append((char *)contents, size * nmemb);
-  return size * nmemb;
+// 按行存储的 TSV 文件（播放历史、歌词库索引、同步偏移）：字段中的制表符和换行替换为空格
+inline std::string sanitizeField(std::string value) {
+  std::replace_if(value.begin(), value.end(),
+                  [](char c) { return c == '\t' || c == '\n' || c == '\r'; }, ' ');
+  return value;
 }
 
-// 下载歌词(Lrclib) - 同步阻塞IO方式
-// 输入：歌曲名称，艺术家名称（可选）
-// 输出：成功时返回歌词字符串，失败时返回空字符串
-// 注意：此函数可能会阻塞，需要在单独的线程中调用
-inline std::string getLyricsByLrclib(const std::string &trackName,
-                                 const std::string &artist = "") {
-  std::string trim_query = trackName + " " + artist;
-  trim_query = trim(trim_query);
-  if (trim_query.empty()) {
-    return "";
-  }
-  std::string url =
-      "https://lrclib.net/api/search?track_name=" + url_encode(trackName);
-
-  // 如果提供了艺术家名称，添加到URL中
-  if (!artist.empty())
-    url += "&artist_name=" + url_encode(artist);
-  std::string content;
-
-  std::string syncedLyrics = "";
-
-  CURL *curl = curl_easy_init();
-  if (curl) {
-    curl_easy_setopt(curl, CURLOPT_URL, url.c_str());
-    curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, WriteCallback);
-    curl_easy_setopt(curl, CURLOPT_WRITEDATA, &content);
-    CURLcode res = curl_easy_perform(curl);
-
-    if (res != CURLE_OK) {
-      ERROR("  >> CURL error: %s", curl_easy_strerror(res));
-      return "";
+// 写入 TSV 文件：首行为 magic（格式名和版本），之后每行一条记录；先写临时文件再重命名，
+// 避免异常退出留下半个文件。what 为日志中的文件说明，失败时记录警告并返回 false
+inline bool writeTsvFile(const std::filesystem::path &path, std::string_view magic,
+                         const std::vector<std::string> &rows, const char *what) {
+  std::filesystem::path temp = path;
+  temp += ".tmp";
+  {
+    std::ofstream file(temp, std::ios::out | std::ios::trunc);
+    if (!file.is_open()) {
+      WARN("  >> Failed to write %s: %s", what, temp.c_str());
+      return false;
     }
-    long http_code = 0;
-    curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &http_code);
-    if (http_code != 200) {
-      ERROR("  >> HTTP error: %ld", http_code);
-      return "";
+    file << magic << '\n';
+    for (const auto &row : rows) {
+      file << row << '\n';
     }
-    if (content.empty()) {
-      ERROR("  >> No content received");
-      return "";
-    }
-    curl_easy_cleanup(curl);
   }
-
-  try {
-    auto json = nlohmann::json::parse(content, nullptr, false);
-    if (json.is_discarded())
-      return "";
-
-    auto currentLyrics = json.get<std::vector<nlohmann::json>>();
-    if (currentLyrics.empty())
-      return "";
-    auto &first = currentLyrics[0];
-    if (first.count("syncedLyrics")) {
-      return first["syncedLyrics"];
-    } else {
-      WARN("  >> No syncedLyrics found in JSON");
-      return "";
-    }
-  } catch (const std::exception &e) {
-    WARN("Error parsing JSON: %s", e.what());
-    return "";
+  std::error_code ec;
+  std::filesystem::rename(temp, path, ec);
+  if (ec) {
+    WARN("  >> Failed to replace %s: %s", what, ec.message().c_str());
+    return false;
   }
-  return "";
-}
\ No newline at end of file
+  return true;
+}
+
+inline size_t WriteCallback(void *contents, size_t size, size_t nmemb,
+                            void *userp) {
+  ((std::string *)userp)->append((char *)contents, size * nmemb);
+  return size * nmemb;
+}
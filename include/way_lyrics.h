@@ -2,11 +2,23 @@
 #define WAYLYRICS_WAY_LYRICS_H
 
 #include "common.h"
+#include "karaoke_renderer.h"
+#include "lyrics_prefetcher.h"
+#include "lyrics_provider.h"
+#include "lyrics_service.h"
+#include "lyrics_timeline.h"
+#include "lyrics_tooltip.h"
+#include "marquee_view.h"
+#include "playback_clock.h"
 #include "player_manager.h"
+#include "single_flight.h"
+#include "sync_offsets.h"
 #include <atomic>
+#include <condition_variable>
 #include <filesystem>
 #include <gtk/gtk.h>
 #include <memory>
+#include <mutex>
 #include <nlohmann/json_fwd.hpp>
 #include <pthread.h>
 #include <string>
@@ -22,11 +34,41 @@ struct ConfigParams {
   std::string cacheDir; // 缓存目录（无默认值，需显式设置）
   std::string format;   // 歌词格式
   std::string tooltipFormat; // 工具提示格式
+  std::string lrclibUrl; // lrclib 服务地址（可指向本地测试服务）
   int toggleTooltip; // 是否启用工具提示（0: 禁用, 1: 启用）
+  int tooltipLines;  // 工具提示中当前行前后各显示的歌词行数（0: 只显示静态 tooltip-format）
   int updateInterval;   // 默认更新间隔（秒）
   int maxLength;        // 默认最大歌词长度（字符）
   int lyricsTitleMaxLength; // 限制音频的标题长度（字符），超过长度的标题不会查询歌词
   int lyricsMaxDuration; // 限制音频的最大时长（秒），超过时长的歌词不会查询歌词
+  int karaoke;          // 是否启用卡拉OK逐字高亮（0: 禁用, 1: 启用）
+  int karaokeFps;       // 卡拉OK高亮最大刷新帧率
+  std::string karaokeColor; // 卡拉OK已唱部分颜色
+  int marquee;          // 是否启用跑马灯滚动显示超长歌词（0: 禁用, 1: 启用）
+  int marqueeFps;       // 跑马灯最大刷新帧率
+  std::string providers; // 歌词来源列表（逗号分隔，按顺序查询），如 "player,lrclib,url"
+  std::string lyricsUrl; // 自定义 HTTP 歌词服务 URL 模板（来源名称 url）
+  std::string lyricsDirs; // 本地歌词目录（逗号分隔，来源名称 file）
+  int providerDeadline; // 并行查询截止时间（毫秒），0 表示按顺序查询
+  int providerAdaptive; // 是否按耗时和命中率自适应调整来源顺序（0: 禁用, 1: 启用）
+  int httpConnectTimeout; // HTTP 连接超时（毫秒）
+  int httpTimeout;        // HTTP 单次请求总超时（毫秒）
+  int httpRetries;        // HTTP 失败后最多重试次数
+  int httpRateLimit;      // 每个主机每秒最多请求数（0: 不限流）
+  int httpBreakerThreshold; // 连续失败多少次后熔断，只使用缓存（0: 不熔断）
+  int httpBreakerCooldown;  // 熔断后多久放行探测请求（秒）
+  int prefetch;             // 是否预取后续曲目的歌词（0: 禁用, 1: 启用）
+  int prefetchDepth;        // 每次预取的后续曲目数
+  int prefetchLookahead;    // 没有 TrackList 时，在歌曲结束前多少秒按播放历史预取
+  int prefetchConcurrency;  // 预取并发数
+  int metricsInterval;      // 指标快照文件（metrics.json）的刷新间隔（秒，0: 只在 stats 动作时写入）
+  int trace;                // 启动时是否开启追踪（0: 禁用, 1: 启用）
+  std::string traceFile;    // 追踪导出文件（为空时使用 <cache_dir>/trace.json）
+  int traceSignal;          // 收到 SIGRTMIN+N 时切换追踪（0: 禁用）
+  std::string dbusRecord;   // D-Bus 事件录制文件（为空时不录制）
+  int offsetDefault;        // 未校准歌曲的默认同步偏移（毫秒，正数表示歌词提前）
+  int offsetStep;           // offset+/offset- 动作每次调整的偏移（毫秒）
+  int dbusService;          // 是否在会话总线上导出 org.waylyrics 歌词服务（0: 禁用, 1: 启用）
 };
 
 inline void displayConfig(const ConfigParams &params) {
@@ -37,11 +79,41 @@ inline void displayConfig(const ConfigParams &params) {
   INFO("  cacheDir: %s", params.cacheDir.c_str());
   INFO("  format: %s", params.format.c_str());
   INFO("  tooltipFormat: %s", params.tooltipFormat.c_str());
+  INFO("  lrclibUrl: %s", params.lrclibUrl.c_str());
   INFO("  toggleTooltip: %d", params.toggleTooltip);
+  INFO("  tooltipLines: %d", params.tooltipLines);
   INFO("  updateInterval: %d", params.updateInterval);
   INFO("  maxLength: %d", params.maxLength);
   INFO("  lyricsTitleMaxLength: %d", params.lyricsTitleMaxLength);
   INFO("  lyricsMaxDuration: %d", params.lyricsMaxDuration);
+  INFO("  karaoke: %d", params.karaoke);
+  INFO("  karaokeFps: %d", params.karaokeFps);
+  INFO("  karaokeColor: %s", params.karaokeColor.c_str());
+  INFO("  marquee: %d", params.marquee);
+  INFO("  marqueeFps: %d", params.marqueeFps);
+  INFO("  providers: %s", params.providers.c_str());
+  INFO("  lyricsUrl: %s", params.lyricsUrl.c_str());
+  INFO("  lyricsDirs: %s", params.lyricsDirs.c_str());
+  INFO("  providerDeadline: %d", params.providerDeadline);
+  INFO("  providerAdaptive: %d", params.providerAdaptive);
+  INFO("  httpConnectTimeout: %d", params.httpConnectTimeout);
+  INFO("  httpTimeout: %d", params.httpTimeout);
+  INFO("  httpRetries: %d", params.httpRetries);
+  INFO("  httpRateLimit: %d", params.httpRateLimit);
+  INFO("  httpBreakerThreshold: %d", params.httpBreakerThreshold);
+  INFO("  httpBreakerCooldown: %d", params.httpBreakerCooldown);
+  INFO("  prefetch: %d", params.prefetch);
+  INFO("  prefetchDepth: %d", params.prefetchDepth);
+  INFO("  prefetchLookahead: %d", params.prefetchLookahead);
+  INFO("  prefetchConcurrency: %d", params.prefetchConcurrency);
+  INFO("  metricsInterval: %d", params.metricsInterval);
+  INFO("  trace: %d", params.trace);
+  INFO("  traceFile: %s", params.traceFile.c_str());
+  INFO("  traceSignal: %d", params.traceSignal);
+  INFO("  dbusRecord: %s", params.dbusRecord.c_str());
+  INFO("  offsetDefault: %d", params.offsetDefault);
+  INFO("  offsetStep: %d", params.offsetStep);
+  INFO("  dbusService: %d", params.dbusService);
 }
 
 
@@ -52,7 +124,8 @@ public:
   ~WayLyrics();
 
   // 核心控制方法
-  void start(GtkLabel *label); // 启动歌词显示（绑定GTK标签）
+  // 启动歌词显示（绑定GTK标签；跑马灯模式下绑定绘制区域，label 为空）
+  void start(GtkLabel *label, GtkWidget *marqueeArea = nullptr);
   void stop();                 // 停止显示并清理资源
   void toggle();               // 切换启动/停止状态
   bool isRunning() const;      // 检查是否正在运行
@@ -61,24 +134,82 @@ public:
   void nextPlayer();                    // 切换到下一个播放器
   void prevPlayer();                    // 切换到上一个播放器
   std::string getCurrentPlayer() const; // 获取当前播放器名称
+  // 运行指标：输出摘要到日志并立即写入快照文件
+  void dumpMetrics() const;
+  // 切换追踪：开启时开始记录，关闭时导出 Chrome trace JSON（由刷新线程执行）
+  void toggleTrace();
+  // 置位切换标志并唤醒刷新线程（waybar 在处理信号的线程中调用 refresh，不在异步信号处理函数中）
+  void requestTraceToggle();
+  // 同步偏移校准：当前歌曲的偏移调整 steps 个 offset-step（正数歌词提前），或恢复为播放器默认值
+  void adjustOffset(int steps);
+  void resetOffset();
   LoopStatus currentLoopStatus_ = LoopStatus::None; // 跟踪当前循环模式
   std::unique_ptr<PlayerManager> playerManager_;    // 播放器管理实例
 
 private:
   void updateLyricsLoop(); // 歌词刷新循环（后台线程）
-  std::string
-  getLyrics(const PlayerState &state); // 获取歌词（优先缓存/网络请求）
   void onPlayerStateChanged(const PlayerState &state); // 播放器状态变更回调
-  std::string getLyrics(const std::string &trackName, const std::string &artist);
+  bool needLyrics(const PlayerState &state) const; // 判断是否需要查询歌词
+  bool wantLyrics(const PlayerMetadata &metadata) const; // 过滤非歌曲音频（标题/时长限制）
+  // 在后台线程获取歌词（与同一首歌进行中的预取、服务查询合并），完成后由 applyLyrics 更新时间轴
+  void requestLyrics(const std::string &trackKey, const PlayerMetadata &metadata);
+  // playerLyrics 为查询时使用的播放器歌词，用于丢弃按旧 asText 得到的结果
+  void applyLyrics(const std::string &trackKey, const std::string &playerLyrics,
+                   std::string lyrics, bool resolved);
+  void wakeUpdate(); // 有事件需要刷新显示时唤醒刷新线程
+  void applyTraceToggle(); // 刷新线程中执行待处理的追踪切换
+  // 每个歌词字段可用的列数：max-length 减去格式中其余部分（标题、播放器、时间等）的宽度，
+  // 按格式中的歌词字段数平分；跑马灯模式或其余部分已超长时为 0（不预截断）
+  size_t lyricsColumns(const PlayerState &state) const;
+  // 按同步偏移重建当前歌曲的时间轴（偏移由 offsets_ 更新后调用）
+  void rebuildTimeline(const std::string &trackKey, int64_t offsetMs);
+  // 获取歌词：优先本地缓存，否则按来源链查询，网络来源的结果写入缓存
+  std::string getLyrics(const PlayerMetadata &metadata);
+  // 旧版缓存文件迁移到规范化键对应的路径
+  void migrateLegacyCache(const std::string &query,
+                          const std::filesystem::path &target) const;
+  // 按配置的 providers 列表创建歌词来源链
+  std::unique_ptr<LyricsProviderChain> createProviderChain() const;
+  // 预取后续曲目的歌词到缓存（预取线程调用，与前台查询共享进行中的请求）
+  void prefetchLyrics(const PlayerMetadata &metadata);
+  // 歌词服务的 Lookup：与前台查询共用缓存、来源链和进行中的请求
+  std::string lookupLyrics(const std::string &title, const std::string &artist,
+                           int64_t durationMs);
+  // 指标快照：注册表中的计数器和直方图，加上来源统计、HTTP 主机统计和合并查询次数
+  nlohmann::json metricsSnapshot() const;
+  void writeMetricsFile() const; // 写入 <cache_dir>/metrics.json（先写临时文件再重命名）
 
 
   // 成员变量
   ConfigParams params_;                // 配置参数
   std::filesystem::path cachePath;     // 歌词缓存目录
+  std::filesystem::path traceFile_;    // 追踪导出文件
   GtkLabel *displayLabel_{nullptr};    // 绑定的GTK标签（用于显示歌词）
   std::atomic<bool> isRunning_{false}; // 运行状态标记（原子操作保证线程安全）
   std::thread updateThread_{};         // 歌词刷新后台线程
+  std::mutex stateMutex_;              // 保护 currentState_ 和 timeline_
+  std::condition_variable updateWake_; // 唤醒刷新线程（状态变更、歌词到达、停止）
+  bool updatePending_ = false;         // 上次取快照后有新事件（受 stateMutex_ 保护）
+  std::atomic<bool> traceToggle_{false}; // 待处理的追踪切换（持有 stateMutex_ 置位）
   PlayerState currentState_;           // 当前播放器状态（线程安全需加锁）
+  std::shared_ptr<const LyricsTimeline> timeline_; // 当前歌词时间轴（解析一次，多线程共享）
+  std::shared_ptr<PlaybackClock> clock_ = std::make_shared<PlaybackClock>(); // 播放时钟
+  std::shared_ptr<KaraokeRenderer> karaoke_; // 卡拉OK渲染器（仅在GTK线程使用）
+  std::shared_ptr<MarqueeView> marquee_;     // 跑马灯显示（仅在GTK线程使用）
+  std::unique_ptr<LyricsTooltip> tooltip_;   // 歌词工具提示（仅在GTK线程使用）
+  std::unique_ptr<LyricsProviderChain> providers_; // 歌词来源链
+  std::string trackKey_;        // 当前歌曲的规范化键（受 stateMutex_ 保护）
+  bool lyricsResolved_ = false; // 当前歌曲的歌词是否已查询完成（含未找到）
+  bool lyricsRequested_ = false; // 当前歌曲是否已有前台查询线程（受 stateMutex_ 保护）
+  std::string playerLyrics_;    // 播放器为当前歌曲提供的歌词（xesam:asText，受 stateMutex_ 保护）
+  uint64_t traceId_ = 0;        // 当前换歌的异步追踪区间（受 stateMutex_ 保护，未追踪为 0）
+  SingleFlight<std::string, std::string> lyricsFlight_; // 合并同一首歌的并发查询
+  std::mutex fetchMutex_;               // 保护 activeFetches_
+  std::condition_variable fetchDone_;   // 析构时等待后台查询结束
+  int activeFetches_ = 0;               // 进行中的后台查询线程数
+  std::unique_ptr<LyricsPrefetcher> prefetcher_; // 歌词预取（未启用为空）
+  std::unique_ptr<SyncOffsets> offsets_;         // 按播放器/歌曲保存的同步偏移
+  std::unique_ptr<LyricsService> service_;       // org.waylyrics 歌词服务（未启用为空）
   std::shared_ptr<sdbus::IConnection> dbusConn_;
 };
 
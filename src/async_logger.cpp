@@ -0,0 +1,267 @@
+#include "../include/async_logger.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdarg>
+#include <cstdio>
+#include <ctime>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace {
+
+constexpr size_t ringSlots = 64;      // 每个线程的缓冲条数（2 的幂）
+constexpr size_t messageMax = 240;    // 单条消息最大字节数（超出截断）
+
+struct LogRecord {
+  const char *tag;
+  const char *file;
+  const char *func;
+  int line;
+  int64_t timeNs;    // system_clock 时间（纳秒）
+  uint32_t length;   // text 中的有效字节数
+  char text[messageMax];
+};
+
+// 单生产者（所属线程）单消费者（输出线程）环形缓冲区
+struct LogRing {
+  std::atomic<uint64_t> head{0}; // 生产者写入位置
+  std::atomic<uint64_t> tail{0}; // 消费者读取位置
+  std::atomic<bool> owned{false}; // 是否有线程在使用；线程退出后可被新线程复用
+  LogRecord slots[ringSlots];
+
+  bool empty() const {
+    return head.load(std::memory_order_acquire) == tail.load(std::memory_order_relaxed);
+  }
+};
+
+class Logger {
+public:
+  LogRing *acquireRing();
+  void wake();
+  void ensureWriter();
+  void flush();
+  void shutdown();
+
+  std::atomic<uint64_t> dropped{0};
+  std::atomic<bool> running{false};
+
+private:
+  void run();
+  bool drain(std::vector<LogRecord> &batch);
+  bool pending();
+  void write(std::vector<LogRecord> &batch);
+
+  std::mutex mutex_; // 保护 rings_ 和输出线程的启停
+  std::vector<std::unique_ptr<LogRing>> rings_;
+  std::thread writer_;
+  std::atomic<bool> stopping_{false};
+  std::atomic<bool> sleeping_{false};
+  std::atomic<uint32_t> wakeSeq_{0};
+  std::atomic<uint64_t> flushRequested_{0};
+  std::atomic<uint64_t> flushDone_{0};
+  uint64_t reportedDrops_ = 0;
+  // 按秒缓存的时间戳前缀（只在输出线程使用）
+  int64_t cachedSecond_ = -1;
+  char cachedTime_[32] = {};
+};
+
+// 不析构：线程局部的归还逻辑可能晚于静态对象析构执行
+Logger &logger() {
+  static Logger *instance = new Logger;
+  return *instance;
+}
+
+// 线程退出时归还缓冲区（剩余日志仍由输出线程输出）
+struct RingHolder {
+  LogRing *ring = nullptr;
+  ~RingHolder() {
+    if (ring) {
+      ring->owned.store(false, std::memory_order_release);
+    }
+  }
+};
+
+thread_local RingHolder threadRing;
+
+LogRing *Logger::acquireRing() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  LogRing *ring = nullptr;
+  for (auto &candidate : rings_) {
+    if (!candidate->owned.load(std::memory_order_acquire) && candidate->empty()) {
+      ring = candidate.get();
+      break;
+    }
+  }
+  if (!ring) {
+    rings_.push_back(std::make_unique<LogRing>());
+    ring = rings_.back().get();
+  }
+  ring->owned.store(true, std::memory_order_relaxed);
+  return ring;
+}
+
+void Logger::ensureWriter() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (running.load(std::memory_order_relaxed)) {
+    return;
+  }
+  stopping_ = false;
+  writer_ = std::thread([this]() { run(); });
+  running.store(true, std::memory_order_release);
+}
+
+void Logger::wake() {
+  if (sleeping_.load()) {
+    wakeSeq_.fetch_add(1);
+    wakeSeq_.notify_one();
+  }
+}
+
+bool Logger::pending() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return std::any_of(rings_.begin(), rings_.end(),
+                     [](const auto &ring) { return !ring->empty(); });
+}
+
+bool Logger::drain(std::vector<LogRecord> &batch) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  for (auto &ring : rings_) {
+    uint64_t tail = ring->tail.load(std::memory_order_relaxed);
+    uint64_t head = ring->head.load(std::memory_order_acquire);
+    for (; tail != head; ++tail) {
+      batch.push_back(ring->slots[tail % ringSlots]);
+    }
+    ring->tail.store(tail, std::memory_order_release);
+  }
+  return !batch.empty();
+}
+
+void Logger::write(std::vector<LogRecord> &batch) {
+  // 各线程的记录已按时间有序，合并后整体按时间排序输出
+  std::stable_sort(batch.begin(), batch.end(),
+                   [](const LogRecord &a, const LogRecord &b) { return a.timeNs < b.timeNs; });
+  for (const auto &record : batch) {
+    int64_t second = record.timeNs / 1000000000;
+    if (second != cachedSecond_) {
+      cachedSecond_ = second;
+      time_t seconds = static_cast<time_t>(second);
+      std::tm local{};
+      localtime_r(&seconds, &local);
+      strftime(cachedTime_, sizeof(cachedTime_), "%Y-%m-%d %H:%M:%S", &local);
+    }
+    fprintf(stderr, "[%s.%03d] [%s %s] [%s] %s:%d(%s): %.*s\n", cachedTime_,
+            static_cast<int>(record.timeNs / 1000000 % 1000), BUILD_VERSION,
+            BUILD_TIME, record.tag, record.file, record.line, record.func,
+            static_cast<int>(record.length), record.text);
+  }
+  uint64_t dropped = this->dropped.load(std::memory_order_relaxed);
+  if (dropped != reportedDrops_) {
+    fprintf(stderr, "[%s] [%s %s] [WARN] logger: %lu messages dropped\n",
+            cachedTime_, BUILD_VERSION, BUILD_TIME,
+            static_cast<unsigned long>(dropped - reportedDrops_));
+    reportedDrops_ = dropped;
+  }
+  fflush(stderr);
+  batch.clear();
+}
+
+void Logger::run() {
+  std::vector<LogRecord> batch;
+  batch.reserve(ringSlots);
+  while (true) {
+    uint64_t flushRequest = flushRequested_.load();
+    bool stopping = stopping_.load();
+    if (drain(batch)) {
+      write(batch);
+      continue;
+    }
+    // 已全部输出：完成之前的 flush 请求
+    if (flushDone_.load() < flushRequest) {
+      flushDone_.store(flushRequest);
+      flushDone_.notify_all();
+    }
+    if (stopping) {
+      break;
+    }
+    // 先登记睡眠再检查一次，生产者看到 sleeping_ 后递增 wakeSeq_ 唤醒
+    uint32_t seq = wakeSeq_.load();
+    sleeping_.store(true);
+    if (!pending() && !stopping_.load() && flushRequested_.load() == flushRequest) {
+      wakeSeq_.wait(seq);
+    }
+    sleeping_.store(false);
+  }
+}
+
+void Logger::flush() {
+  if (!running.load(std::memory_order_acquire)) {
+    return;
+  }
+  uint64_t request = flushRequested_.fetch_add(1) + 1;
+  wakeSeq_.fetch_add(1);
+  wakeSeq_.notify_one();
+  for (uint64_t done = flushDone_.load(); done < request; done = flushDone_.load()) {
+    flushDone_.wait(done);
+  }
+}
+
+void Logger::shutdown() {
+  std::thread writer;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!running.load(std::memory_order_relaxed)) {
+      return;
+    }
+    stopping_ = true;
+    running.store(false, std::memory_order_release);
+    writer = std::move(writer_);
+  }
+  wakeSeq_.fetch_add(1);
+  wakeSeq_.notify_one();
+  writer.join();
+}
+
+} // namespace
+
+void logWrite(const char *tag, const char *file, int line, const char *func,
+              const char *format, ...) {
+  auto &instance = logger();
+  LogRing *ring = threadRing.ring;
+  if (!ring) {
+    ring = threadRing.ring = instance.acquireRing();
+  }
+  if (!instance.running.load(std::memory_order_acquire)) {
+    instance.ensureWriter();
+  }
+  uint64_t head = ring->head.load(std::memory_order_relaxed);
+  if (head - ring->tail.load(std::memory_order_acquire) >= ringSlots) {
+    instance.dropped.fetch_add(1, std::memory_order_relaxed);
+    return;
+  }
+  LogRecord &record = ring->slots[head % ringSlots];
+  record.tag = tag;
+  record.file = file;
+  record.line = line;
+  record.func = func;
+  record.timeNs = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                      std::chrono::system_clock::now().time_since_epoch())
+                      .count();
+  va_list args;
+  va_start(args, format);
+  int length = vsnprintf(record.text, sizeof(record.text), format, args);
+  va_end(args);
+  record.length = static_cast<uint32_t>(
+      std::clamp(length, 0, static_cast<int>(sizeof(record.text)) - 1));
+  // 与输出线程的 sleeping_ 检查构成顺序一致的握手，避免丢失唤醒
+  ring->head.store(head + 1);
+  instance.wake();
+}
+
+void logFlush() { logger().flush(); }
+
+void logShutdown() { logger().shutdown(); }
+
+uint64_t logDropped() { return logger().dropped.load(std::memory_order_relaxed); }
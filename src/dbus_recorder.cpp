@@ -0,0 +1,189 @@
+#include "../include/dbus_recorder.h"
+#include "common.h"
+#include <nlohmann/json.hpp>
+
+namespace {
+
+const char *statusName(PlaybackStatus status) {
+  switch (status) {
+  case PlaybackStatus::Playing:
+    return "Playing";
+  case PlaybackStatus::Paused:
+    return "Paused";
+  case PlaybackStatus::Stopped:
+    return "Stopped";
+  default:
+    return "Unknown";
+  }
+}
+
+PlaybackStatus parseStatus(const std::string &name) {
+  if (name == "Playing") {
+    return PlaybackStatus::Playing;
+  }
+  if (name == "Paused") {
+    return PlaybackStatus::Paused;
+  }
+  if (name == "Stopped") {
+    return PlaybackStatus::Stopped;
+  }
+  return PlaybackStatus::Unknown;
+}
+
+nlohmann::ordered_json metadataJson(const PlayerMetadata &md, std::string &lastLyrics) {
+  nlohmann::ordered_json json = {{"ti", md.title}, {"ar", md.artist}, {"len", md.length}};
+  if (!md.trackId.empty()) {
+    json["id"] = md.trackId;
+  }
+  if (!md.album.empty()) {
+    json["al"] = md.album;
+  }
+  if (!md.url.empty()) {
+    json["u"] = md.url;
+  }
+  if (!md.lyrics.empty()) {
+    if (md.lyrics == lastLyrics) {
+      json["txr"] = 1;
+    } else {
+      json["tx"] = md.lyrics;
+      lastLyrics = md.lyrics;
+    }
+  }
+  return json;
+}
+
+PlayerMetadata parseMetadataJson(const nlohmann::json &json, const std::string &lastLyrics) {
+  PlayerMetadata md;
+  md.trackId = json.value("id", "");
+  md.title = json.value("ti", "");
+  md.artist = json.value("ar", "");
+  md.album = json.value("al", "");
+  md.url = json.value("u", "");
+  md.length = json.value("len", int64_t{0});
+  md.lyrics = json.contains("txr") ? lastLyrics : json.value("tx", "");
+  return md;
+}
+
+} // namespace
+
+DbusRecorder::DbusRecorder(const std::filesystem::path &file)
+    : out_(file, std::ios::out | std::ios::trunc) {
+  if (!out_.is_open()) {
+    WARN("  >> Failed to open D-Bus record file: %s", file.c_str());
+    return;
+  }
+  out_ << R"({"k":"h","v":1,"src":"dbus-record"})" << '\n';
+  out_.flush();
+  INFO("  >> Recording D-Bus events to %s", file.c_str());
+}
+
+void DbusRecorder::record(const DbusEvent &event) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (!out_.is_open()) {
+    return;
+  }
+  nlohmann::ordered_json json = {{"t", event.timeUs}};
+  switch (event.kind) {
+  case DbusEvent::Kind::Players:
+    json["k"] = "l";
+    json["ps"] = event.players;
+    break;
+  case DbusEvent::Kind::Owner:
+    json["k"] = "o";
+    json["p"] = event.player;
+    json["old"] = event.oldOwner;
+    json["new"] = event.newOwner;
+    break;
+  case DbusEvent::Kind::Signal:
+    json["k"] = "s";
+    json["p"] = event.player;
+    json["i"] = event.interfaceName;
+    json["c"] = event.signal.changed;
+    if (!event.signal.playbackStatus.empty()) {
+      json["st"] = event.signal.playbackStatus;
+    }
+    if (event.signal.hasMetadata) {
+      json["md"] = metadataJson(event.signal.metadata, lastLyrics_);
+    }
+    break;
+  case DbusEvent::Kind::State:
+    json["k"] = "r";
+    json["p"] = event.player;
+    json["st"] = statusName(event.state.status);
+    json["pos"] = event.state.position;
+    json["md"] = metadataJson(event.state.metadata, lastLyrics_);
+    break;
+  case DbusEvent::Kind::Select:
+    json["k"] = "u";
+    json["p"] = event.player;
+    break;
+  }
+  // 每个事件立即写出，进程异常退出时录制内容仍然完整
+  out_ << json.dump(-1, ' ', false, nlohmann::json::error_handler_t::replace) << '\n';
+  out_.flush();
+}
+
+std::vector<DbusEvent> loadDbusTrace(const std::filesystem::path &file) {
+  std::vector<DbusEvent> events;
+  std::ifstream in(file);
+  if (!in.is_open()) {
+    WARN("  >> Failed to open D-Bus trace: %s", file.c_str());
+    return events;
+  }
+  std::string line;
+  std::string lastLyrics;
+  size_t lineNo = 0;
+  while (std::getline(in, line)) {
+    ++lineNo;
+    auto json = nlohmann::json::parse(line, nullptr, false);
+    if (json.is_discarded() || !json.is_object() || !json.contains("k")) {
+      WARN("  >> Invalid D-Bus trace line %zu in %s", lineNo, file.c_str());
+      continue;
+    }
+    try {
+      std::string kind = json["k"].get<std::string>();
+      DbusEvent event;
+      event.timeUs = json.value("t", uint64_t{0});
+      event.player = json.value("p", "");
+      if (kind == "h") {
+        continue;
+      } else if (kind == "l") {
+        event.kind = DbusEvent::Kind::Players;
+        event.players = json.value("ps", std::vector<std::string>{});
+      } else if (kind == "o") {
+        event.kind = DbusEvent::Kind::Owner;
+        event.oldOwner = json.value("old", "");
+        event.newOwner = json.value("new", "");
+      } else if (kind == "s") {
+        event.kind = DbusEvent::Kind::Signal;
+        event.interfaceName = json.value("i", "");
+        event.signal.changed = json.value("c", std::vector<std::string>{});
+        event.signal.playbackStatus = json.value("st", "");
+        if (json.contains("md")) {
+          event.signal.hasMetadata = true;
+          event.signal.metadata = parseMetadataJson(json["md"], lastLyrics);
+          lastLyrics = event.signal.metadata.lyrics.empty() ? lastLyrics
+                                                            : event.signal.metadata.lyrics;
+        }
+      } else if (kind == "r") {
+        event.kind = DbusEvent::Kind::State;
+        event.state.playerName = event.player;
+        event.state.status = parseStatus(json.value("st", ""));
+        event.state.position = json.value("pos", uint64_t{0});
+        event.state.metadata = parseMetadataJson(json.value("md", nlohmann::json::object()),
+                                                 lastLyrics);
+        lastLyrics = event.state.metadata.lyrics.empty() ? lastLyrics
+                                                         : event.state.metadata.lyrics;
+      } else if (kind == "u") {
+        event.kind = DbusEvent::Kind::Select;
+      } else {
+        WARN("  >> Unknown D-Bus trace event '%s' at line %zu", kind.c_str(), lineNo);
+        continue;
+      }
+      events.push_back(std::move(event));
+    } catch (const nlohmann::json::exception &e) {
+      WARN("  >> Invalid D-Bus trace line %zu: %s", lineNo, e.what());
+    }
+  }
+  return events;
+}
@@ -0,0 +1,307 @@
+#include "../include/http_client.h"
+#include "../include/metrics.h"
+#include "../include/trace.h"
+#include "../include/utils.hpp"
+#include "common.h"
+#include <algorithm>
+#include <chrono>
+#include <curl/curl.h>
+#include <mutex>
+#include <random>
+#include <thread>
+#include <unordered_map>
+
+using Clock = std::chrono::steady_clock;
+
+namespace {
+
+// 单个主机的限流、重试预算和熔断状态
+struct HostState {
+  double tokens = -1;            // 令牌桶余量（-1 表示尚未初始化）
+  Clock::time_point refilled;    // 上次补充令牌的时间
+  double retryTokens = 1;        // 重试预算余量
+  BreakerState breaker = BreakerState::Closed;
+  Clock::time_point openedAt;    // 熔断打开时间
+  bool probing = false;          // 半开状态下是否已有探测请求在进行
+  HttpHostStats stats;
+};
+
+std::mutex hostMutex;
+HttpPolicy policy;
+std::unordered_map<std::string, HostState> hosts;
+
+double elapsedMs(Clock::time_point begin) {
+  return std::chrono::duration<double, std::milli>(Clock::now() - begin).count();
+}
+
+// "https://lrclib.net:443/api/get?x" → "lrclib.net:443"
+std::string hostOf(const std::string &url) {
+  size_t begin = url.find("://");
+  begin = begin == std::string::npos ? 0 : begin + 3;
+  size_t end = url.find_first_of("/?#", begin);
+  return url.substr(begin, end == std::string::npos ? end : end - begin);
+}
+
+HostState &hostLocked(const std::string &host) {
+  auto &state = hosts[host];
+  state.stats.host = host;
+  return state;
+}
+
+// 分片睡眠，取消标志置位时提前返回 false
+bool sleepFor(double ms, const std::atomic<bool> *cancel) {
+  auto until = Clock::now() + std::chrono::microseconds(static_cast<int64_t>(ms * 1000));
+  while (Clock::now() < until) {
+    if (cancel && *cancel) {
+      return false;
+    }
+    std::this_thread::sleep_for(
+        std::min<Clock::duration>(until - Clock::now(), std::chrono::milliseconds(20)));
+  }
+  return !(cancel && *cancel);
+}
+
+// 熔断检查：打开期间拒绝请求，冷却结束后放行一个探测请求（半开）
+bool admit(const std::string &host) {
+  std::lock_guard<std::mutex> lock(hostMutex);
+  auto &state = hostLocked(host);
+  if (policy.breakerThreshold <= 0 || state.breaker == BreakerState::Closed) {
+    return true;
+  }
+  if (state.breaker == BreakerState::Open &&
+      Clock::now() - state.openedAt >= std::chrono::milliseconds(policy.breakerCooldownMs)) {
+    state.breaker = BreakerState::HalfOpen;
+    state.probing = false;
+  }
+  if (state.breaker == BreakerState::HalfOpen && !state.probing) {
+    state.probing = true;
+    INFO("  >> HTTP circuit half-open for %s, probing", host.c_str());
+    return true;
+  }
+  ++state.stats.rejected;
+  return false;
+}
+
+// 令牌桶：等待可用令牌（可取消）
+bool acquireToken(const std::string &host, const std::atomic<bool> *cancel) {
+  auto begin = Clock::now();
+  while (true) {
+    double waitMs = 0;
+    {
+      std::lock_guard<std::mutex> lock(hostMutex);
+      if (policy.rateLimit <= 0) {
+        return true;
+      }
+      auto &state = hostLocked(host);
+      auto now = Clock::now();
+      double burst = std::max(1, policy.rateBurst);
+      if (state.tokens < 0) {
+        state.tokens = burst;
+      } else {
+        double seconds = std::chrono::duration<double>(now - state.refilled).count();
+        state.tokens = std::min(burst, state.tokens + seconds * policy.rateLimit);
+      }
+      state.refilled = now;
+      if (state.tokens >= 1) {
+        state.tokens -= 1;
+        state.stats.throttledMs += elapsedMs(begin);
+        return true;
+      }
+      waitMs = (1 - state.tokens) * 1000.0 / policy.rateLimit;
+    }
+    if (!sleepFor(std::min(waitMs, 50.0), cancel)) {
+      return false;
+    }
+  }
+}
+
+// 记录发出的一次请求（含重试），每个请求为重试预算积累额度
+void recordAttempt(const std::string &host) {
+  std::lock_guard<std::mutex> lock(hostMutex);
+  auto &state = hostLocked(host);
+  ++state.stats.requests;
+  state.retryTokens = std::min(10.0, state.retryTokens + policy.retryBudget);
+}
+
+// 记录一次查询（重试结束后）的最终结果，更新熔断器（取消的查询不计入）
+void recordOutcome(const std::string &host, bool failed, bool cancelled) {
+  std::lock_guard<std::mutex> lock(hostMutex);
+  auto &state = hostLocked(host);
+  if (cancelled) {
+    state.probing = false; // 探测被取消，允许下一个请求继续探测
+    return;
+  }
+  if (!failed) {
+    if (state.breaker != BreakerState::Closed) {
+      INFO("  >> HTTP circuit closed for %s", host.c_str());
+    }
+    state.breaker = BreakerState::Closed;
+    state.stats.consecutiveFailures = 0;
+    return;
+  }
+  ++state.stats.failures;
+  ++state.stats.consecutiveFailures;
+  if (policy.breakerThreshold > 0 &&
+      (state.breaker == BreakerState::HalfOpen ||
+       (state.breaker == BreakerState::Closed &&
+        state.stats.consecutiveFailures >= policy.breakerThreshold))) {
+    state.breaker = BreakerState::Open;
+    state.openedAt = Clock::now();
+    WARN("  >> HTTP circuit open for %s after %d failures, cache only for %d ms",
+         host.c_str(), state.stats.consecutiveFailures, policy.breakerCooldownMs);
+  }
+}
+
+// 从重试预算中取出一次重试额度
+bool takeRetry(const std::string &host) {
+  std::lock_guard<std::mutex> lock(hostMutex);
+  auto &state = hostLocked(host);
+  if (state.breaker != BreakerState::Closed || state.retryTokens < 1) {
+    return false;
+  }
+  state.retryTokens -= 1;
+  ++state.stats.retries;
+  return true;
+}
+
+// 传输进度回调：取消标志置位时返回非 0，curl 以 CURLE_ABORTED_BY_CALLBACK 结束请求
+int cancelCallback(void *clientp, curl_off_t, curl_off_t, curl_off_t, curl_off_t) {
+  return static_cast<const std::atomic<bool> *>(clientp)->load() ? 1 : 0;
+}
+
+// 单次请求，retryAfterSec 返回 429/503 响应中的 Retry-After（秒，-1 表示没有）
+HttpResponse performOnce(const std::string &url, const HttpPolicy &options,
+                         const std::atomic<bool> *cancel, long &retryAfterSec) {
+  HttpResponse response;
+  retryAfterSec = -1;
+  CURL *curl = curl_easy_init();
+  if (!curl) {
+    response.error = "curl_easy_init failed";
+    return response;
+  }
+  curl_easy_setopt(curl, CURLOPT_URL, url.c_str());
+  curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, WriteCallback);
+  curl_easy_setopt(curl, CURLOPT_WRITEDATA, &response.body);
+  curl_easy_setopt(curl, CURLOPT_USERAGENT, "libwaybar_cffi_lyrics/" BUILD_VERSION);
+  // 多线程中使用超时必须禁用信号
+  curl_easy_setopt(curl, CURLOPT_NOSIGNAL, 1L);
+  curl_easy_setopt(curl, CURLOPT_CONNECTTIMEOUT_MS, static_cast<long>(options.connectTimeoutMs));
+  curl_easy_setopt(curl, CURLOPT_TIMEOUT_MS, static_cast<long>(options.timeoutMs));
+  if (cancel) {
+    curl_easy_setopt(curl, CURLOPT_XFERINFOFUNCTION, cancelCallback);
+    curl_easy_setopt(curl, CURLOPT_XFERINFODATA, cancel);
+    curl_easy_setopt(curl, CURLOPT_NOPROGRESS, 0L);
+  }
+  CURLcode res = curl_easy_perform(curl);
+  if (res == CURLE_ABORTED_BY_CALLBACK) {
+    response.cancelled = true;
+    response.error = "cancelled";
+  } else if (res != CURLE_OK) {
+    response.error = curl_easy_strerror(res);
+  } else {
+    curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &response.status);
+    curl_off_t retryAfter = 0;
+    if (curl_easy_getinfo(curl, CURLINFO_RETRY_AFTER, &retryAfter) == CURLE_OK &&
+        retryAfter > 0) {
+      retryAfterSec = static_cast<long>(retryAfter);
+    }
+  }
+  curl_easy_cleanup(curl);
+  return response;
+}
+
+// 连接错误、超时、429 和 5xx 视为失败，可以重试
+bool retryable(const HttpResponse &response) {
+  return !response.cancelled && !response.definitive();
+}
+
+} // namespace
+
+void setHttpPolicy(const HttpPolicy &newPolicy) {
+  std::lock_guard<std::mutex> lock(hostMutex);
+  policy = newPolicy;
+}
+
+HttpPolicy httpPolicy() {
+  std::lock_guard<std::mutex> lock(hostMutex);
+  return policy;
+}
+
+std::vector<HttpHostStats> httpHostStats() {
+  std::lock_guard<std::mutex> lock(hostMutex);
+  std::vector<HttpHostStats> result;
+  for (const auto &[host, state] : hosts) {
+    result.push_back(state.stats);
+    result.back().breaker = state.breaker;
+  }
+  return result;
+}
+
+void reportHttpOutcome(const std::string &url, bool failed, bool cancelled) {
+  recordOutcome(hostOf(url), failed, cancelled);
+}
+
+HttpResponse httpGet(const std::string &url, const std::atomic<bool> *cancel,
+                     bool reportOutcome) {
+  TraceSpan span("http.get", url);
+  auto begin = Clock::now();
+  std::string host = hostOf(url);
+  HttpPolicy options = httpPolicy();
+  HttpResponse response;
+  if (!admit(host)) {
+    response.rejected = true;
+    response.error = "circuit open";
+    return response;
+  }
+  thread_local std::mt19937 random(std::random_device{}());
+  for (int attempt = 0;; ++attempt) {
+    if (!acquireToken(host, cancel)) {
+      response = HttpResponse{};
+      response.cancelled = true;
+      response.error = "cancelled";
+      break;
+    }
+    long retryAfterSec = -1;
+    int attempts = response.attempts;
+    response = performOnce(url, options, cancel, retryAfterSec);
+    response.attempts = attempts + 1;
+    recordAttempt(host);
+    if (!retryable(response) || attempt >= options.retries) {
+      break;
+    }
+    // 全抖动指数退避；服务端给出 Retry-After 时至少等待该时间，超过上限则放弃
+    double backoffMs = std::uniform_real_distribution<double>(
+        0, std::min<double>(options.retryMaxMs,
+                            static_cast<double>(options.retryBaseMs) * (1 << attempt)))(random);
+    if (retryAfterSec >= 0) {
+      if (retryAfterSec * 1000 > options.retryMaxMs) {
+        DEBUG("  >> HTTP Retry-After %ld s exceeds limit, not retrying: %s",
+              retryAfterSec, url.c_str());
+        break;
+      }
+      backoffMs = std::max(backoffMs, retryAfterSec * 1000.0);
+    }
+    if (!takeRetry(host)) {
+      DEBUG("  >> HTTP retry budget exhausted for %s", host.c_str());
+      break;
+    }
+    DEBUG("  >> HTTP retry %d for %s in %.0f ms (%s)", attempt + 1, url.c_str(),
+          backoffMs,
+          response.error.empty() ? std::to_string(response.status).c_str()
+                                 : response.error.c_str());
+    if (!sleepFor(backoffMs, cancel)) {
+      response.cancelled = true;
+      response.error = "cancelled";
+      break;
+    }
+  }
+  if (reportOutcome) {
+    recordOutcome(host, retryable(response), response.cancelled);
+  }
+  response.elapsedMs = elapsedMs(begin);
+  if (!response.cancelled) {
+    static Histogram &requestMs = metrics().histogram("http.request_ms");
+    requestMs.observe(response.elapsedMs);
+  }
+  return response;
+}
@@ -0,0 +1,118 @@
+#include "../include/karaoke_renderer.h"
+#include "common.h"
+#include <algorithm>
+
+KaraokeRenderer::KaraokeRenderer(GtkLabel *label,
+                                 std::shared_ptr<const PlaybackClock> clock,
+                                 int fps, const std::string &color)
+    : label_(label), clock_(std::move(clock)),
+      frameIntervalUs_(1000000 / std::clamp(fps, 1, 60)) {
+  if (!color.empty() && !pango_color_parse(&color_, color.c_str())) {
+    WARN("  >> Invalid karaoke color: %s", color.c_str());
+  }
+  if (label_) {
+    g_object_add_weak_pointer(G_OBJECT(label_),
+                              reinterpret_cast<gpointer *>(&label_));
+  }
+}
+
+KaraokeRenderer::~KaraokeRenderer() {
+  stopTicking();
+  if (label_) {
+    g_object_remove_weak_pointer(G_OBJECT(label_),
+                                 reinterpret_cast<gpointer *>(&label_));
+  }
+}
+
+void KaraokeRenderer::setLine(std::shared_ptr<const LyricsTimeline> timeline,
+                              size_t index, size_t offset,
+                              uint64_t trackLengthMs) {
+  if (!label_) {
+    return;
+  }
+  // 标签文本已被替换，旧属性的偏移失效，需要重新渲染
+  timeline_ = std::move(timeline);
+  index_ = index;
+  offset_ = offset;
+  trackLengthMs_ = trackLengthMs;
+  lastSung_ = LyricsTimeline::npos;
+  if (!timeline_ || index_ >= timeline_->lines.size() ||
+      timeline_->lines[index_].words.empty()) {
+    clear();
+    return;
+  }
+  fullSung_ = timeline_->sungBytes(index_, UINT64_MAX, trackLengthMs_);
+  render(clock_->positionMs());
+  if (clock_->isPlaying() && lastSung_ < fullSung_) {
+    startTicking();
+  } else {
+    stopTicking();
+  }
+}
+
+void KaraokeRenderer::clear() {
+  stopTicking();
+  timeline_.reset();
+  index_ = LyricsTimeline::npos;
+  if (label_ && lastSung_ != 0) {
+    gtk_label_set_attributes(label_, nullptr);
+  }
+  lastSung_ = 0;
+}
+
+void KaraokeRenderer::render(uint64_t positionMs) {
+  if (!label_ || !timeline_) {
+    return;
+  }
+  size_t sung = timeline_->sungBytes(index_, positionMs, trackLengthMs_);
+  if (sung == lastSung_) {
+    return; // 已唱部分没有变化，不触发重新布局
+  }
+  lastSung_ = sung;
+  PangoAttrList *attrs = pango_attr_list_new();
+  if (sung > 0) {
+    PangoAttribute *attr =
+        pango_attr_foreground_new(color_.red, color_.green, color_.blue);
+    attr->start_index = static_cast<guint>(offset_);
+    attr->end_index = static_cast<guint>(offset_ + sung);
+    pango_attr_list_insert(attrs, attr);
+  }
+  gtk_label_set_attributes(label_, attrs);
+  pango_attr_list_unref(attrs);
+}
+
+gboolean KaraokeRenderer::onTick(GtkWidget *, GdkFrameClock *frameClock,
+                                 gpointer data) {
+  auto *self = static_cast<KaraokeRenderer *>(data);
+  gint64 now = gdk_frame_clock_get_frame_time(frameClock);
+  if (now - self->lastFrameUs_ < self->frameIntervalUs_) {
+    return G_SOURCE_CONTINUE; // 限制帧率
+  }
+  self->lastFrameUs_ = now;
+  if (!self->clock_->isPlaying()) {
+    self->tickId_ = 0;
+    return G_SOURCE_REMOVE; // 暂停后停止回调，恢复播放时由 setLine 重新启动
+  }
+  self->render(self->clock_->positionMs());
+  if (self->lastSung_ >= self->fullSung_) {
+    self->tickId_ = 0;
+    return G_SOURCE_REMOVE; // 整行已唱完，下一行由 setLine 重新启动
+  }
+  return G_SOURCE_CONTINUE;
+}
+
+void KaraokeRenderer::startTicking() {
+  if (tickId_ || !label_) {
+    return;
+  }
+  lastFrameUs_ = 0;
+  tickId_ = gtk_widget_add_tick_callback(GTK_WIDGET(label_), onTick, this,
+                                         nullptr);
+}
+
+void KaraokeRenderer::stopTicking() {
+  if (tickId_ && label_) {
+    gtk_widget_remove_tick_callback(GTK_WIDGET(label_), tickId_);
+  }
+  tickId_ = 0;
+}
@@ -0,0 +1,321 @@
+#include "../include/lyrics_timeline.h"
+#include "../include/display_width.h"
+#include "common.h"
+#include <algorithm>
+#include <cctype>
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+bool parseLrcTimeTag(std::string_view tag, uint64_t &ms) {
+  size_t colon = tag.find(':');
+  if (colon == 0 || colon == std::string_view::npos) {
+    return false;
+  }
+  uint64_t minutes = 0, seconds = 0, fraction = 0;
+  size_t i = 0;
+  for (; i < colon; ++i) {
+    if (tag[i] < '0' || tag[i] > '9')
+      return false;
+    minutes = minutes * 10 + (tag[i] - '0');
+  }
+  size_t digits = 0;
+  for (i = colon + 1; i < tag.size() && tag[i] != '.'; ++i) {
+    if (tag[i] < '0' || tag[i] > '9')
+      return false;
+    seconds = seconds * 10 + (tag[i] - '0');
+    ++digits;
+  }
+  if (digits == 0) {
+    return false;
+  }
+  // 小数部分：按位数换算成毫秒（.9 → 900ms, .94 → 940ms, .945 → 945ms）
+  uint64_t scale = 100;
+  for (i = i + 1; i < tag.size(); ++i) {
+    if (tag[i] < '0' || tag[i] > '9')
+      return false;
+    fraction += (tag[i] - '0') * scale;
+    scale /= 10;
+  }
+  ms = minutes * 60000 + seconds * 1000 + fraction;
+  return true;
+}
+
+// 解析一行LRC中时间标签之后的正文，处理逐字时间 <mm:ss.xx>
+static void parseLineBody(std::string_view body, LyricLine &line) {
+  line.text.reserve(body.size());
+  // 追加普通文本（行首空白去掉），并延长当前正在记录的字
+  auto append = [&line](std::string_view segment) {
+    if (line.text.empty()) {
+      segment.remove_prefix(
+          std::min(segment.find_first_not_of(" \t"), segment.size()));
+    }
+    if (segment.empty()) {
+      return;
+    }
+    line.text.append(segment);
+    if (!line.words.empty()) {
+      line.words.back().end = static_cast<uint32_t>(line.text.size());
+    }
+  };
+  size_t pos = 0;
+  while (pos < body.size()) {
+    size_t lt = body.find('<', pos);
+    if (lt == std::string_view::npos) {
+      append(body.substr(pos));
+      break;
+    }
+    append(body.substr(pos, lt - pos));
+    size_t gt = body.find('>', lt);
+    if (gt == std::string_view::npos) {
+      append(body.substr(lt));
+      break;
+    }
+    uint64_t ms = 0;
+    if (parseLrcTimeTag(body.substr(lt + 1, gt - lt - 1), ms)) {
+      // 新的逐字时间：从当前文本末尾开始一个新字
+      auto offset = static_cast<uint32_t>(line.text.size());
+      line.words.push_back({ms, offset, offset});
+    } else {
+      append(body.substr(lt, gt - lt + 1)); // 不是时间标签，按普通文本处理
+    }
+    pos = gt + 1;
+  }
+  // 去掉尾部空白，同时修正逐字偏移
+  size_t end = line.text.find_last_not_of(" \t\r");
+  line.text.resize(end == std::string::npos ? 0 : end + 1);
+  for (auto &word : line.words) {
+    word.begin = std::min<uint32_t>(word.begin, line.text.size());
+    word.end = std::min<uint32_t>(word.end, line.text.size());
+  }
+  // 末尾没有文本的时间标签表示最后一个字的结束时间
+  while (!line.words.empty() && line.words.back().begin == line.words.back().end) {
+    line.endMs = line.words.back().startMs;
+    line.words.pop_back();
+  }
+}
+
+// 大小写无关比较标签名（标签名都是ASCII）
+static bool tagEquals(std::string_view a, std::string_view b) {
+  if (a.size() != b.size()) {
+    return false;
+  }
+  for (size_t i = 0; i < a.size(); ++i) {
+    if (std::tolower(static_cast<unsigned char>(a[i])) != b[i]) {
+      return false;
+    }
+  }
+  return true;
+}
+
+static std::string_view trimView(std::string_view sv) {
+  size_t begin = sv.find_first_not_of(" \t\r");
+  if (begin == std::string_view::npos) {
+    return {};
+  }
+  size_t end = sv.find_last_not_of(" \t\r");
+  return sv.substr(begin, end - begin + 1);
+}
+
+// 解析 [offset:+300] 的值（毫秒，正数表示歌词提前显示）
+static int64_t parseOffset(std::string_view value) {
+  value = trimView(value);
+  bool negative = false;
+  if (!value.empty() && (value.front() == '+' || value.front() == '-')) {
+    negative = value.front() == '-';
+    value.remove_prefix(1);
+  }
+  int64_t result = 0;
+  for (char c : value) {
+    if (c < '0' || c > '9') {
+      break;
+    }
+    result = result * 10 + (c - '0');
+  }
+  return negative ? -result : result;
+}
+
+// 处理元数据标签 [key:value]
+static void parseHeader(std::string_view key, std::string_view value,
+                        LyricsTimeline &timeline) {
+  value = trimView(value);
+  if (tagEquals(key, "ti")) {
+    timeline.title = value;
+  } else if (tagEquals(key, "ar")) {
+    timeline.artist = value;
+  } else if (tagEquals(key, "al")) {
+    timeline.album = value;
+  } else if (tagEquals(key, "by")) {
+    timeline.by = value;
+  } else if (tagEquals(key, "offset")) {
+    timeline.offsetMs = parseOffset(value);
+  } else if (tagEquals(key, "length")) {
+    parseLrcTimeTag(value, timeline.lengthMs);
+  }
+}
+
+// 判断文本是否包含日文假名或韩文（用于区分罗马音与翻译）
+static bool hasKanaOrHangul(std::string_view text) {
+  for (size_t i = 0; i + 2 < text.size(); ++i) {
+    auto c0 = static_cast<unsigned char>(text[i]);
+    if ((c0 & 0xF0) != 0xE0) {
+      continue;
+    }
+    uint32_t cp = ((c0 & 0x0F) << 12) |
+                  ((static_cast<unsigned char>(text[i + 1]) & 0x3F) << 6) |
+                  (static_cast<unsigned char>(text[i + 2]) & 0x3F);
+    if ((cp >= 0x3040 && cp <= 0x30FF) || (cp >= 0xAC00 && cp <= 0xD7AF) ||
+        (cp >= 0x1100 && cp <= 0x11FF)) {
+      return true;
+    }
+    i += 2;
+  }
+  return false;
+}
+
+static bool isAscii(std::string_view text) {
+  return std::all_of(text.begin(), text.end(), [](char c) {
+    return static_cast<unsigned char>(c) < 0x80;
+  });
+}
+
+// 将时间戳相同的相邻行合并：第一行为原文，其余为翻译或罗马音
+// 原文含假名/韩文且该行为纯ASCII时视为罗马音，否则视为翻译
+static void groupVariants(std::vector<LyricLine> &lines) {
+  size_t out = 0;
+  for (size_t i = 0; i < lines.size(); ++i) {
+    auto &line = lines[i];
+    if (out > 0 && lines[out - 1].timeMs == line.timeMs) {
+      auto &original = lines[out - 1];
+      if (original.text.empty()) {
+        original.text = std::move(line.text);
+        original.words = std::move(line.words);
+        original.endMs = line.endMs;
+      } else if (!line.text.empty() && line.text != original.text) {
+        bool roman = isAscii(line.text) && hasKanaOrHangul(original.text);
+        if (roman && original.romanization.empty()) {
+          original.romanization = std::move(line.text);
+        } else if (original.translation.empty()) {
+          original.translation = std::move(line.text);
+        } else if (original.romanization.empty()) {
+          original.romanization = std::move(line.text);
+        }
+      }
+      continue;
+    }
+    if (out != i) {
+      lines[out] = std::move(line);
+    }
+    ++out;
+  }
+  lines.resize(out);
+}
+
+// 预计算每行显示宽度和截断文本（只有超长的行才保存截断副本）
+static void fitLines(std::vector<LyricLine> &lines, size_t maxColumns) {
+  auto fit = [maxColumns](const std::string &text, std::string &out) {
+    if (displayWidth(text) > maxColumns) {
+      out = truncateColumns(text, maxColumns);
+    }
+  };
+  for (auto &line : lines) {
+    line.width = static_cast<uint32_t>(displayWidth(line.text));
+    if (line.width > maxColumns) {
+      line.fitted = truncateColumns(line.text, maxColumns);
+    }
+    fit(line.translation, line.fittedTranslation);
+    fit(line.romanization, line.fittedRomanization);
+  }
+}
+
+std::shared_ptr<const LyricsTimeline> parseLrc(std::string_view raw,
+                                               size_t maxColumns,
+                                               int64_t syncOffsetMs) {
+  auto timeline = std::make_shared<LyricsTimeline>();
+  timeline->syncOffsetMs = syncOffsetMs;
+  timeline->maxColumns = maxColumns;
+  timeline->lines.reserve(std::count(raw.begin(), raw.end(), '\n') + 1);
+  std::vector<uint64_t> stamps; // 当前行的所有时间标签（重复行）
+  size_t start = 0;
+  while (start < raw.size()) {
+    size_t nl = raw.find('\n', start);
+    std::string_view row = raw.substr(
+        start, (nl == std::string_view::npos ? raw.size() : nl) - start);
+    start = nl == std::string_view::npos ? raw.size() : nl + 1;
+
+    row.remove_prefix(std::min(row.find_first_not_of(" \t\xEF\xBB\xBF"), row.size()));
+    if (row.empty() || row.front() != '[') {
+      continue;
+    }
+    // 读取行首连续的标签：时间标签收集到 stamps，其余作为元数据
+    stamps.clear();
+    while (!row.empty() && row.front() == '[') {
+      size_t close = row.find(']');
+      if (close == std::string_view::npos) {
+        break;
+      }
+      std::string_view tag = row.substr(1, close - 1);
+      uint64_t ms = 0;
+      if (parseLrcTimeTag(tag, ms)) {
+        stamps.push_back(ms);
+      } else if (stamps.empty()) {
+        size_t colon = tag.find(':');
+        if (colon != std::string_view::npos) {
+          parseHeader(trimView(tag.substr(0, colon)), tag.substr(colon + 1),
+                      *timeline);
+        }
+      } else {
+        break; // 时间标签之后的方括号属于歌词正文
+      }
+      row.remove_prefix(close + 1);
+    }
+    if (stamps.empty()) {
+      continue;
+    }
+    LyricLine line;
+    line.timeMs = stamps.front();
+    parseLineBody(row, line);
+    // 同一行歌词对应多个时间点时展开为多行，逐字时间按相对偏移平移
+    for (size_t i = 1; i < stamps.size(); ++i) {
+      LyricLine copy = line;
+      int64_t shift = static_cast<int64_t>(stamps[i]) -
+                      static_cast<int64_t>(stamps.front());
+      copy.timeMs = stamps[i];
+      for (auto &word : copy.words) {
+        word.startMs += shift;
+      }
+      if (copy.endMs) {
+        copy.endMs += shift;
+      }
+      timeline->lines.push_back(std::move(copy));
+    }
+    timeline->lines.push_back(std::move(line));
+  }
+  std::stable_sort(
+      timeline->lines.begin(), timeline->lines.end(),
+      [](const LyricLine &a, const LyricLine &b) { return a.timeMs < b.timeMs; });
+  groupVariants(timeline->lines);
+  if (maxColumns > 0) {
+    fitLines(timeline->lines, maxColumns);
+  }
+
+  // [offset:] 和同步校准偏移在解析时一次性应用：正数表示歌词提前
+  if (int64_t totalOffset = timeline->offsetMs + syncOffsetMs; totalOffset != 0) {
+    auto shift = [offset = totalOffset](uint64_t &ms) {
+      int64_t value = static_cast<int64_t>(ms) - offset;
+      ms = value > 0 ? static_cast<uint64_t>(value) : 0;
+    };
+    for (auto &line : timeline->lines) {
+      shift(line.timeMs);
+      if (line.endMs) {
+        shift(line.endMs);
+      }
+      for (auto &word : line.words) {
+        shift(word.startMs);
+      }
+    }
+  }
+  DEBUG("  >> parseLrc: %zu lines, offset=%ld ms, sync offset=%ld ms",
+        timeline->lines.size(), timeline->offsetMs, syncOffsetMs);
+  return timeline;
+}
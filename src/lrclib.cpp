@@ -0,0 +1,398 @@
+#include "../include/lrclib.h"
+#include "../include/http_client.h"
+#include "../include/trace.h"
+#include "../include/track_key.h"
+#include "../include/utils.hpp"
+#include "common.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <nlohmann/json.hpp>
+
+// 文本匹配得分：完全相同 full，互相包含 partial，否则 0
+static int matchScore(const std::string &expected, const std::string &actual,
+                      int full, int partial) {
+  if (expected.empty() || actual.empty()) {
+    return 0;
+  }
+  if (expected == actual) {
+    return full;
+  }
+  if (actual.find(expected) != std::string::npos ||
+      expected.find(actual) != std::string::npos) {
+    return partial;
+  }
+  return 0;
+}
+
+namespace {
+
+// SAX 处理器：只跟踪候选对象的顶层字段，嵌套结构全部跳过
+class LrclibSaxScorer : public nlohmann::json_sax<nlohmann::json> {
+public:
+  explicit LrclibSaxScorer(const LrclibQuery &query)
+      : title_(canonicalTitle(query.title)),
+        artist_(canonicalArtist(query.artist)),
+        durationMs_(query.durationMs) {}
+
+  LrclibMatch result;
+
+  bool null() override { return value(); }
+  bool boolean(bool val) override {
+    if (inField("instrumental")) {
+      current_.instrumental = val;
+    }
+    return value();
+  }
+  bool number_integer(number_integer_t val) override {
+    return number(static_cast<double>(val));
+  }
+  bool number_unsigned(number_unsigned_t val) override {
+    return number(static_cast<double>(val));
+  }
+  bool number_float(number_float_t val, const string_t &) override {
+    return number(val);
+  }
+  bool string(string_t &val) override {
+    if (inField("trackName")) {
+      current_.title = canonicalTitle(val);
+    } else if (inField("artistName")) {
+      current_.artist = canonicalArtist(val);
+    } else if (inField("syncedLyrics")) {
+      current_.syncedLyrics = std::move(val); // 只有同步歌词会被保留
+    }
+    return value();
+  }
+  bool binary(binary_t &) override { return value(); }
+  bool start_object(std::size_t) override {
+    ++depth_;
+    // 顶层为对象（/api/get）时深度1即候选，顶层为数组（/api/search）时深度2为候选
+    if (depth_ == candidateDepth()) {
+      current_ = Candidate{};
+    }
+    return true;
+  }
+  bool key(string_t &val) override {
+    if (depth_ == candidateDepth()) {
+      key_ = std::move(val);
+    }
+    return true;
+  }
+  bool end_object() override {
+    if (depth_ == candidateDepth()) {
+      finishCandidate();
+    }
+    --depth_;
+    return value();
+  }
+  bool start_array(std::size_t) override {
+    if (depth_ == 0) {
+      topIsArray_ = true;
+    }
+    ++depth_;
+    return true;
+  }
+  bool end_array() override {
+    --depth_;
+    return value();
+  }
+  bool parse_error(std::size_t position, const std::string &,
+                   const nlohmann::detail::exception &ex) override {
+    WARN("  >> lrclib JSON parse error at %zu: %s", position, ex.what());
+    return false;
+  }
+
+private:
+  struct Candidate {
+    std::string title;
+    std::string artist;
+    std::string syncedLyrics;
+    double durationSec = -1;
+    bool instrumental = false;
+  };
+
+  size_t candidateDepth() const { return topIsArray_ ? 2 : 1; }
+  bool inField(const char *name) const {
+    return depth_ == candidateDepth() && key_ == name;
+  }
+  bool value() {
+    if (depth_ == candidateDepth()) {
+      key_.clear();
+    }
+    return true;
+  }
+  bool number(double val) {
+    if (inField("duration")) {
+      current_.durationSec = val;
+    }
+    return value();
+  }
+
+  // 候选对象结束：打分，得分更高时才接管它的歌词
+  void finishCandidate() {
+    ++result.candidates;
+    if (current_.syncedLyrics.empty() || current_.instrumental) {
+      return; // 没有同步歌词的候选无法显示
+    }
+    int score = 100;
+    if (durationMs_ > 0 && current_.durationSec >= 0) {
+      double diff = std::fabs(current_.durationSec * 1000.0 -
+                              static_cast<double>(durationMs_)) / 1000.0;
+      score += diff <= 2 ? 40 : diff <= 5 ? 25 : diff <= 10 ? 10
+             : diff <= 30 ? 0 : -50;
+    }
+    score += matchScore(title_, current_.title, 30, 15);
+    score += matchScore(artist_, current_.artist, 20, 10);
+    if (result.syncedLyrics.empty() || score > result.score) {
+      result.score = score;
+      result.syncedLyrics = std::move(current_.syncedLyrics);
+    }
+  }
+
+  std::string title_;
+  std::string artist_;
+  uint64_t durationMs_;
+  size_t depth_ = 0;
+  bool topIsArray_ = false;
+  std::string key_;
+  Candidate current_;
+};
+
+} // namespace
+
+LrclibMatch extractBestLyrics(std::string_view json, const LrclibQuery &query) {
+  TraceSpan span("lrclib.parse");
+  LrclibSaxScorer scorer(query);
+  if (!nlohmann::json::sax_parse(json.begin(), json.end(), &scorer)) {
+    return {};
+  }
+  DEBUG("  >> lrclib: %zu candidates, best score %d", scorer.result.candidates,
+        scorer.result.score);
+  return std::move(scorer.result);
+}
+
+namespace {
+
+// 对冲查询的共享状态：由查询线程共享，决出结果后被取消的线程仍可安全访问
+struct Hedge {
+  struct Lane {
+    LrclibStage stage;
+    std::string url;
+    std::string syncedLyrics;
+    size_t after = npos;  // 发出条件：该阶段完成（未命中）后发出，npos 表示立即发出
+    int delayMs = -1;     // after 阶段发出后多久对冲发出本阶段，-1 表示只等 after 完成
+    std::chrono::steady_clock::time_point launchedAt;
+    bool started = false;
+    bool done = false;
+    bool rejected = false; // 熔断器打开，请求未发出
+  };
+  static constexpr size_t npos = static_cast<size_t>(-1);
+  std::mutex mutex;
+  std::condition_variable cv;
+  std::atomic<bool> cancel{false}; // 决出结果后置位，中止仍在进行的请求
+  std::vector<Lane> lanes;         // 按优先级排列
+};
+
+// 执行一个阶段：请求 → 流式解析打分 → 记录耗时
+void runLane(const std::shared_ptr<Hedge> &hedge, size_t index,
+             const LrclibQuery &query) {
+  std::string url;
+  LrclibStage stage;
+  {
+    std::lock_guard<std::mutex> lock(hedge->mutex);
+    url = hedge->lanes[index].url;
+    stage.name = hedge->lanes[index].stage.name;
+  }
+  const char *name = stage.name.c_str();
+  traceThreadName("lrclib");
+  TraceSpan span("lrclib.stage", stage.name);
+  DEBUG("  >> lrclib stage [%s]: %s", name, url.c_str());
+  // 熔断器按整次查询计数（见 lookupLrclib），并发阶段同时失败只算一次
+  auto response = httpGet(url, &hedge->cancel, false);
+  std::string syncedLyrics;
+  stage.status = response.status;
+  stage.latencyMs = response.elapsedMs;
+  stage.failed = !response.cancelled && !response.definitive();
+  if (response.cancelled) {
+    stage.cancelled = true;
+    DEBUG("  >> lrclib stage [%s]: cancelled after %.1f ms", name, stage.latencyMs);
+  } else {
+    if (response.ok()) {
+      syncedLyrics = extractBestLyrics(response.body, query).syncedLyrics;
+      stage.hit = !syncedLyrics.empty();
+    } else if (response.rejected) {
+      DEBUG("  >> lrclib stage [%s]: circuit open, skipped", name);
+    } else if (!response.error.empty()) {
+      WARN("  >> lrclib stage [%s] CURL error: %s", name, response.error.c_str());
+    } else if (response.status != 404) {
+      WARN("  >> lrclib stage [%s] HTTP error: %ld", name, response.status);
+    }
+    INFO("  >> lrclib stage [%s]: status=%ld hit=%d %.1f ms", name,
+         stage.status, stage.hit, stage.latencyMs);
+  }
+  std::lock_guard<std::mutex> lock(hedge->mutex);
+  auto &lane = hedge->lanes[index];
+  lane.stage = std::move(stage);
+  lane.syncedLyrics = std::move(syncedLyrics);
+  lane.rejected = response.rejected;
+  lane.done = true;
+  hedge->cv.notify_all();
+}
+
+} // namespace
+
+bool LrclibLookup::unavailable() const {
+  if (!syncedLyrics.empty()) {
+    return false;
+  }
+  bool failed = false;
+  for (const auto &stage : stages) {
+    if (!stage.cancelled && !stage.failed) {
+      return false; // 至少一个阶段得到了明确的“未找到”
+    }
+    failed = failed || stage.failed;
+  }
+  return failed;
+}
+
+LrclibLookup lookupLrclib(const std::string &baseUrl, const LrclibQuery &query,
+                          int hedgeDelayMs) {
+  TraceSpan span("lookupLrclib", query.title);
+  LrclibLookup lookup;
+  if (query.title.empty()) {
+    return lookup;
+  }
+  auto hedge = std::make_shared<Hedge>();
+  auto addLane = [&](const char *name, std::string url, size_t after, int delayMs) {
+    Hedge::Lane lane;
+    lane.stage.name = name;
+    lane.url = std::move(url);
+    lane.after = after;
+    lane.delayMs = delayMs;
+    hedge->lanes.push_back(std::move(lane));
+    return hedge->lanes.size() - 1;
+  };
+  // 精确匹配需要艺术家和时长（lrclib 按 ±2 秒匹配时长），单独发出，未命中后才搜索
+  size_t get = Hedge::npos;
+  if (!query.artist.empty() && query.durationMs > 0) {
+    std::string params = "track_name=" + url_encode(query.title) +
+                         "&artist_name=" + url_encode(query.artist) +
+                         "&duration=" + std::to_string((query.durationMs + 500) / 1000);
+    if (!query.album.empty()) {
+      params += "&album_name=" + url_encode(query.album);
+    }
+    get = addLane("get", baseUrl + "/api/get?" + params, Hedge::npos, -1);
+  }
+  // 模糊搜索（按优先级）：原始标题+艺术家、规范化标题+主艺术家、仅规范化标题。
+  // 带艺术家的搜索和不带艺术家的标题搜索在精确匹配未命中后同时发出（一个往返），
+  // 规范化标题+主艺术家在带艺术家的搜索未命中或发出 hedgeDelayMs 后仍无结果时发出
+  size_t search = Hedge::npos;
+  for (const auto &variant : queryVariants(query.title, query.artist)) {
+    std::string url = baseUrl + "/api/search?track_name=" + url_encode(variant.title);
+    if (variant.artist.empty()) {
+      addLane("search-title", std::move(url), get, -1);
+      continue;
+    }
+    url += "&artist_name=" + url_encode(variant.artist);
+    if (search == Hedge::npos) {
+      search = addLane(variant.title == query.title ? "search" : "search-clean", std::move(url),
+                       get, -1);
+    } else {
+      addLane("search-clean", std::move(url), search, hedgeDelayMs);
+    }
+  }
+  if (hedge->lanes.empty()) {
+    return lookup;
+  }
+
+  // 按优先级裁决：已发出的更高优先级阶段全部未命中后，才采用较低优先级的命中结果；
+  // 有阶段命中后不再发出新阶段，决出后取消其余请求
+  using SteadyClock = std::chrono::steady_clock;
+  std::unique_lock<std::mutex> lock(hedge->mutex);
+  auto launch = [&](size_t i) {
+    hedge->lanes[i].started = true;
+    hedge->lanes[i].launchedAt = SteadyClock::now();
+    std::thread([hedge, i, query]() { runLane(hedge, i, query); }).detach();
+  };
+  size_t winner = hedge->lanes.size();
+  while (true) {
+    bool hit = false;
+    for (const auto &lane : hedge->lanes) {
+      hit = hit || (lane.done && lane.stage.hit);
+    }
+    bool decided = true;
+    for (size_t i = 0; i < hedge->lanes.size(); ++i) {
+      const auto &lane = hedge->lanes[i];
+      if (lane.done && lane.stage.hit) {
+        winner = i;
+        break;
+      }
+      if (lane.done || (!lane.started && hit)) {
+        continue; // 未命中，或已有命中结果、不会再发出
+      }
+      decided = false;
+      break;
+    }
+    if (decided) {
+      break;
+    }
+    // 发出满足条件的阶段，并计算下一个对冲时间
+    std::optional<SteadyClock::time_point> nextLaunch;
+    for (size_t i = 0; i < hedge->lanes.size() && !hit; ++i) {
+      auto &lane = hedge->lanes[i];
+      if (lane.started) {
+        continue;
+      }
+      const Hedge::Lane *after = lane.after == Hedge::npos ? nullptr : &hedge->lanes[lane.after];
+      if (!after || after->done) {
+        launch(i);
+      } else if (after->started && lane.delayMs >= 0) {
+        auto at = after->launchedAt + std::chrono::milliseconds(lane.delayMs);
+        if (at <= SteadyClock::now()) {
+          DEBUG("  >> lrclib stage [%s]: hedging after %d ms", lane.stage.name.c_str(),
+                lane.delayMs);
+          launch(i);
+        } else if (!nextLaunch || at < *nextLaunch) {
+          nextLaunch = at;
+        }
+      }
+    }
+    if (nextLaunch) {
+      hedge->cv.wait_until(lock, *nextLaunch);
+    } else {
+      hedge->cv.wait(lock);
+    }
+  }
+  hedge->cancel = true;
+  // 整次查询只向熔断器报告一次：任一阶段得到明确答复即成功，否则实际发出的阶段都失败才算失败
+  bool attempted = false, answered = false, failed = false;
+  for (size_t i = 0; i < hedge->lanes.size(); ++i) {
+    auto &lane = hedge->lanes[i];
+    if (!lane.started) {
+      continue;
+    }
+    LrclibStage stage = lane.stage;
+    if (!lane.done) {
+      stage.cancelled = true; // 仍在进行，已被取消（可能占用了半开探测）
+      attempted = true;
+    } else if (!lane.rejected) {
+      attempted = true;
+      answered = answered || (!stage.cancelled && !stage.failed);
+      failed = failed || stage.failed;
+    }
+    lookup.stages.push_back(std::move(stage));
+    if (i == winner) {
+      lookup.syncedLyrics = std::move(lane.syncedLyrics);
+    }
+  }
+  if (attempted) {
+    reportHttpOutcome(hedge->lanes.front().url, !answered && failed, !answered && !failed);
+  }
+  return lookup;
+}
@@ -0,0 +1,447 @@
+#include "../include/lyrics_library.h"
+#include "../include/lyrics_timeline.h"
+#include "../include/mapped_file.h"
+#include "../include/track_key.h"
+#include "../include/utils.hpp"
+#include "common.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <chrono>
+#include <fstream>
+#include <limits>
+#include <mutex>
+#include <optional>
+#include <poll.h>
+#include <strings.h>
+#include <sys/eventfd.h>
+#include <sys/inotify.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+constexpr const char *indexMagic = "waylyrics-library\t1";
+// 只解析文件开头部分获取头部标签（[ti:] [ar:] [length:] 位于歌词正文之前）
+constexpr size_t headerScanBytes = 8192;
+constexpr uint32_t watchMask = IN_CLOSE_WRITE | IN_MOVED_TO | IN_MOVED_FROM |
+                               IN_CREATE | IN_DELETE | IN_ONLYDIR;
+
+static bool isLrcFile(const std::filesystem::path &path) {
+  return strcasecmp(path.extension().c_str(), ".lrc") == 0;
+}
+
+static std::string entryKey(std::string_view title, std::string_view artist) {
+  return makeTrackKey(title, artist).str();
+}
+
+// 解析单个歌词文件的索引信息，不是有效的同步歌词文件时返回空
+static std::optional<LibraryEntry> parseEntry(const std::string &path) {
+  struct stat st {};
+  if (::stat(path.c_str(), &st) != 0 || !S_ISREG(st.st_mode)) {
+    return std::nullopt;
+  }
+  MappedFile file(path);
+  if (!file.valid()) {
+    return std::nullopt;
+  }
+  auto view = file.view();
+  auto timeline = parseLrc(view.substr(0, std::min(view.size(), headerScanBytes)));
+  if (timeline->empty()) {
+    return std::nullopt;
+  }
+  LibraryEntry entry;
+  entry.path = path;
+  entry.title = timeline->title;
+  entry.artist = timeline->artist;
+  entry.lengthMs = timeline->lengthMs;
+  entry.mtime = st.st_mtime;
+  // 缺少标签时从文件名 "<艺术家> - <标题>.lrc" 或 "<标题>.lrc" 中获取
+  std::string stem = std::filesystem::path(path).stem().string();
+  size_t dash = stem.find(" - ");
+  if (entry.title.empty()) {
+    entry.title = dash == std::string::npos ? stem : stem.substr(dash + 3);
+  }
+  if (entry.artist.empty() && dash != std::string::npos) {
+    entry.artist = stem.substr(0, dash);
+  }
+  return entry;
+}
+
+LyricsLibrary::LyricsLibrary(std::vector<std::filesystem::path> dirs,
+                             std::filesystem::path indexFile)
+    : dirs_(std::move(dirs)), indexFile_(std::move(indexFile)) {}
+
+LyricsLibrary::~LyricsLibrary() { stop(); }
+
+void LyricsLibrary::start() {
+  if (running_.exchange(true)) {
+    return;
+  }
+  wakeFd_ = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+  thread_ = std::thread([this]() { run(); });
+}
+
+void LyricsLibrary::stop() {
+  if (!running_.exchange(false)) {
+    return;
+  }
+  if (wakeFd_ >= 0) {
+    uint64_t one = 1;
+    [[maybe_unused]] auto n = ::write(wakeFd_, &one, sizeof(one));
+  }
+  if (thread_.joinable()) {
+    thread_.join();
+  }
+  if (dirty_) {
+    saveIndex();
+  }
+  for (int fd : {inotifyFd_, wakeFd_}) {
+    if (fd >= 0) {
+      ::close(fd);
+    }
+  }
+  inotifyFd_ = wakeFd_ = -1;
+  watches_.clear();
+}
+
+size_t LyricsLibrary::size() const {
+  std::shared_lock<std::shared_mutex> lock(mutex_);
+  return entries_.size();
+}
+
+std::string LyricsLibrary::lookup(const std::string &title,
+                                  const std::string &artist,
+                                  uint64_t durationMs) const {
+  if (title.empty()) {
+    return "";
+  }
+  std::shared_lock<std::shared_mutex> lock(mutex_);
+  const std::vector<std::string> *paths = nullptr;
+  bool artistMatched = false;
+  if (!artist.empty()) {
+    auto it = byKey_.find(entryKey(title, artist));
+    if (it != byKey_.end()) {
+      paths = &it->second;
+      artistMatched = true;
+    }
+  }
+  if (!paths) {
+    auto it = byTitle_.find(canonicalTitle(title));
+    if (it == byTitle_.end()) {
+      return "";
+    }
+    paths = &it->second;
+  }
+  // 时长最接近者优先；只按标题命中时要求时长已知且相差不超过 3 秒，避免同名歌曲误配
+  std::string best;
+  uint64_t bestDiff = std::numeric_limits<uint64_t>::max();
+  for (const auto &path : *paths) {
+    const auto &entry = entries_.at(path);
+    bool known = durationMs > 0 && entry.lengthMs > 0;
+    uint64_t diff = known ? (entry.lengthMs > durationMs ? entry.lengthMs - durationMs
+                                                         : durationMs - entry.lengthMs)
+                          : std::numeric_limits<uint64_t>::max() - 1;
+    if (!artistMatched && !artist.empty() && (!known || diff > 3000)) {
+      continue;
+    }
+    if (known && diff > 10000) {
+      continue;
+    }
+    if (best.empty() || diff < bestDiff) {
+      best = path;
+      bestDiff = diff;
+    }
+  }
+  return best;
+}
+
+void LyricsLibrary::insertLocked(LibraryEntry entry) {
+  eraseLocked(entry.path);
+  byKey_[entryKey(entry.title, entry.artist)].push_back(entry.path);
+  byTitle_[canonicalTitle(entry.title)].push_back(entry.path);
+  std::string path = entry.path;
+  entries_.emplace(std::move(path), std::move(entry));
+}
+
+void LyricsLibrary::eraseLocked(const std::string &path) {
+  auto it = entries_.find(path);
+  if (it == entries_.end()) {
+    return;
+  }
+  auto unlink = [&path](auto &index, const std::string &key) {
+    auto slot = index.find(key);
+    if (slot == index.end()) {
+      return;
+    }
+    std::erase(slot->second, path);
+    if (slot->second.empty()) {
+      index.erase(slot);
+    }
+  };
+  unlink(byKey_, entryKey(it->second.title, it->second.artist));
+  unlink(byTitle_, canonicalTitle(it->second.title));
+  entries_.erase(it);
+}
+
+bool LyricsLibrary::loadIndex(EntryMap &entries) const {
+  std::ifstream file(indexFile_);
+  std::string line;
+  if (!file.is_open() || !std::getline(file, line) || line != indexMagic) {
+    return false;
+  }
+  while (std::getline(file, line)) {
+    auto fields = split(line, "\t");
+    if (fields.size() != 5) {
+      continue;
+    }
+    LibraryEntry entry;
+    entry.path = fields[0];
+    entry.mtime = std::strtoll(fields[1].c_str(), nullptr, 10);
+    entry.lengthMs = std::strtoull(fields[2].c_str(), nullptr, 10);
+    entry.title = fields[3];
+    entry.artist = fields[4];
+    entries.emplace(entry.path, std::move(entry));
+  }
+  return true;
+}
+
+void LyricsLibrary::saveIndex() {
+  dirty_ = false;
+  std::vector<LibraryEntry> snapshot;
+  {
+    std::shared_lock<std::shared_mutex> lock(mutex_);
+    snapshot.reserve(entries_.size());
+    for (const auto &[path, entry] : entries_) {
+      snapshot.push_back(entry);
+    }
+  }
+  std::vector<std::string> rows;
+  rows.reserve(snapshot.size());
+  for (const auto &entry : snapshot) {
+    // 路径是索引的键，不能替换字符，含制表符或换行的文件不写入索引
+    if (entry.path.find_first_of("\t\n") != std::string::npos) {
+      continue;
+    }
+    rows.push_back(entry.path + '\t' + std::to_string(entry.mtime) + '\t' +
+                   std::to_string(entry.lengthMs) + '\t' + sanitizeField(entry.title) + '\t' +
+                   sanitizeField(entry.artist));
+  }
+  if (writeTsvFile(indexFile_, indexMagic, rows, "lyrics library index")) {
+    DEBUG("  >> Lyrics library index saved: %zu entries", rows.size());
+  }
+}
+
+LyricsLibrary::EntryMap
+LyricsLibrary::scanDirectories(const EntryMap &previous) const {
+  // 每个歌词目录一个扫描线程，修改时间未变化的文件直接复用已有条目
+  std::vector<std::vector<LibraryEntry>> results(dirs_.size());
+  std::vector<std::thread> workers;
+  for (size_t i = 0; i < dirs_.size(); ++i) {
+    workers.emplace_back([&, i]() {
+      std::error_code ec;
+      auto options = std::filesystem::directory_options::skip_permission_denied;
+      for (std::filesystem::recursive_directory_iterator it(dirs_[i], options, ec), end;
+           !ec && it != end && running_; it.increment(ec)) {
+        if (!isLrcFile(it->path())) {
+          continue;
+        }
+        std::string path = it->path().string();
+        struct stat st {};
+        if (::stat(path.c_str(), &st) != 0) {
+          continue;
+        }
+        auto old = previous.find(path);
+        if (old != previous.end() && old->second.mtime == st.st_mtime) {
+          results[i].push_back(old->second);
+        } else if (auto entry = parseEntry(path)) {
+          results[i].push_back(std::move(*entry));
+        }
+      }
+      if (ec) {
+        WARN("  >> Failed to scan lyrics directory %s: %s", dirs_[i].c_str(),
+             ec.message().c_str());
+      }
+    });
+  }
+  for (auto &worker : workers) {
+    worker.join();
+  }
+  EntryMap entries;
+  for (auto &result : results) {
+    for (auto &entry : result) {
+      std::string path = entry.path;
+      entries.emplace(std::move(path), std::move(entry));
+    }
+  }
+  return entries;
+}
+
+void LyricsLibrary::run() {
+  auto begin = std::chrono::steady_clock::now();
+  EntryMap previous;
+  if (loadIndex(previous)) {
+    std::unique_lock<std::shared_mutex> lock(mutex_);
+    for (const auto &[path, entry] : previous) {
+      insertLocked(entry);
+    }
+    INFO("  >> Lyrics library index loaded: %zu entries", previous.size());
+  }
+  // 先建立监听再扫描，扫描期间发生的修改也不会丢失
+  inotifyFd_ = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+  if (inotifyFd_ < 0) {
+    WARN("  >> inotify_init1 failed: %s, library will not auto-update",
+         strerror(errno));
+  } else {
+    for (const auto &dir : dirs_) {
+      addWatches(dir);
+    }
+  }
+  auto scanned = scanDirectories(previous);
+  {
+    std::unique_lock<std::shared_mutex> lock(mutex_);
+    entries_.clear();
+    byKey_.clear();
+    byTitle_.clear();
+    for (auto &[path, entry] : scanned) {
+      insertLocked(std::move(entry));
+    }
+  }
+  ready_ = true;
+  if (!running_) {
+    return; // 扫描被 stop() 中断，不写回不完整的索引
+  }
+  saveIndex();
+  INFO("  >> Lyrics library ready: %zu entries in %zu dirs (%.1f ms)", size(),
+       dirs_.size(),
+       std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin)
+           .count());
+  if (inotifyFd_ >= 0) {
+    watchLoop();
+  }
+}
+
+void LyricsLibrary::addWatches(const std::filesystem::path &dir) {
+  int wd = inotify_add_watch(inotifyFd_, dir.c_str(), watchMask);
+  if (wd < 0) {
+    WARN("  >> inotify_add_watch %s failed: %s", dir.c_str(), strerror(errno));
+    return;
+  }
+  watches_[wd] = dir.string();
+  std::error_code ec;
+  auto options = std::filesystem::directory_options::skip_permission_denied;
+  for (std::filesystem::recursive_directory_iterator it(dir, options, ec), end;
+       !ec && it != end; it.increment(ec)) {
+    if (it->is_directory(ec)) {
+      wd = inotify_add_watch(inotifyFd_, it->path().c_str(), watchMask);
+      if (wd >= 0) {
+        watches_[wd] = it->path().string();
+      }
+    }
+  }
+}
+
+void LyricsLibrary::updateFile(const std::string &path) {
+  auto entry = parseEntry(path);
+  std::unique_lock<std::shared_mutex> lock(mutex_);
+  if (entry) {
+    insertLocked(std::move(*entry));
+  } else {
+    eraseLocked(path);
+  }
+  dirty_ = true;
+}
+
+void LyricsLibrary::removePath(const std::string &path) {
+  std::unique_lock<std::shared_mutex> lock(mutex_);
+  std::vector<std::string> removed;
+  std::string prefix = path + "/";
+  for (const auto &[entryPath, entry] : entries_) {
+    if (entryPath == path || entryPath.starts_with(prefix)) {
+      removed.push_back(entryPath);
+    }
+  }
+  for (const auto &entryPath : removed) {
+    eraseLocked(entryPath);
+  }
+  dirty_ = dirty_ || !removed.empty();
+}
+
+void LyricsLibrary::watchLoop() {
+  alignas(inotify_event) char buffer[64 * 1024];
+  while (running_) {
+    pollfd fds[2] = {{inotifyFd_, POLLIN, 0}, {wakeFd_, POLLIN, 0}};
+    // 有未保存的修改时，空闲 2 秒后写回索引（合并一批连续修改）
+    int ready = ::poll(fds, 2, dirty_ ? 2000 : -1);
+    if (ready == 0) {
+      saveIndex();
+      continue;
+    }
+    if (ready < 0 || !(fds[0].revents & POLLIN)) {
+      continue; // 被信号中断或 stop() 唤醒
+    }
+    ssize_t length = ::read(inotifyFd_, buffer, sizeof(buffer));
+    for (ssize_t offset = 0; offset < length;) {
+      const auto *event = reinterpret_cast<const inotify_event *>(buffer + offset);
+      offset += sizeof(inotify_event) + event->len;
+      if (event->mask & IN_Q_OVERFLOW) {
+        WARN("  >> inotify queue overflow, rescanning lyrics library");
+        EntryMap current;
+        {
+          std::shared_lock<std::shared_mutex> lock(mutex_);
+          current = entries_;
+        }
+        auto scanned = scanDirectories(current);
+        std::unique_lock<std::shared_mutex> lock(mutex_);
+        entries_.clear();
+        byKey_.clear();
+        byTitle_.clear();
+        for (auto &[path, entry] : scanned) {
+          insertLocked(std::move(entry));
+        }
+        dirty_ = true;
+        continue;
+      }
+      if (event->mask & IN_IGNORED) {
+        watches_.erase(event->wd);
+        continue;
+      }
+      auto dir = watches_.find(event->wd);
+      if (dir == watches_.end() || event->len == 0) {
+        continue;
+      }
+      std::filesystem::path path = std::filesystem::path(dir->second) / event->name;
+      if (event->mask & IN_ISDIR) {
+        if (event->mask & (IN_CREATE | IN_MOVED_TO)) {
+          // 新目录（或移入的目录树）：建立监听并索引其中已有的文件
+          addWatches(path);
+          std::error_code ec;
+          for (std::filesystem::recursive_directory_iterator it(path, ec), end;
+               !ec && it != end; it.increment(ec)) {
+            if (isLrcFile(it->path())) {
+              updateFile(it->path().string());
+            }
+          }
+        } else if (event->mask & (IN_DELETE | IN_MOVED_FROM)) {
+          // 移出的目录树不再监听（删除的目录会收到 IN_IGNORED 自动清理）
+          std::string prefix = path.string() + "/";
+          for (auto it = watches_.begin(); it != watches_.end();) {
+            if (it->second == path.string() || it->second.starts_with(prefix)) {
+              inotify_rm_watch(inotifyFd_, it->first);
+              it = watches_.erase(it);
+            } else {
+              ++it;
+            }
+          }
+          removePath(path.string());
+        }
+      } else if (isLrcFile(path)) {
+        if (event->mask & (IN_CLOSE_WRITE | IN_MOVED_TO)) {
+          DEBUG("  >> Lyrics library update: %s", path.c_str());
+          updateFile(path.string());
+        } else if (event->mask & (IN_DELETE | IN_MOVED_FROM)) {
+          DEBUG("  >> Lyrics library remove: %s", path.c_str());
+          removePath(path.string());
+        }
+      }
+    }
+  }
+}
@@ -0,0 +1,292 @@
+#include "../include/lyrics_prefetcher.h"
+#include "../include/trace.h"
+#include "../include/track_key.h"
+#include "../include/utils.hpp"
+#include "common.h"
+#include <algorithm>
+#include <ctime>
+#include <fstream>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+constexpr const char *historyMagic = "waylyrics-history\t1";
+constexpr size_t historyCapacity = 4096; // 最多记录的“前一首”数量
+constexpr size_t successorLimit = 4;     // 每首歌最多记录的后继数量
+constexpr size_t queueCapacity = 16;     // 预取队列上限
+
+static std::string keyOf(const PlayerMetadata &metadata) {
+  return makeTrackKey(metadata.title, metadata.artist).str();
+}
+
+void TrackHistory::load() {
+  std::ifstream file(file_);
+  std::string line;
+  if (!file.is_open() || !std::getline(file, line) || line != historyMagic) {
+    return;
+  }
+  size_t count = 0;
+  while (std::getline(file, line)) {
+    auto fields = split(line, "\t");
+    if (fields.size() != 8) {
+      continue;
+    }
+    Successor successor;
+    successor.count = static_cast<uint32_t>(std::strtoul(fields[1].c_str(), nullptr, 10));
+    successor.lastSeen = std::strtoll(fields[2].c_str(), nullptr, 10);
+    successor.metadata.title = fields[3];
+    successor.metadata.artist = fields[4];
+    successor.metadata.album = fields[5];
+    successor.metadata.length = std::strtoll(fields[6].c_str(), nullptr, 10);
+    successor.metadata.url = fields[7];
+    successors_[fields[0]].push_back(std::move(successor));
+    ++count;
+  }
+  DEBUG("  >> Track history loaded: %zu transitions", count);
+}
+
+std::vector<std::string> TrackHistory::snapshot() const {
+  dirty_ = false;
+  std::vector<std::string> rows;
+  for (const auto &[from, successors] : successors_) {
+    for (const auto &successor : successors) {
+      const auto &md = successor.metadata;
+      rows.push_back(sanitizeField(from) + '\t' + std::to_string(successor.count) + '\t' +
+                     std::to_string(successor.lastSeen) + '\t' + sanitizeField(md.title) +
+                     '\t' + sanitizeField(md.artist) + '\t' + sanitizeField(md.album) + '\t' +
+                     std::to_string(md.length) + '\t' + sanitizeField(md.url));
+    }
+  }
+  return rows;
+}
+
+void TrackHistory::write(const std::vector<std::string> &rows) const {
+  writeTsvFile(file_, historyMagic, rows, "track history");
+}
+
+void TrackHistory::record(const std::string &fromKey, const PlayerMetadata &next) {
+  std::string nextKey = keyOf(next);
+  if (fromKey == nextKey) {
+    return; // 单曲循环不记录
+  }
+  auto &successors = successors_[fromKey];
+  auto it = std::find_if(successors.begin(), successors.end(),
+                         [&](const Successor &s) { return keyOf(s.metadata) == nextKey; });
+  if (it == successors.end()) {
+    if (successors.size() >= successorLimit) {
+      // 替换出现次数最少的后继
+      successors.erase(std::min_element(
+          successors.begin(), successors.end(),
+          [](const Successor &a, const Successor &b) { return a.count < b.count; }));
+    }
+    successors.push_back({});
+    it = successors.end() - 1;
+  }
+  it->metadata = next;
+  it->metadata.lyrics.clear();
+  ++it->count;
+  it->lastSeen = static_cast<int64_t>(std::time(nullptr));
+  dirty_ = true;
+  trim();
+}
+
+void TrackHistory::trim() {
+  if (successors_.size() <= historyCapacity) {
+    return;
+  }
+  auto lastSeen = [](const std::vector<Successor> &successors) {
+    int64_t latest = 0;
+    for (const auto &s : successors) {
+      latest = std::max(latest, s.lastSeen);
+    }
+    return latest;
+  };
+  auto oldest = successors_.begin();
+  for (auto it = successors_.begin(); it != successors_.end(); ++it) {
+    if (lastSeen(it->second) < lastSeen(oldest->second)) {
+      oldest = it;
+    }
+  }
+  successors_.erase(oldest);
+}
+
+std::vector<PlayerMetadata> TrackHistory::predict(const std::string &fromKey,
+                                                  size_t limit) const {
+  std::vector<PlayerMetadata> result;
+  auto it = successors_.find(fromKey);
+  if (it == successors_.end()) {
+    return result;
+  }
+  auto successors = it->second;
+  std::sort(successors.begin(), successors.end(),
+            [](const Successor &a, const Successor &b) {
+              return a.count != b.count ? a.count > b.count : a.lastSeen > b.lastSeen;
+            });
+  for (size_t i = 0; i < successors.size() && i < limit; ++i) {
+    result.push_back(successors[i].metadata);
+  }
+  return result;
+}
+
+LyricsPrefetcher::LyricsPrefetcher(FetchFn fetch, UpcomingFn upcoming,
+                                   BusyFn busy, std::filesystem::path historyFile,
+                                   PrefetchOptions options)
+    : fetch_(std::move(fetch)), upcoming_(std::move(upcoming)),
+      busy_(std::move(busy)), options_(options),
+      history_(std::move(historyFile)) {
+  history_.load();
+  size_t workers = std::max<size_t>(1, options_.concurrency);
+  for (size_t i = 0; i < workers; ++i) {
+    workers_.emplace_back([this]() { workerLoop(); });
+  }
+}
+
+LyricsPrefetcher::~LyricsPrefetcher() { stop(); }
+
+void LyricsPrefetcher::stop() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stopping_ = true;
+    queue_.clear();
+  }
+  cv_.notify_all();
+  for (auto &worker : workers_) {
+    if (worker.joinable()) {
+      worker.join();
+    }
+  }
+  std::unique_lock<std::mutex> lock(mutex_);
+  if (history_.dirty()) {
+    saveHistory(lock);
+  }
+}
+
+void LyricsPrefetcher::saveHistory(std::unique_lock<std::mutex> &lock) {
+  auto rows = history_.snapshot();
+  uint64_t seq = ++snapshotSeq_;
+  lock.unlock();
+  {
+    // 多个工作线程同时保存时，先取的快照后写会覆盖更新的内容，跳过
+    std::lock_guard<std::mutex> saveLock(saveMutex_);
+    if (seq > savedSeq_) {
+      history_.write(rows);
+      savedSeq_ = seq;
+    }
+  }
+  lock.lock();
+}
+
+void LyricsPrefetcher::onTrackChanged(const PlayerMetadata &metadata) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  std::string key = keyOf(metadata);
+  if (key == currentKey_) {
+    return;
+  }
+  if (!currentKey_.empty() && !metadata.title.empty()) {
+    history_.record(currentKey_, metadata);
+  }
+  currentKey_ = std::move(key);
+  ++generation_;
+  queue_.clear(); // 上一首歌的预测已经过期
+  queuedKeys_.assign(1, currentKey_);
+  hasTrackList_ = false;
+  upcomingPending_ = static_cast<bool>(upcoming_);
+  lookaheadAt_.reset();
+  cv_.notify_all();
+}
+
+void LyricsPrefetcher::onPlayback(uint64_t positionMs, int64_t lengthMs,
+                                  bool playing) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (!playing || lengthMs <= 0 || options_.lookaheadMs <= 0) {
+    lookaheadAt_.reset();
+    return;
+  }
+  int64_t remaining = lengthMs - static_cast<int64_t>(positionMs);
+  int64_t delay = std::max<int64_t>(0, remaining - options_.lookaheadMs);
+  lookaheadAt_ = Clock::now() + std::chrono::milliseconds(delay);
+  cv_.notify_all();
+}
+
+void LyricsPrefetcher::enqueueLocked(std::vector<PlayerMetadata> tracks) {
+  for (auto &track : tracks) {
+    if (track.title.empty()) {
+      continue;
+    }
+    std::string key = keyOf(track);
+    if (std::find(queuedKeys_.begin(), queuedKeys_.end(), key) != queuedKeys_.end()) {
+      continue;
+    }
+    if (queue_.size() >= queueCapacity) {
+      break;
+    }
+    queuedKeys_.push_back(std::move(key));
+    queue_.push_back(std::move(track));
+  }
+  cv_.notify_all();
+}
+
+void LyricsPrefetcher::workerLoop() {
+  // 低优先级线程：只使用空闲 CPU，避免与界面和前台查询争抢
+  setpriority(PRIO_PROCESS, static_cast<id_t>(syscall(SYS_gettid)), 10);
+  traceThreadName("prefetch");
+  std::unique_lock<std::mutex> lock(mutex_);
+  while (!stopping_) {
+    if (upcomingPending_) {
+      // 读取 TrackList（D-Bus 同步调用），在锁外执行
+      upcomingPending_ = false;
+      uint64_t generation = generation_;
+      lock.unlock();
+      std::vector<PlayerMetadata> tracks;
+      try {
+        tracks = upcoming_(options_.depth);
+      } catch (const std::exception &e) {
+        DEBUG("  >> Prefetch: failed to read track list: %s", e.what());
+      }
+      lock.lock();
+      if (generation == generation_ && !tracks.empty()) {
+        DEBUG("  >> Prefetch: %zu upcoming tracks from track list", tracks.size());
+        hasTrackList_ = true;
+        enqueueLocked(std::move(tracks));
+      }
+      continue;
+    }
+    if (lookaheadAt_ && Clock::now() >= *lookaheadAt_) {
+      lookaheadAt_.reset();
+      if (!hasTrackList_) {
+        auto tracks = history_.predict(currentKey_, options_.depth);
+        DEBUG("  >> Prefetch: %zu tracks predicted from history", tracks.size());
+        enqueueLocked(std::move(tracks));
+      }
+      continue;
+    }
+    if (history_.dirty()) {
+      saveHistory(lock);
+      continue;
+    }
+    if (!queue_.empty()) {
+      // 前台查询进行中时让路，等它完成后再继续预取
+      if (busy_ && busy_()) {
+        cv_.wait_for(lock, std::chrono::milliseconds(200));
+        continue;
+      }
+      PlayerMetadata track = std::move(queue_.front());
+      queue_.pop_front();
+      lock.unlock();
+      INFO("  >> Prefetching lyrics for: %s by %s", track.title.c_str(),
+           track.artist.c_str());
+      try {
+        fetch_(track);
+      } catch (const std::exception &e) {
+        DEBUG("  >> Prefetch failed for %s: %s", track.title.c_str(), e.what());
+      }
+      lock.lock();
+      continue;
+    }
+    if (lookaheadAt_) {
+      cv_.wait_until(lock, *lookaheadAt_);
+    } else {
+      cv_.wait(lock);
+    }
+  }
+}
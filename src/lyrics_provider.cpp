@@ -0,0 +1,281 @@
+#include "../include/lyrics_provider.h"
+#include "../include/http_client.h"
+#include "../include/lrclib.h"
+#include "../include/lyrics_library.h"
+#include "../include/lyrics_timeline.h"
+#include "../include/mapped_file.h"
+#include "../include/tag_reader.h"
+#include "../include/trace.h"
+#include "../include/utils.hpp"
+#include "common.h"
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <stdexcept>
+#include <thread>
+
+// 元数据转换为 lrclib 查询条件
+static LrclibQuery toQuery(const PlayerMetadata &metadata) {
+  return {metadata.title, metadata.artist, metadata.album,
+          static_cast<uint64_t>(std::max<int64_t>(metadata.length, 0))};
+}
+
+std::string SidecarLrcProvider::fetch(const PlayerMetadata &metadata) {
+  std::vector<std::filesystem::path> candidates;
+  std::filesystem::path media = fileUrlToPath(metadata.url);
+  if (!media.empty()) {
+    std::string fileName = media.stem().string() + ".lrc";
+    candidates.push_back(media.parent_path() / fileName);
+    for (const auto &dir : lyricsDirs_) {
+      candidates.push_back(dir / fileName);
+    }
+  }
+  if (!metadata.title.empty()) {
+    for (const auto &dir : lyricsDirs_) {
+      if (!metadata.artist.empty()) {
+        candidates.push_back(dir / (metadata.artist + " - " + metadata.title + ".lrc"));
+      }
+      candidates.push_back(dir / (metadata.title + ".lrc"));
+    }
+  }
+  for (const auto &candidate : candidates) {
+    MappedFile file(candidate.string());
+    if (!file.valid()) {
+      continue;
+    }
+    // 没有任何带时间戳歌词行的文件视为无效，继续查找
+    if (parseLrc(file.view())->empty()) {
+      DEBUG("  >> Local lyrics without time tags ignored: %s", candidate.c_str());
+      continue;
+    }
+    DEBUG("  >> Local lyrics found: %s", candidate.c_str());
+    return std::string(file.view());
+  }
+  return "";
+}
+
+std::string LibraryProvider::fetch(const PlayerMetadata &metadata) {
+  std::string path = library_->lookup(
+      metadata.title, metadata.artist,
+      static_cast<uint64_t>(std::max<int64_t>(metadata.length, 0)));
+  if (path.empty()) {
+    return "";
+  }
+  MappedFile file(path);
+  DEBUG("  >> Lyrics library hit: %s", path.c_str());
+  return file.valid() ? std::string(file.view()) : "";
+}
+
+std::string EmbeddedTagProvider::fetch(const PlayerMetadata &metadata) {
+  std::string path = fileUrlToPath(metadata.url);
+  return path.empty() ? "" : readEmbeddedLyricsFile(path).lrc;
+}
+
+std::string LrclibProvider::fetch(const PlayerMetadata &metadata) {
+  auto lookup = lookupLrclib(baseUrl_, toQuery(metadata));
+  if (lookup.unavailable()) {
+    throw std::runtime_error("lrclib unavailable");
+  }
+  return std::move(lookup.syncedLyrics);
+}
+
+std::string UrlTemplateProvider::fetch(const PlayerMetadata &metadata) {
+  if (metadata.title.empty()) {
+    return "";
+  }
+  int64_t length = std::max<int64_t>(metadata.length, 0);
+  std::string url = renderFormat(
+      urlTemplate_,
+      {{"title", url_encode(metadata.title)},
+       {"artist", url_encode(metadata.artist)},
+       {"album", url_encode(metadata.album)},
+       {"duration", std::to_string((length + 500) / 1000)},
+       {"duration_ms", std::to_string(length)}});
+  auto response = httpGet(url);
+  if (response.status == 404) {
+    return "";
+  }
+  if (!response.ok()) {
+    throw std::runtime_error(response.error.empty()
+                                 ? "HTTP error " + std::to_string(response.status)
+                                 : response.error);
+  }
+  std::string_view body = response.body;
+  size_t first = body.find_first_not_of(" \t\r\n");
+  if (first == std::string_view::npos) {
+    return "";
+  }
+  if (body[first] == '{' || body[first] == '[') {
+    return extractBestLyrics(body, toQuery(metadata)).syncedLyrics;
+  }
+  // 纯文本响应必须至少包含一行带时间戳的歌词
+  return parseLrc(body)->empty() ? "" : std::move(response.body);
+}
+
+LyricsProviderChain::LyricsProviderChain(
+    std::vector<std::shared_ptr<LyricsProvider>> providers, int deadlineMs,
+    bool adaptive)
+    : shared_(std::make_shared<Shared>()), deadlineMs_(std::max(0, deadlineMs)),
+      adaptive_(adaptive) {
+  for (auto &provider : providers) {
+    if (provider) {
+      ProviderStats stats;
+      stats.name = provider->name();
+      shared_->slots.push_back({std::move(provider), std::move(stats)});
+    }
+  }
+}
+
+bool LyricsProviderChain::empty() const { return shared_->slots.empty(); }
+
+std::vector<size_t> LyricsProviderChain::order(bool local) const {
+  std::vector<size_t> order;
+  for (size_t i = 0; i < shared_->slots.size(); ++i) {
+    if (shared_->slots[i].provider->local() == local) {
+      order.push_back(i);
+    }
+  }
+  if (adaptive_ && !local) {
+    std::lock_guard<std::mutex> lock(shared_->mutex);
+    const auto &slots = shared_->slots;
+    std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+      return slots[a].stats.cost() < slots[b].stats.cost();
+    });
+  }
+  return order;
+}
+
+std::vector<ProviderStats> LyricsProviderChain::stats() const {
+  auto indices = order(true);
+  auto remote = order(false);
+  indices.insert(indices.end(), remote.begin(), remote.end());
+  std::vector<ProviderStats> result;
+  std::lock_guard<std::mutex> lock(shared_->mutex);
+  for (size_t index : indices) {
+    result.push_back(shared_->slots[index].stats);
+  }
+  return result;
+}
+
+std::string LyricsProviderChain::runProvider(Shared &shared, size_t index,
+                                             const PlayerMetadata &metadata,
+                                             bool *failed) {
+  // slots 在构造后不再增删，provider 指针可以在锁外使用
+  auto &provider = *shared.slots[index].provider;
+  TraceSpan span("provider", provider.name());
+  auto begin = std::chrono::steady_clock::now();
+  std::string lyrics;
+  bool error = false;
+  try {
+    lyrics = provider.fetch(metadata);
+  } catch (const std::exception &e) {
+    WARN("  >> Lyrics provider [%s] error: %s", provider.name().c_str(), e.what());
+    error = true;
+  }
+  if (failed) {
+    *failed = error;
+  }
+  double elapsed = std::chrono::duration<double, std::milli>(
+                       std::chrono::steady_clock::now() - begin)
+                       .count();
+  std::lock_guard<std::mutex> lock(shared.mutex);
+  auto &stats = shared.slots[index].stats;
+  // 指数加权平均耗时，首个样本直接采用
+  stats.latencyMs = stats.calls == 0 ? elapsed : stats.latencyMs * 0.8 + elapsed * 0.2;
+  ++stats.calls;
+  stats.hits += lyrics.empty() ? 0 : 1;
+  stats.errors += error ? 1 : 0;
+  DEBUG("  >> Lyrics provider [%s]: hit=%d %.1f ms (calls=%lu hits=%lu avg=%.1f ms)",
+        stats.name.c_str(), !lyrics.empty(), elapsed, stats.calls, stats.hits,
+        stats.latencyMs);
+  return lyrics;
+}
+
+LyricsResult LyricsProviderChain::fetchSequential(const PlayerMetadata &metadata,
+                                                  const std::vector<size_t> &order) {
+  size_t errors = 0;
+  for (size_t index : order) {
+    bool error = false;
+    std::string lyrics = runProvider(*shared_, index, metadata, &error);
+    if (!lyrics.empty()) {
+      const auto &provider = *shared_->slots[index].provider;
+      return {std::move(lyrics), provider.name(), provider.cacheable()};
+    }
+    errors += error ? 1 : 0;
+  }
+  LyricsResult result;
+  result.failed = !order.empty() && errors == order.size();
+  return result;
+}
+
+LyricsResult LyricsProviderChain::fetchParallel(const PlayerMetadata &metadata,
+                                                const std::vector<size_t> &order) {
+  // 查询竞速状态：由所有查询线程共享，超时返回后仍保持有效
+  struct Race {
+    std::mutex mutex;
+    std::condition_variable cv;
+    LyricsResult winner;
+    size_t pending;
+    size_t errors = 0;
+  };
+  auto race = std::make_shared<Race>();
+  race->pending = order.size();
+  for (size_t index : order) {
+    std::thread([shared = shared_, race, index, metadata]() {
+      traceThreadName("provider");
+      bool error = false;
+      std::string lyrics = runProvider(*shared, index, metadata, &error);
+      const auto &provider = *shared->slots[index].provider;
+      std::lock_guard<std::mutex> lock(race->mutex);
+      race->errors += error ? 1 : 0;
+      if (race->winner.lyrics.empty() && !lyrics.empty()) {
+        race->winner = {std::move(lyrics), provider.name(), provider.cacheable()};
+      }
+      --race->pending;
+      race->cv.notify_all();
+    }).detach();
+  }
+  std::unique_lock<std::mutex> lock(race->mutex);
+  bool finished = race->cv.wait_for(
+      lock, std::chrono::milliseconds(deadlineMs_), [&race]() {
+        return !race->winner.lyrics.empty() || race->pending == 0;
+      });
+  if (!finished) {
+    WARN("  >> Lyrics providers: no result within %d ms (%zu pending)",
+         deadlineMs_, race->pending);
+    LyricsResult result;
+    result.failed = true; // 超时不代表没有歌词
+    return result;
+  }
+  if (race->winner.lyrics.empty()) {
+    race->winner.failed = race->errors == order.size();
+  }
+  return race->winner;
+}
+
+LyricsResult LyricsProviderChain::fetchLocal(const PlayerMetadata &metadata) {
+  auto result = fetchSequential(metadata, order(true));
+  if (!result.lyrics.empty()) {
+    INFO("  >> Lyrics found by local provider [%s]", result.provider.c_str());
+  }
+  return result;
+}
+
+LyricsResult LyricsProviderChain::fetchRemote(const PlayerMetadata &metadata) {
+  auto indices = order(false);
+  if (indices.empty()) {
+    return {};
+  }
+  auto result = deadlineMs_ > 0 && indices.size() > 1
+                    ? fetchParallel(metadata, indices)
+                    : fetchSequential(metadata, indices);
+  if (!result.lyrics.empty()) {
+    INFO("  >> Lyrics found by provider [%s]", result.provider.c_str());
+  }
+  return result;
+}
+
+LyricsResult LyricsProviderChain::fetch(const PlayerMetadata &metadata) {
+  auto result = fetchLocal(metadata);
+  return result.lyrics.empty() ? fetchRemote(metadata) : result;
+}
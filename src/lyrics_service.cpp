@@ -0,0 +1,205 @@
+#include "../include/lyrics_service.h"
+#include "../include/metrics.h"
+#include "../include/trace.h"
+#include "common.h"
+#include <thread>
+#include <vector>
+
+constexpr const char *serviceName = "org.waylyrics";
+constexpr const char *objectPath = "/org/waylyrics";
+constexpr const char *interfaceName = "org.waylyrics.Lyrics";
+constexpr int maxLookups = 4; // 同时进行的 Lookup 上限
+
+namespace {
+struct ServiceMetrics {
+  Counter &lookups = metrics().counter("service.lookups");
+  Counter &lookupsRejected = metrics().counter("service.lookups_rejected"); // 超过并发上限
+  Counter &lineChanges = metrics().counter("service.line_changes");
+  Counter &trackChanges = metrics().counter("service.track_changes");
+};
+
+ServiceMetrics &serviceMetrics() {
+  static ServiceMetrics instance;
+  return instance;
+}
+
+using TimelineEntry = sdbus::Struct<uint64_t, std::string, std::string, std::string>;
+} // namespace
+
+LyricsService::LyricsService(sdbus::IConnection &connection, LookupFn lookup)
+    : connection_(connection), lookup_(std::move(lookup)) {
+  connection_.requestName(sdbus::ServiceName{serviceName});
+  object_ = sdbus::createObject(connection_, sdbus::ObjectPath{objectPath});
+  // 完整时间轴可能有几十 KB，变更时只发送失效通知，需要的客户端再读取
+  object_
+      ->addVTable(
+          sdbus::registerProperty("TrackKey").withGetter([this]() {
+            std::lock_guard<std::mutex> lock(mutex_);
+            return trackKey_;
+          }),
+          sdbus::registerProperty("Title").withGetter([this]() {
+            std::lock_guard<std::mutex> lock(mutex_);
+            return title_;
+          }),
+          sdbus::registerProperty("Artist").withGetter([this]() {
+            std::lock_guard<std::mutex> lock(mutex_);
+            return artist_;
+          }),
+          sdbus::registerProperty("CurrentLine").withGetter([this]() {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (!timeline_ || lineIndex_ >= timeline_->lines.size()) {
+              return std::string();
+            }
+            return timeline_->lines[lineIndex_].text;
+          }),
+          sdbus::registerProperty("CurrentLineIndex").withGetter([this]() {
+            std::lock_guard<std::mutex> lock(mutex_);
+            return lineIndex_ == LyricsTimeline::npos ? int32_t{-1}
+                                                      : static_cast<int32_t>(lineIndex_);
+          }),
+          sdbus::registerProperty("NextLineTime").withGetter([this]() {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (!timeline_ || lineIndex_ == LyricsTimeline::npos ||
+                lineIndex_ + 1 >= timeline_->lines.size()) {
+              return int64_t{-1};
+            }
+            return static_cast<int64_t>(timeline_->lines[lineIndex_ + 1].timeMs);
+          }),
+          sdbus::registerProperty("Timeline")
+              .withGetter([this]() {
+                std::shared_ptr<const LyricsTimeline> timeline;
+                {
+                  std::lock_guard<std::mutex> lock(mutex_);
+                  timeline = timeline_;
+                }
+                std::vector<TimelineEntry> entries;
+                if (timeline) {
+                  entries.reserve(timeline->lines.size());
+                  for (const auto &line : timeline->lines) {
+                    entries.emplace_back(line.timeMs, line.text, line.translation,
+                                         line.romanization);
+                  }
+                }
+                return entries;
+              })
+              .withUpdateBehavior(sdbus::Flags::EMITS_INVALIDATION_SIGNAL),
+          sdbus::registerSignal("LineChanged")
+              .withParameters<int32_t, std::string, uint64_t, int64_t>("Index", "Text",
+                                                                       "TimeMs", "NextTimeMs"),
+          sdbus::registerMethod("Lookup")
+              .withInputParamNames("Title", "Artist", "DurationSec")
+              .withOutputParamNames("Lyrics")
+              .implementedAs([this](sdbus::Result<std::string> &&result, std::string title,
+                                    std::string artist, int32_t durationSec) {
+                handleLookup(std::move(result), std::move(title), std::move(artist),
+                             durationSec);
+              }))
+      .forInterface(sdbus::InterfaceName{interfaceName});
+  INFO("  >> Lyrics service exported: %s %s", serviceName, objectPath);
+}
+
+LyricsService::~LyricsService() {
+  object_.reset();
+  try {
+    connection_.releaseName(sdbus::ServiceName{serviceName});
+  } catch (const sdbus::Error &e) {
+    WARN("  >> Failed to release %s: %s", serviceName, e.getMessage().c_str());
+  }
+  std::unique_lock<std::mutex> lock(lookupMutex_);
+  lookupDone_.wait(lock, [this]() { return activeLookups_ == 0; });
+}
+
+void LyricsService::publish(const std::string &trackKey, const std::string &title,
+                            const std::string &artist,
+                            std::shared_ptr<const LyricsTimeline> timeline,
+                            uint64_t positionMs) {
+  size_t index = timeline ? timeline->indexAt(positionMs) : LyricsTimeline::npos;
+  bool trackChanged = false;
+  bool lineChanged = false;
+  std::string text;
+  uint64_t timeMs = 0;
+  int64_t nextTimeMs = -1;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    trackChanged = trackKey != trackKey_ || timeline != timeline_;
+    lineChanged = trackChanged || index != lineIndex_;
+    if (!lineChanged) {
+      return;
+    }
+    if (trackChanged) {
+      trackKey_ = trackKey;
+      title_ = title;
+      artist_ = artist;
+      timeline_ = timeline;
+    }
+    lineIndex_ = index;
+    if (index != LyricsTimeline::npos) {
+      text = timeline->lines[index].text;
+      timeMs = timeline->lines[index].timeMs;
+      if (index + 1 < timeline->lines.size()) {
+        nextTimeMs = static_cast<int64_t>(timeline->lines[index + 1].timeMs);
+      }
+    }
+  }
+  TraceSpan span("service.publish");
+  try {
+    if (trackChanged) {
+      serviceMetrics().trackChanges.add();
+      object_->emitPropertiesChangedSignal(
+          sdbus::InterfaceName{interfaceName},
+          {sdbus::PropertyName{"TrackKey"}, sdbus::PropertyName{"Title"},
+           sdbus::PropertyName{"Artist"}, sdbus::PropertyName{"Timeline"},
+           sdbus::PropertyName{"CurrentLine"}, sdbus::PropertyName{"CurrentLineIndex"},
+           sdbus::PropertyName{"NextLineTime"}});
+    } else {
+      object_->emitPropertiesChangedSignal(
+          sdbus::InterfaceName{interfaceName},
+          {sdbus::PropertyName{"CurrentLine"}, sdbus::PropertyName{"CurrentLineIndex"},
+           sdbus::PropertyName{"NextLineTime"}});
+    }
+    serviceMetrics().lineChanges.add();
+    object_->emitSignal("LineChanged")
+        .onInterface(interfaceName)
+        .withArguments(index == LyricsTimeline::npos ? int32_t{-1} : static_cast<int32_t>(index),
+                       text, timeMs, nextTimeMs);
+  } catch (const sdbus::Error &e) {
+    WARN("  >> Failed to emit lyrics service signal: %s", e.getMessage().c_str());
+  }
+}
+
+// 查询可能访问网络，不能阻塞 D-Bus 事件循环线程：在后台线程执行后异步回复
+void LyricsService::handleLookup(sdbus::Result<std::string> &&result, std::string title,
+                                 std::string artist, int32_t durationSec) {
+  {
+    std::lock_guard<std::mutex> lock(lookupMutex_);
+    if (activeLookups_ >= maxLookups) {
+      serviceMetrics().lookupsRejected.add();
+      result.returnError(sdbus::Error(sdbus::Error::Name{"org.waylyrics.Error.Busy"},
+                                      "Too many concurrent lookups"));
+      return;
+    }
+    ++activeLookups_;
+  }
+  serviceMetrics().lookups.add();
+  std::thread([this, result = std::move(result), title = std::move(title),
+               artist = std::move(artist), durationSec]() mutable {
+    traceThreadName("lookup");
+    DEBUG("  >> Lyrics service lookup: %s by %s", title.c_str(), artist.c_str());
+    try {
+      TraceSpan span("service.Lookup", title);
+      result.returnResults(
+          lookup_(title, artist, static_cast<int64_t>(std::max(0, durationSec)) * 1000));
+    } catch (const std::exception &e) {
+      WARN("  >> Lyrics service lookup failed: %s", e.what());
+      try {
+        result.returnError(
+            sdbus::Error(sdbus::Error::Name{"org.waylyrics.Error.Failed"}, e.what()));
+      } catch (const sdbus::Error &) {
+        // 调用方已断开，无法回复
+      }
+    }
+    std::lock_guard<std::mutex> lock(lookupMutex_);
+    --activeLookups_;
+    lookupDone_.notify_all();
+  }).detach();
+}
@@ -0,0 +1,108 @@
+#include "../include/lyrics_tooltip.h"
+#include "common.h"
+#include <algorithm>
+
+// 转义为 Pango markup 文本
+static std::string escapeMarkup(const std::string &text) {
+  gchar *escaped = g_markup_escape_text(text.c_str(), -1);
+  std::string result(escaped);
+  g_free(escaped);
+  return result;
+}
+
+LyricsTooltip::LyricsTooltip(GtkWidget *widget,
+                             std::function<TooltipSnapshot()> snapshot,
+                             int contextLines, const std::string &footer)
+    : widget_(widget), snapshot_(std::move(snapshot)),
+      contextLines_(std::max(0, contextLines)),
+      footer_(escapeMarkup(footer)) {
+  if (!widget_) {
+    return;
+  }
+  g_object_add_weak_pointer(G_OBJECT(widget_),
+                            reinterpret_cast<gpointer *>(&widget_));
+  gtk_widget_set_has_tooltip(widget_, TRUE);
+  handler_ = g_signal_connect(widget_, "query-tooltip",
+                              G_CALLBACK(onQueryTooltip), this);
+}
+
+LyricsTooltip::~LyricsTooltip() {
+  if (widget_) {
+    g_signal_handler_disconnect(widget_, handler_);
+    g_object_remove_weak_pointer(G_OBJECT(widget_),
+                                 reinterpret_cast<gpointer *>(&widget_));
+  }
+}
+
+gboolean LyricsTooltip::onQueryTooltip(GtkWidget *, gint, gint, gboolean,
+                                       GtkTooltip *tooltip, gpointer data) {
+  auto *self = static_cast<LyricsTooltip *>(data);
+  std::string markup = self->buildMarkup(self->snapshot_());
+  if (markup.empty()) {
+    return FALSE;
+  }
+  gtk_tooltip_set_markup(tooltip, markup.c_str());
+  return TRUE;
+}
+
+const std::string &LyricsTooltip::lineMarkup(size_t index) {
+  auto it = lineCache_.find(index);
+  if (it != lineCache_.end()) {
+    return it->second;
+  }
+  const auto &line = timeline_->lines[index];
+  std::string markup = escapeMarkup(line.text);
+  if (!line.translation.empty()) {
+    markup += "\n<small>" + escapeMarkup(line.translation) + "</small>";
+  }
+  return lineCache_.emplace(index, std::move(markup)).first->second;
+}
+
+std::string LyricsTooltip::buildMarkup(const TooltipSnapshot &snapshot) {
+  if (snapshot.timeline != timeline_) {
+    timeline_ = snapshot.timeline; // 换歌后清空行缓存
+    lineCache_.clear();
+    lastIndex_ = LyricsTimeline::npos;
+  }
+  std::string track = snapshot.title;
+  if (!snapshot.artist.empty()) {
+    track += " - " + snapshot.artist;
+  }
+  size_t index = timeline_ ? timeline_->indexAt(snapshot.position)
+                           : LyricsTimeline::npos;
+  // 当前行和歌曲信息都未变化时直接复用上次结果
+  if (!lastMarkup_.empty() && index == lastIndex_ && track == lastTrack_) {
+    return lastMarkup_;
+  }
+  lastIndex_ = index;
+  lastTrack_ = track;
+
+  std::string markup;
+  if (!track.empty()) {
+    markup += "<b>" + escapeMarkup(track) + "</b>";
+  }
+  if (index != LyricsTimeline::npos) {
+    size_t first = index > static_cast<size_t>(contextLines_)
+                       ? index - contextLines_
+                       : 0;
+    size_t last = std::min(timeline_->lines.size() - 1, index + contextLines_);
+    for (size_t i = first; i <= last; ++i) {
+      if (!markup.empty()) {
+        markup += "\n";
+      }
+      if (i == index) {
+        markup += "<span weight=\"bold\" size=\"large\">" + lineMarkup(i) + "</span>";
+      } else {
+        markup += "<span alpha=\"60%\">" + lineMarkup(i) + "</span>";
+      }
+    }
+  }
+  if (!footer_.empty()) {
+    if (!markup.empty()) {
+      markup += "\n\n";
+    }
+    markup += "<small>" + footer_ + "</small>";
+  }
+  lastMarkup_ = markup;
+  return markup;
+}
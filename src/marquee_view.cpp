@@ -0,0 +1,144 @@
+#include "../include/marquee_view.h"
+#include "common.h"
+#include <algorithm>
+
+// 行首、行尾各停留一段时间再滚动，便于阅读
+constexpr double marqueeDwell = 0.15;
+
+MarqueeView::MarqueeView(GtkWidget *area,
+                         std::shared_ptr<const PlaybackClock> clock,
+                         int maxColumns, int fps)
+    : area_(area), clock_(std::move(clock)),
+      frameIntervalUs_(1000000 / std::clamp(fps, 1, 60)) {
+  if (!area_) {
+    return;
+  }
+  g_object_add_weak_pointer(G_OBJECT(area_), reinterpret_cast<gpointer *>(&area_));
+  // 以 "0" 的宽度作为一列，计算可见宽度
+  PangoLayout *probe = gtk_widget_create_pango_layout(area_, "0");
+  int columnWidth = 0;
+  pango_layout_get_pixel_size(probe, &columnWidth, &textHeight_);
+  g_object_unref(probe);
+  visibleWidth_ = std::max(1, columnWidth * maxColumns);
+  gtk_widget_set_size_request(area_, visibleWidth_, textHeight_);
+
+  drawHandler_ = g_signal_connect(area_, "draw", G_CALLBACK(onDraw), this);
+  mapHandler_ = g_signal_connect(area_, "map", G_CALLBACK(onMap), this);
+  unmapHandler_ = g_signal_connect(area_, "unmap", G_CALLBACK(onUnmap), this);
+}
+
+MarqueeView::~MarqueeView() {
+  stopTicking();
+  if (area_) {
+    g_signal_handler_disconnect(area_, drawHandler_);
+    g_signal_handler_disconnect(area_, mapHandler_);
+    g_signal_handler_disconnect(area_, unmapHandler_);
+    g_object_remove_weak_pointer(G_OBJECT(area_),
+                                 reinterpret_cast<gpointer *>(&area_));
+  }
+  if (layout_) {
+    g_object_unref(layout_);
+  }
+}
+
+void MarqueeView::setText(const std::string &text, uint64_t startMs,
+                          uint64_t endMs) {
+  if (!area_) {
+    return;
+  }
+  startMs_ = startMs;
+  endMs_ = endMs;
+  if (!layout_ || text != text_) {
+    // 只在文本变化时重新排版，滚动期间复用同一个 PangoLayout
+    text_ = text;
+    if (!layout_) {
+      layout_ = gtk_widget_create_pango_layout(area_, nullptr);
+    }
+    pango_layout_set_text(layout_, text_.c_str(), -1);
+    pango_layout_get_pixel_size(layout_, &textWidth_, &textHeight_);
+    gtk_widget_set_size_request(area_, std::min(textWidth_, visibleWidth_),
+                                textHeight_);
+    offset_ = offsetAt(clock_->positionMs());
+    gtk_widget_queue_draw(area_);
+  }
+  updateTicking();
+}
+
+int MarqueeView::offsetAt(uint64_t positionMs) const {
+  int overflow = textWidth_ - visibleWidth_;
+  if (overflow <= 0 || endMs_ <= startMs_ || positionMs <= startMs_) {
+    return 0;
+  }
+  double progress = static_cast<double>(positionMs - startMs_) /
+                    static_cast<double>(endMs_ - startMs_);
+  progress = std::clamp((progress - marqueeDwell) / (1.0 - 2 * marqueeDwell),
+                        0.0, 1.0);
+  return static_cast<int>(progress * overflow);
+}
+
+gboolean MarqueeView::onDraw(GtkWidget *widget, cairo_t *cr, gpointer data) {
+  auto *self = static_cast<MarqueeView *>(data);
+  if (!self->layout_) {
+    return FALSE;
+  }
+  int width = gtk_widget_get_allocated_width(widget);
+  int height = gtk_widget_get_allocated_height(widget);
+  cairo_save(cr);
+  cairo_rectangle(cr, 0, 0, width, height);
+  cairo_clip(cr);
+  gtk_render_layout(gtk_widget_get_style_context(widget), cr, -self->offset_,
+                    (height - self->textHeight_) / 2.0, self->layout_);
+  cairo_restore(cr);
+  return FALSE;
+}
+
+gboolean MarqueeView::onTick(GtkWidget *widget, GdkFrameClock *frameClock,
+                             gpointer data) {
+  auto *self = static_cast<MarqueeView *>(data);
+  gint64 now = gdk_frame_clock_get_frame_time(frameClock);
+  if (now - self->lastFrameUs_ < self->frameIntervalUs_) {
+    return G_SOURCE_CONTINUE; // 限制帧率
+  }
+  self->lastFrameUs_ = now;
+  uint64_t position = self->clock_->positionMs();
+  int offset = self->offsetAt(position);
+  if (offset != self->offset_) {
+    self->offset_ = offset; // 只有偏移变化时才重绘
+    gtk_widget_queue_draw(widget);
+  }
+  // 暂停或滚动到行尾后停止回调，下次 setText 时按需重新启动
+  if (!self->clock_->isPlaying() || position >= self->endMs_) {
+    self->tickId_ = 0;
+    return G_SOURCE_REMOVE;
+  }
+  return G_SOURCE_CONTINUE;
+}
+
+void MarqueeView::onMap(GtkWidget *, gpointer data) {
+  static_cast<MarqueeView *>(data)->updateTicking();
+}
+
+void MarqueeView::onUnmap(GtkWidget *, gpointer data) {
+  static_cast<MarqueeView *>(data)->stopTicking(); // 状态栏隐藏时完全停止
+}
+
+void MarqueeView::updateTicking() {
+  bool needTick = area_ && textWidth_ > visibleWidth_ && endMs_ > startMs_ &&
+                  clock_->isPlaying() && gtk_widget_get_mapped(area_) &&
+                  clock_->positionMs() < endMs_;
+  if (!needTick) {
+    stopTicking();
+    return;
+  }
+  if (!tickId_) {
+    lastFrameUs_ = 0;
+    tickId_ = gtk_widget_add_tick_callback(area_, onTick, this, nullptr);
+  }
+}
+
+void MarqueeView::stopTicking() {
+  if (tickId_ && area_) {
+    gtk_widget_remove_tick_callback(area_, tickId_);
+  }
+  tickId_ = 0;
+}
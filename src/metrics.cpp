@@ -0,0 +1,112 @@
+#include "../include/metrics.h"
+#include <algorithm>
+#include <cstdio>
+#include <nlohmann/json.hpp>
+
+double Histogram::Snapshot::percentile(double q) const {
+  if (count == 0) {
+    return 0;
+  }
+  double rank = std::clamp(q, 0.0, 1.0) * static_cast<double>(count);
+  uint64_t seen = 0;
+  for (size_t i = 0; i < buckets.size(); ++i) {
+    if (buckets[i] == 0 || static_cast<double>(seen + buckets[i]) < rank) {
+      seen += buckets[i];
+      continue;
+    }
+    if (i == bounds.size()) {
+      return bounds.back(); // 超出最大上界，无法插值
+    }
+    double lower = i == 0 ? 0 : bounds[i - 1];
+    double fraction = (rank - static_cast<double>(seen)) / static_cast<double>(buckets[i]);
+    return lower + (bounds[i] - lower) * std::clamp(fraction, 0.0, 1.0);
+  }
+  return bounds.back();
+}
+
+void Histogram::observe(double ms) {
+  size_t index = static_cast<size_t>(
+      std::lower_bound(bounds.begin(), bounds.end(), ms) - bounds.begin());
+  buckets_[index].fetch_add(1, std::memory_order_relaxed);
+  sumUs_.fetch_add(static_cast<uint64_t>(std::max(0.0, ms) * 1000),
+                   std::memory_order_relaxed);
+}
+
+Histogram::Snapshot Histogram::snapshot() const {
+  Snapshot snapshot;
+  for (size_t i = 0; i < buckets_.size(); ++i) {
+    snapshot.buckets[i] = buckets_[i].load(std::memory_order_relaxed);
+    snapshot.count += snapshot.buckets[i]; // 以分桶之和为准，保证分位数自洽
+  }
+  snapshot.sumMs = static_cast<double>(sumUs_.load(std::memory_order_relaxed)) / 1000;
+  return snapshot;
+}
+
+Counter &MetricsRegistry::counter(const std::string &name) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto &slot = counters_[name];
+  if (!slot) {
+    slot = std::make_unique<Counter>();
+  }
+  return *slot;
+}
+
+Histogram &MetricsRegistry::histogram(const std::string &name) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto &slot = histograms_[name];
+  if (!slot) {
+    slot = std::make_unique<Histogram>();
+  }
+  return *slot;
+}
+
+nlohmann::json MetricsRegistry::snapshot() const {
+  nlohmann::json result;
+  std::lock_guard<std::mutex> lock(mutex_);
+  result["uptime_s"] = std::chrono::duration<double>(
+                           std::chrono::steady_clock::now() - started_)
+                           .count();
+  auto &counters = result["counters"] = nlohmann::json::object();
+  for (const auto &[name, counter] : counters_) {
+    counters[name] = counter->value();
+  }
+  auto &histograms = result["histograms"] = nlohmann::json::object();
+  for (const auto &[name, histogram] : histograms_) {
+    auto snapshot = histogram->snapshot();
+    nlohmann::json entry = {{"count", snapshot.count},
+                            {"sum_ms", snapshot.sumMs},
+                            {"p50", snapshot.percentile(0.5)},
+                            {"p90", snapshot.percentile(0.9)},
+                            {"p99", snapshot.percentile(0.99)}};
+    // buckets[i] 为落在 (bounds_ms[i-1], bounds_ms[i]] 内的样本数，最后一个桶为超过最大上界的样本数
+    entry["bounds_ms"] = Histogram::bounds;
+    entry["buckets"] = snapshot.buckets;
+    histograms[name] = std::move(entry);
+  }
+  return result;
+}
+
+std::vector<std::string> MetricsRegistry::summary() const {
+  std::vector<std::string> lines;
+  char buffer[160];
+  std::lock_guard<std::mutex> lock(mutex_);
+  for (const auto &[name, counter] : counters_) {
+    snprintf(buffer, sizeof(buffer), "%s = %lu", name.c_str(),
+             static_cast<unsigned long>(counter->value()));
+    lines.emplace_back(buffer);
+  }
+  for (const auto &[name, histogram] : histograms_) {
+    auto snapshot = histogram->snapshot();
+    snprintf(buffer, sizeof(buffer), "%s: n=%lu p50=%.1fms p90=%.1fms p99=%.1fms",
+             name.c_str(), static_cast<unsigned long>(snapshot.count),
+             snapshot.percentile(0.5), snapshot.percentile(0.9),
+             snapshot.percentile(0.99));
+    lines.emplace_back(buffer);
+  }
+  return lines;
+}
+
+MetricsRegistry &metrics() {
+  static MetricsRegistry *registry = new MetricsRegistry; // 不析构：分离线程可能在退出时仍在计数
+  return *registry;
+}
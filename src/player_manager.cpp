@@ -1,5 +1,9 @@
 #include "../include/player_manager.h"
+#include "../include/dbus_recorder.h"
+#include "../include/metrics.h"
+#include "../include/trace.h"
 #include "common.h"
+#include <algorithm>
 #include <cstddef>
 #include <mutex>
 #include <sdbus-c++/Types.h>
@@ -7,11 +11,28 @@
 #include <string>
 #include <utility>
 
+namespace {
+// D-Bus 信号和状态刷新的指标（首次使用时注册）
+struct DbusMetrics {
+  Counter &signals = metrics().counter("dbus.signals");     // 收到的 PropertiesChanged 信号
+  Counter &refreshes = metrics().counter("dbus.refreshes"); // 读取播放器状态的次数
+  Counter &errors = metrics().counter("dbus.errors");       // 读取状态时的 D-Bus 错误
+  Histogram &refreshMs = metrics().histogram("dbus.refresh_ms");
+};
+
+DbusMetrics &dbusMetrics() {
+  static DbusMetrics instance;
+  return instance;
+}
+} // namespace
+
 
 PlayerManager::PlayerManager(
     std::shared_ptr<sdbus::IConnection> dbusConn,
-    std::function<void(const PlayerState &)> stateCallback)
-    : dbusConn_(std::move(dbusConn)), stateCallback_(std::move(stateCallback)) {
+    std::function<void(const PlayerState &)> stateCallback,
+    std::shared_ptr<DbusRecorder> recorder)
+    : dbusConn_(std::move(dbusConn)), stateCallback_(std::move(stateCallback)),
+      recorder_(std::move(recorder)) {
   if (!dbusConn_) {
     ERROR("Failed to initialize D-Bus connection");
     return;
@@ -27,10 +48,45 @@ PlayerManager::PlayerManager(
   startMonitoring(); // 初始化时自动启动监听
 }
 
+PlayerManager::PlayerManager(
+    std::function<void(const PlayerState &)> stateCallback,
+    std::shared_ptr<EventClock> clock,
+    std::function<PlayerState(const std::string &)> stateSource)
+    : stateCallback_(std::move(stateCallback)), clock_(std::move(clock)),
+      stateSource_(std::move(stateSource)) {
+  INFO("PlayerManager created for replay");
+}
+
 PlayerManager::~PlayerManager() {
   stopMonitoring(); // 析构时停止监听
 }
 
+void PlayerManager::record(DbusEvent event) const {
+  if (recorder_) {
+    event.timeUs = clock_->nowUs();
+    recorder_->record(event);
+  }
+}
+
+void PlayerManager::replay(const DbusEvent &event) {
+  switch (event.kind) {
+  case DbusEvent::Kind::Players:
+    initPlayers(event.players);
+    break;
+  case DbusEvent::Kind::Owner:
+    handleNameOwnerChanged(event.player, event.oldOwner, event.newOwner);
+    break;
+  case DbusEvent::Kind::Signal:
+    handlePlayerSignal(event.player, event.interfaceName, event.signal);
+    break;
+  case DbusEvent::Kind::Select:
+    setCurrentPlayer(event.player);
+    break;
+  case DbusEvent::Kind::State:
+    break; // 由 stateSource_ 在读取状态时消费
+  }
+}
+
 // 切换到下一个播放器，如果没有播放器可用，则返回空字符串
 std::string PlayerManager::switchNewPlayer() const {
   auto allPlayer = getAllPlayers();
@@ -79,13 +135,17 @@ std::vector<std::string> PlayerManager::listPlayerNames() {
 }
 
 PlayerState PlayerManager::getPlayerState() const {
+  TraceSpan span("getPlayerState", currentPlayer_);
 
   PlayerState state = {PlaybackStatus::Stopped, {}, 0, currentPlayer_};
   if(currentPlayer_.empty()) {
     return state;
   }
   // 等待300毫秒以确保播放器已经准备好
-  std::this_thread::sleep_for(std::chrono::milliseconds(300));
+  clock_->sleepFor(std::chrono::milliseconds(300));
+  if (stateSource_) {
+    return stateSource_(currentPlayer_);
+  }
 
   sdbus::ServiceName destination{std::move(currentPlayer_)};
   sdbus::ObjectPath objectPath{"/org/mpris/MediaPlayer2"};
@@ -110,6 +170,7 @@ PlayerState PlayerManager::getPlayerState() const {
       state.status = status == "Playing" ? PlaybackStatus::Playing : PlaybackStatus::Paused;
     }
   } catch (const sdbus::Error &e) { // 捕获D-Bus特定错误
+    dbusMetrics().errors.add();
     WARN("D-Bus error: %s", e.getMessage().c_str());
     state.status = PlaybackStatus::Unknown;
     return state;
@@ -131,6 +192,16 @@ PlayerState PlayerManager::getPlayerState() const {
       WARN("xesam:title not found in metadata");
     }
 
+    // 解析专辑（用于 lrclib 精确匹配）
+    if (md.count("xesam:album")) {
+      state.metadata.album = md["xesam:album"].get<std::string>();
+    }
+
+    // 解析媒体地址（用于查找本地歌词文件）
+    if (md.count("xesam:url")) {
+      state.metadata.url = md["xesam:url"].get<std::string>();
+    }
+
     // 歌词解析
     if (md.count("xesam:asText")) {
       state.metadata.lyrics = md["xesam:asText"].get<std::string>();
@@ -158,6 +229,7 @@ PlayerState PlayerManager::getPlayerState() const {
       WARN("mpris:length not found in metadata");
     }
   } catch (const sdbus::Error &e) { // 捕获D-Bus特定错误
+    dbusMetrics().errors.add();
     WARN("D-Bus error: %s", e.getMessage().c_str());
     return state;
   } catch (const std::exception &e) { // 捕获其他标准异常
@@ -174,6 +246,7 @@ PlayerState PlayerManager::getPlayerState() const {
         .storeResultsTo(posVar);
     state.position = posVar.get<int64_t>() / 1000;
   } catch (const sdbus::Error &e) { // 捕获D-Bus特定错误
+    dbusMetrics().errors.add();
     WARN("D-Bus error: %s", e.getMessage().c_str());
     return state;
   } catch (const std::exception &e) { // 捕获其他标准异常
@@ -190,11 +263,7 @@ void PlayerManager::startMonitoring() {
     return;
 
   // 初始化当前活跃的播放器列表
-  for (const auto &name : listPlayerNames()) {
-    INFO("Found player: %s", name.c_str());
-    addNewPlayer(name); // 新播放器启动
-  }
-  updatePlayerState(); // 更新当前播放器状态
+  initPlayers(listPlayerNames());
   DEBUG("Current player: [%s]", currentPlayer_.c_str());
   INFO("Starting D-Bus signal monitoring");
   // 注册NameOwnerChanged信号监听器
@@ -202,30 +271,95 @@ void PlayerManager::startMonitoring() {
       .onInterface("org.freedesktop.DBus")
       .call([this](const std::string &name, const std::string &oldOwner,
                    const std::string &newOwner) {
-        if (name.find("org.mpris.MediaPlayer2.") != 0)
-          return;
-        std::lock_guard<std::mutex> lock(mutex_);
-        if (newOwner.empty()) {
-          // 播放器退出：从管理列表移除
-          players_.erase(name);
-          if (name == currentPlayer_) {
-            currentPlayer_ = switchNewPlayer();
-            updatePlayerState();
-          }
-          INFO("Player exited: %s", name.c_str());
-        } else if (oldOwner.empty()) {
-          INFO("New player detected: %s", name.c_str());
-          addNewPlayer(name);
-        }
+        handleNameOwnerChanged(name, oldOwner, newOwner);
       });
   // 启动事件循环
   INFO("Starting D-Bus event loop");
-  eventLoopThread_ = std::thread([this]() { dbusConn_->enterEventLoop(); });
+  eventLoopThread_ = std::thread([this]() {
+    traceThreadName("dbus");
+    dbusConn_->enterEventLoop();
+  });
+}
+
+void PlayerManager::initPlayers(const std::vector<std::string> &names) {
+  DbusEvent event;
+  event.kind = DbusEvent::Kind::Players;
+  event.players = names;
+  record(std::move(event));
+  for (const auto &name : names) {
+    INFO("Found player: %s", name.c_str());
+    addNewPlayer(name); // 新播放器启动
+  }
+  updatePlayerState(); // 更新当前播放器状态
+}
+
+void PlayerManager::handleNameOwnerChanged(const std::string &name,
+                                           const std::string &oldOwner,
+                                           const std::string &newOwner) {
+  if (name.find("org.mpris.MediaPlayer2.") != 0)
+    return;
+  DbusEvent event;
+  event.kind = DbusEvent::Kind::Owner;
+  event.player = name;
+  event.oldOwner = oldOwner;
+  event.newOwner = newOwner;
+  record(std::move(event));
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (newOwner.empty()) {
+    // 播放器退出：从管理列表移除
+    players_.erase(name);
+    if (name == currentPlayer_) {
+      currentPlayer_ = switchNewPlayer();
+      updatePlayerState();
+    }
+    INFO("Player exited: %s", name.c_str());
+  } else if (oldOwner.empty()) {
+    INFO("New player detected: %s", name.c_str());
+    addNewPlayer(name);
+  }
+}
+
+void PlayerManager::handlePlayerSignal(const std::string &serviceName,
+                                       const std::string &interfaceName,
+                                       const PlayerSignal &signal) {
+  DEBUG("PropertiesChanged: %s , interfaceName: [%s] , currentPlayer: %s",
+        serviceName.c_str(), interfaceName.c_str(), currentPlayer_.c_str());
+  dbusMetrics().signals.add();
+  TraceSpan span("dbus.PropertiesChanged", serviceName);
+  DbusEvent event;
+  event.kind = DbusEvent::Kind::Signal;
+  event.player = serviceName;
+  event.interfaceName = interfaceName;
+  event.signal = signal;
+  record(std::move(event));
+  if (interfaceName != "org.mpris.MediaPlayer2.Player") {
+    WARN("Ignoring non-player interface: %s", interfaceName.c_str());
+    return;
+  }
+  bool needCallback = false;
+  if (signal.hasMetadata) {
+    needCallback = true;
+    DEBUG("Metadata changed: title=[%s], artist=[%s], lyrics=[%s]",
+          signal.metadata.title.c_str(), signal.metadata.artist.c_str(),
+          signal.metadata.lyrics.c_str());
+  }
+  if (std::find(signal.changed.begin(), signal.changed.end(), "PlaybackStatus") !=
+      signal.changed.end()) {
+    needCallback = true;
+    INFO("PlaybackStatus changed: %s", signal.playbackStatus.c_str());
+  }
+  // 触发上层回调（线程安全：D-Bus事件循环可能在独立线程，需确保回调线程安全）
+  if (stateCallback_ && needCallback) {
+    updatePlayerState();
+  }
 }
 
 void PlayerManager::stopMonitoring() {
   // 遍历所有播放器代理，移除信号监听器
   for (auto &[serviceName, playerProxy] : players_) {
+    if (!playerProxy) {
+      continue; // 回放时没有代理
+    }
     try{
       playerProxy->unregister();
       INFO("Unregistered player proxy for %s", serviceName.c_str());
@@ -236,7 +370,17 @@ void PlayerManager::stopMonitoring() {
     }
   }
   players_.clear();
-  dbusConn_->leaveEventLoop();
+  if (dbusConn_) {
+    dbusConn_->leaveEventLoop();
+  }
+  // 等待事件循环线程退出（可结合的 std::thread 析构会直接终止进程）
+  if (eventLoopThread_.joinable()) {
+    if (eventLoopThread_.get_id() == std::this_thread::get_id()) {
+      eventLoopThread_.detach();
+    } else {
+      eventLoopThread_.join();
+    }
+  }
 }
 // Metadata 解析函数（实现）
 void PlayerManager::parseMetadata(
@@ -264,6 +408,31 @@ void PlayerManager::parseMetadata(
     DEBUG("Metadata missing xesam:artist/albumArtist");
   }
 
+  // 解析专辑
+  if (metadata.count("xesam:album")) {
+    out.album = metadata.at("xesam:album").get<std::string>();
+  }
+
+  // 解析媒体地址
+  if (metadata.count("xesam:url")) {
+    out.url = metadata.at("xesam:url").get<std::string>();
+  }
+
+  // 解析歌曲ID（规范类型为对象路径，部分播放器使用字符串）
+  if (metadata.count("mpris:trackid")) {
+    const auto &trackId = metadata.at("mpris:trackid");
+    if (trackId.containsValueOfType<sdbus::ObjectPath>()) {
+      out.trackId = trackId.get<sdbus::ObjectPath>();
+    } else if (trackId.containsValueOfType<std::string>()) {
+      out.trackId = trackId.get<std::string>();
+    }
+  }
+
+  // 解析媒体长度（微秒）
+  if (metadata.count("mpris:length")) {
+    out.length = metadata.at("mpris:length").get<int64_t>() / 1000;
+  }
+
   // 解析歌词（musicfox 专有字段）
   if (metadata.count("xesam:asText")) {
     out.lyrics = metadata.at("xesam:asText").get<std::string>();
@@ -286,6 +455,10 @@ void PlayerManager::addNewPlayer(const std::string &serviceName) {
     currentPlayer_ = serviceName;
     INFO("Using first player: %s", serviceName.c_str());
   }
+  if (!dbusConn_) {
+    players_[serviceName] = nullptr; // 回放：只记录播放器名称
+    return;
+  }
   try {
     // 创建播放器实例代理
     sdbus::ServiceName destination{std::move(serviceName)};
@@ -299,30 +472,22 @@ void PlayerManager::addNewPlayer(const std::string &serviceName) {
                serviceName](const std::string &interfaceName,
                             std::map<std::string, sdbus::Variant> &changedProps,
                             std::vector<std::string> &invalidatedProps) {
-          DEBUG("PropertiesChanged: %s , interfaceName: [%s] , currentPlayer: %s",
-                serviceName.c_str(), interfaceName.c_str(), currentPlayer_.c_str());
-          if (interfaceName != "org.mpris.MediaPlayer2.Player") {
-            WARN("Ignoring non-player interface: %s", interfaceName.c_str());
-            return;
-          }
-          bool needCallback = false;
-          if(changedProps.count("Metadata")) {
-            needCallback = true;
-            auto metadata = changedProps["Metadata"].get<std::map<std::string, sdbus::Variant>>();
-            PlayerMetadata md;
-            parseMetadata(metadata, md);
-            DEBUG("Metadata changed: title=[%s], artist=[%s], lyrics=[%s]",
-                  md.title.c_str(), md.artist.c_str(), md.lyrics.c_str());
-          }
-          if(changedProps.count("PlaybackStatus")) {
-            auto status = changedProps["PlaybackStatus"].get<std::string>();
-            needCallback = true;
-            INFO("PlaybackStatus changed: %s", status.c_str());
+          PlayerSignal signal;
+          for (const auto &[name, _] : changedProps) {
+            signal.changed.push_back(name);
           }
-          // 触发上层回调（线程安全：D-Bus事件循环可能在独立线程，需确保回调线程安全）
-          if (stateCallback_ && needCallback) {
-            updatePlayerState();
+          if (interfaceName == "org.mpris.MediaPlayer2.Player") {
+            if (changedProps.count("Metadata")) {
+              signal.hasMetadata = true;
+              parseMetadata(
+                  changedProps["Metadata"].get<std::map<std::string, sdbus::Variant>>(),
+                  signal.metadata);
+            }
+            if (changedProps.count("PlaybackStatus")) {
+              signal.playbackStatus = changedProps["PlaybackStatus"].get<std::string>();
+            }
           }
+          handlePlayerSignal(serviceName, interfaceName, signal);
         });
 
     // 完成信号注册并存储代理
@@ -348,6 +513,10 @@ std::vector<std::string> PlayerManager::getAllPlayers() const {
 
 // 实现切换当前播放器的方法（切换显示信息)
 void PlayerManager::setCurrentPlayer(const std::string &playerName) {
+  DbusEvent event;
+  event.kind = DbusEvent::Kind::Select;
+  event.player = playerName;
+  record(std::move(event));
   currentPlayer_ = playerName;
   updatePlayerState();
 }
@@ -355,7 +524,19 @@ void PlayerManager::setCurrentPlayer(const std::string &playerName) {
 // 更新播放器状态信息（调用回调）
 void PlayerManager::updatePlayerState() {
   DEBUG("updatePlayerState: %s", currentPlayer_.c_str());
-  auto state = getPlayerState();
+  TraceSpan span("updatePlayerState");
+  auto state = [this]() {
+    ScopedTimer timer(dbusMetrics().refreshMs);
+    return getPlayerState();
+  }();
+  dbusMetrics().refreshes.add();
+  if (!currentPlayer_.empty()) {
+    DbusEvent event;
+    event.kind = DbusEvent::Kind::State;
+    event.player = currentPlayer_;
+    event.state = state;
+    record(std::move(event));
+  }
   if (stateCallback_) {
     stateCallback_(state);
   }
@@ -503,4 +684,74 @@ void PlayerManager::setShuffle(bool enable) {
 }
 bool PlayerManager::isShuffle() const {
   return isShuffle_;
-}
\ No newline at end of file
+}
+
+std::vector<PlayerMetadata> PlayerManager::getUpcomingTracks(size_t limit) const {
+  TraceSpan span("getUpcomingTracks");
+  std::vector<PlayerMetadata> tracks;
+  std::string player = currentPlayer_;
+  if (player.empty() || limit == 0 || !dbusConn_) {
+    return tracks;
+  }
+  try {
+    sdbus::ServiceName destination{std::move(player)};
+    sdbus::ObjectPath objectPath{"/org/mpris/MediaPlayer2"};
+    auto playerProxy = sdbus::createProxy(*dbusConn_, std::move(destination),
+                                          std::move(objectPath));
+    sdbus::Variant hasTrackList;
+    playerProxy->callMethod("Get")
+        .onInterface("org.freedesktop.DBus.Properties")
+        .withArguments("org.mpris.MediaPlayer2", "HasTrackList")
+        .storeResultsTo(hasTrackList);
+    if (!hasTrackList.get<bool>()) {
+      return tracks;
+    }
+    sdbus::Variant trackList;
+    playerProxy->callMethod("Get")
+        .onInterface("org.freedesktop.DBus.Properties")
+        .withArguments("org.mpris.MediaPlayer2.TrackList", "Tracks")
+        .storeResultsTo(trackList);
+    auto trackIds = trackList.get<std::vector<sdbus::ObjectPath>>();
+
+    // 用当前曲目的 mpris:trackid 定位，之后的 limit 首即为后续曲目
+    sdbus::Variant metadata;
+    playerProxy->callMethod("Get")
+        .onInterface("org.freedesktop.DBus.Properties")
+        .withArguments("org.mpris.MediaPlayer2.Player", "Metadata")
+        .storeResultsTo(metadata);
+    PlayerMetadata current;
+    parseMetadata(metadata.get<std::map<std::string, sdbus::Variant>>(), current);
+    auto it = std::find(trackIds.begin(), trackIds.end(), current.trackId);
+    if (it == trackIds.end()) {
+      DEBUG("Current track not found in track list: %s", current.trackId.c_str());
+      return tracks;
+    }
+    std::vector<sdbus::ObjectPath> upcoming(
+        it + 1, it + 1 + std::min<ptrdiff_t>(limit, trackIds.end() - it - 1));
+    if (upcoming.empty()) {
+      return tracks;
+    }
+    std::vector<std::map<std::string, sdbus::Variant>> upcomingMetadata;
+    playerProxy->callMethod("GetTracksMetadata")
+        .onInterface("org.mpris.MediaPlayer2.TrackList")
+        .withArguments(upcoming)
+        .storeResultsTo(upcomingMetadata);
+    for (const auto &md : upcomingMetadata) {
+      PlayerMetadata track;
+      parseMetadata(md, track);
+      if (!md.count("xesam:title")) {
+        continue; // 没有标题无法查询歌词
+      }
+      if (!md.count("xesam:artist") && !md.count("xesam:albumArtist")) {
+        track.artist.clear();
+      }
+      track.lyrics.clear();
+      tracks.push_back(std::move(track));
+    }
+  } catch (const sdbus::Error &e) {
+    DEBUG("TrackList not available: %s", e.getMessage().c_str());
+  } catch (const std::exception &e) {
+    DEBUG("TrackList error: %s", e.what());
+  }
+  return tracks;
+}
@@ -0,0 +1,151 @@
+#include "../include/sync_offsets.h"
+#include "../include/track_key.h"
+#include "../include/utils.hpp"
+#include "common.h"
+#include <algorithm>
+#include <ctime>
+#include <fstream>
+#include <vector>
+
+constexpr const char *offsetsMagic = "waylyrics-offsets\t1";
+constexpr size_t offsetsCapacity = 4096; // 最多保存的歌曲偏移数量
+constexpr int64_t offsetLimitMs = 30000; // 偏移绝对值上限
+
+SyncOffsets::SyncOffsets(std::filesystem::path file, int64_t defaultMs)
+    : file_(std::move(file)), defaultMs_(defaultMs) {
+  load();
+}
+
+int64_t SyncOffsets::offsetFor(const std::string &player,
+                               const std::string &trackKey) const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto it = players_.find(player);
+  if (it != players_.end()) {
+    auto track = it->second.find(TrackKey::hashOf(trackKey));
+    if (track != it->second.end()) {
+      return track->second.offsetMs;
+    }
+  }
+  return playerDefaultLocked(player);
+}
+
+int64_t SyncOffsets::adjust(const std::string &player, const std::string &trackKey,
+                            int64_t deltaMs) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto &tracks = players_[player];
+  auto [it, inserted] = tracks.try_emplace(TrackKey::hashOf(trackKey));
+  if (inserted) {
+    it->second.offsetMs = playerDefaultLocked(player);
+  }
+  it->second.offsetMs =
+      std::clamp(it->second.offsetMs + deltaMs, -offsetLimitMs, offsetLimitMs);
+  it->second.lastUsed = static_cast<int64_t>(std::time(nullptr));
+  int64_t offset = it->second.offsetMs;
+  trim();
+  learn(player);
+  save();
+  return offset;
+}
+
+int64_t SyncOffsets::reset(const std::string &player, const std::string &trackKey) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto it = players_.find(player);
+  if (it != players_.end() && it->second.erase(TrackKey::hashOf(trackKey))) {
+    if (it->second.empty()) {
+      players_.erase(it);
+    }
+    learn(player);
+    save();
+  }
+  return playerDefaultLocked(player);
+}
+
+int64_t SyncOffsets::playerDefault(const std::string &player) const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return playerDefaultLocked(player);
+}
+
+int64_t SyncOffsets::playerDefaultLocked(const std::string &player) const {
+  auto it = learned_.find(player);
+  return it == learned_.end() ? defaultMs_ : it->second;
+}
+
+void SyncOffsets::learn(const std::string &player) {
+  auto it = players_.find(player);
+  if (it == players_.end() || it->second.size() < learnMinTracks) {
+    learned_.erase(player);
+    return;
+  }
+  std::vector<int64_t> offsets;
+  offsets.reserve(it->second.size());
+  for (const auto &[_, entry] : it->second) {
+    offsets.push_back(entry.offsetMs);
+  }
+  // 中位数：个别歌词本身时间轴有误的歌曲不会带偏整体
+  auto mid = offsets.begin() + static_cast<std::ptrdiff_t>(offsets.size() / 2);
+  std::nth_element(offsets.begin(), mid, offsets.end());
+  learned_[player] = *mid;
+}
+
+void SyncOffsets::trim() {
+  size_t total = 0;
+  for (const auto &[_, tracks] : players_) {
+    total += tracks.size();
+  }
+  while (total > offsetsCapacity) {
+    std::string oldestPlayer;
+    TrackOffsets::iterator oldest;
+    int64_t oldestTime = INT64_MAX;
+    for (auto &[player, tracks] : players_) {
+      for (auto it = tracks.begin(); it != tracks.end(); ++it) {
+        if (it->second.lastUsed < oldestTime) {
+          oldestTime = it->second.lastUsed;
+          oldestPlayer = player;
+          oldest = it;
+        }
+      }
+    }
+    players_[oldestPlayer].erase(oldest);
+    learn(oldestPlayer);
+    --total;
+  }
+}
+
+void SyncOffsets::load() {
+  std::ifstream file(file_);
+  std::string line;
+  if (!file.is_open() || !std::getline(file, line) || line != offsetsMagic) {
+    return;
+  }
+  size_t count = 0;
+  while (std::getline(file, line)) {
+    auto fields = split(line, "\t");
+    if (fields.size() != 4 || fields[0].empty()) {
+      continue;
+    }
+    Entry entry;
+    entry.offsetMs = std::clamp<int64_t>(std::strtoll(fields[2].c_str(), nullptr, 10),
+                                         -offsetLimitMs, offsetLimitMs);
+    entry.lastUsed = std::strtoll(fields[3].c_str(), nullptr, 10);
+    players_[fields[0]][std::strtoull(fields[1].c_str(), nullptr, 16)] = entry;
+    ++count;
+  }
+  for (const auto &[player, _] : players_) {
+    learn(player);
+  }
+  DEBUG("  >> Sync offsets loaded: %zu tracks, %zu learned player defaults", count,
+        learned_.size());
+}
+
+void SyncOffsets::save() const {
+  std::vector<std::string> rows;
+  char hex[17];
+  for (const auto &[player, tracks] : players_) {
+    for (const auto &[hash, entry] : tracks) {
+      snprintf(hex, sizeof(hex), "%016llx", static_cast<unsigned long long>(hash));
+      rows.push_back(sanitizeField(player) + '\t' + hex + '\t' +
+                     std::to_string(entry.offsetMs) + '\t' + std::to_string(entry.lastUsed));
+    }
+  }
+  writeTsvFile(file_, offsetsMagic, rows, "sync offsets");
+}
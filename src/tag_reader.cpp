@@ -0,0 +1,447 @@
+#include "../include/tag_reader.h"
+#include "../include/display_width.h"
+#include "../include/lyrics_timeline.h"
+#include "../include/mapped_file.h"
+#include "common.h"
+#include <cctype>
+#include <cstdint>
+#include <cstdio>
+#include <strings.h>
+
+// 大端/小端整数读取（调用方保证长度足够）
+static uint32_t readBE32(std::string_view data, size_t pos) {
+  return static_cast<uint32_t>(static_cast<unsigned char>(data[pos])) << 24 |
+         static_cast<uint32_t>(static_cast<unsigned char>(data[pos + 1])) << 16 |
+         static_cast<uint32_t>(static_cast<unsigned char>(data[pos + 2])) << 8 |
+         static_cast<uint32_t>(static_cast<unsigned char>(data[pos + 3]));
+}
+static uint32_t readBE24(std::string_view data, size_t pos) {
+  return static_cast<uint32_t>(static_cast<unsigned char>(data[pos])) << 16 |
+         static_cast<uint32_t>(static_cast<unsigned char>(data[pos + 1])) << 8 |
+         static_cast<uint32_t>(static_cast<unsigned char>(data[pos + 2]));
+}
+static uint32_t readLE32(std::string_view data, size_t pos) {
+  return static_cast<uint32_t>(static_cast<unsigned char>(data[pos])) |
+         static_cast<uint32_t>(static_cast<unsigned char>(data[pos + 1])) << 8 |
+         static_cast<uint32_t>(static_cast<unsigned char>(data[pos + 2])) << 16 |
+         static_cast<uint32_t>(static_cast<unsigned char>(data[pos + 3])) << 24;
+}
+// ID3v2 同步安全整数（每字节 7 位）
+static uint32_t readSyncsafe(std::string_view data, size_t pos) {
+  return (static_cast<uint32_t>(data[pos] & 0x7f) << 21) |
+         (static_cast<uint32_t>(data[pos + 1] & 0x7f) << 14) |
+         (static_cast<uint32_t>(data[pos + 2] & 0x7f) << 7) |
+         static_cast<uint32_t>(data[pos + 3] & 0x7f);
+}
+
+// 带时间戳歌词才有意义（纯文本歌词无法同步显示）
+static bool hasTimedLines(std::string_view text) {
+  return !text.empty() && !parseLrc(text)->empty();
+}
+
+// 毫秒 → "[mm:ss.xx]"
+static std::string formatLrcTime(uint32_t ms) {
+  char buffer[24];
+  snprintf(buffer, sizeof(buffer), "[%02u:%02u.%02u]", ms / 60000,
+           ms / 1000 % 60, ms % 1000 / 10);
+  return buffer;
+}
+
+///////////////////////////////////////////////////////
+// ID3v2
+
+// 按 ID3 文本编码转换为 UTF-8：0 ISO-8859-1, 1 UTF-16(BOM), 2 UTF-16BE, 3 UTF-8
+static std::string decodeId3Text(std::string_view text, int encoding) {
+  std::string out;
+  if (encoding == 3) {
+    out.assign(text);
+  } else if (encoding == 0) {
+    out.reserve(text.size());
+    for (unsigned char c : text) {
+      appendUtf8(out, c);
+    }
+  } else {
+    bool bigEndian = encoding == 2;
+    size_t pos = 0;
+    if (encoding == 1 && text.size() >= 2) {
+      auto b0 = static_cast<unsigned char>(text[0]);
+      auto b1 = static_cast<unsigned char>(text[1]);
+      if ((b0 == 0xfe && b1 == 0xff) || (b0 == 0xff && b1 == 0xfe)) {
+        bigEndian = b0 == 0xfe;
+        pos = 2;
+      }
+    }
+    auto unit = [&](size_t at) -> uint32_t {
+      auto hi = static_cast<unsigned char>(text[bigEndian ? at : at + 1]);
+      auto lo = static_cast<unsigned char>(text[bigEndian ? at + 1 : at]);
+      return static_cast<uint32_t>(hi) << 8 | lo;
+    };
+    out.reserve(text.size());
+    for (; pos + 1 < text.size(); pos += 2) {
+      uint32_t cp = unit(pos);
+      if (cp >= 0xd800 && cp < 0xdc00 && pos + 3 < text.size()) {
+        uint32_t low = unit(pos + 2);
+        if (low >= 0xdc00 && low < 0xe000) {
+          cp = 0x10000 + ((cp - 0xd800) << 10) + (low - 0xdc00);
+          pos += 2;
+        }
+      }
+      appendUtf8(out, cp);
+    }
+  }
+  // SYLT 的每个片段常以换行开头，统一去掉换行和首尾空白
+  size_t begin = out.find_first_not_of(" \t\r\n");
+  size_t end = out.find_last_not_of(" \t\r\n");
+  return begin == std::string::npos ? "" : out.substr(begin, end - begin + 1);
+}
+
+// 读取以 0 结尾的 ID3 字符串（UTF-16 以两个 0 字节结尾且按 2 字节对齐），pos 移到结尾之后
+static std::string_view readId3String(std::string_view data, size_t &pos,
+                                      int encoding) {
+  size_t start = pos;
+  if (encoding == 1 || encoding == 2) {
+    for (; pos + 1 < data.size(); pos += 2) {
+      if (data[pos] == 0 && data[pos + 1] == 0) {
+        std::string_view text = data.substr(start, pos - start);
+        pos += 2;
+        return text;
+      }
+    }
+  } else {
+    size_t end = data.find('\0', pos);
+    if (end != std::string_view::npos) {
+      pos = end + 1;
+      return data.substr(start, end - start);
+    }
+  }
+  pos = data.size();
+  return data.substr(start);
+}
+
+// 去除反同步（0xFF 0x00 → 0xFF）
+static std::string removeUnsync(std::string_view data) {
+  std::string out;
+  out.reserve(data.size());
+  for (size_t i = 0; i < data.size(); ++i) {
+    out += data[i];
+    if (static_cast<unsigned char>(data[i]) == 0xff && i + 1 < data.size() &&
+        data[i + 1] == 0) {
+      ++i;
+    }
+  }
+  return out;
+}
+
+// SYLT：编码(1) 语言(3) 时间格式(1) 内容类型(1) 描述 {文本 时间戳(4)}...
+static std::string parseSylt(std::string_view frame) {
+  if (frame.size() < 6 || frame[4] != 2) {
+    return ""; // 只支持毫秒时间戳（格式 1 为 MPEG 帧号）
+  }
+  int encoding = frame[0];
+  size_t pos = 6;
+  readId3String(frame, pos, encoding); // 跳过描述
+  std::string lrc;
+  while (pos < frame.size()) {
+    std::string_view text = readId3String(frame, pos, encoding);
+    if (pos + 4 > frame.size()) {
+      break;
+    }
+    uint32_t ms = readBE32(frame, pos);
+    pos += 4;
+    lrc += formatLrcTime(ms);
+    lrc += decodeId3Text(text, encoding);
+    lrc += '\n';
+  }
+  return lrc;
+}
+
+// USLT：编码(1) 语言(3) 描述 歌词
+static std::string parseUslt(std::string_view frame) {
+  if (frame.size() < 4) {
+    return "";
+  }
+  int encoding = frame[0];
+  size_t pos = 4;
+  readId3String(frame, pos, encoding);
+  // 歌词内部包含换行，不能像 SYLT 片段那样裁剪，这里只转换编码
+  std::string_view text = frame.substr(pos);
+  return encoding == 3 ? std::string(text) : decodeId3Text(text, encoding);
+}
+
+static EmbeddedLyrics readId3(std::string_view data) {
+  if (data.size() < 10) {
+    return {};
+  }
+  int version = data[3];
+  auto flags = static_cast<unsigned char>(data[5]);
+  size_t tagSize = readSyncsafe(data, 6);
+  if (version < 2 || version > 4 || data.size() < 10 + tagSize) {
+    return {};
+  }
+  std::string_view tag = data.substr(10, tagSize);
+  // ID3v2.3 及更早版本的反同步作用于整个标签
+  std::string unsynced;
+  if ((flags & 0x80) && version < 4) {
+    unsynced = removeUnsync(tag);
+    tag = unsynced;
+  }
+  size_t pos = 0;
+  if ((flags & 0x40) && version >= 3 && tag.size() >= 4) { // 扩展头
+    pos = version == 4 ? readSyncsafe(tag, 0) : readBE32(tag, 0) + 4;
+  }
+  const size_t headerSize = version == 2 ? 6 : 10;
+  std::string sylt, uslt;
+  while (pos + headerSize <= tag.size() && tag[pos] != 0) {
+    std::string_view id = tag.substr(pos, version == 2 ? 3 : 4);
+    size_t size = version == 2   ? readBE24(tag, pos + 3)
+                  : version == 4 ? readSyncsafe(tag, pos + 4)
+                                 : readBE32(tag, pos + 4);
+    uint8_t formatFlags = version == 2 ? 0 : static_cast<uint8_t>(tag[pos + 9]);
+    pos += headerSize;
+    if (size > tag.size() - pos) {
+      break;
+    }
+    std::string_view frame = tag.substr(pos, size);
+    pos += size;
+    // 压缩/加密帧需要额外依赖，直接跳过
+    bool unsupported = version == 3 ? (formatFlags & 0xc0) != 0
+                                    : (formatFlags & 0x0c) != 0;
+    if (unsupported) {
+      continue;
+    }
+    bool isSylt = id == "SYLT" || id == "SLT";
+    bool isUslt = id == "USLT" || id == "ULT";
+    if (!isSylt && !isUslt) {
+      continue;
+    }
+    std::string frameData;
+    if (version == 4 && (formatFlags & 0x01)) { // 数据长度指示符
+      frame.remove_prefix(std::min<size_t>(4, frame.size()));
+    }
+    if (version == 4 && (formatFlags & 0x02)) { // 帧级反同步
+      frameData = removeUnsync(frame);
+      frame = frameData;
+    }
+    if (isSylt && sylt.empty()) {
+      sylt = parseSylt(frame);
+    } else if (isUslt && uslt.empty()) {
+      uslt = parseUslt(frame);
+    }
+  }
+  if (hasTimedLines(sylt)) {
+    return {std::move(sylt), "SYLT"};
+  }
+  if (hasTimedLines(uslt)) {
+    return {std::move(uslt), "USLT"};
+  }
+  return {};
+}
+
+///////////////////////////////////////////////////////
+// Vorbis 注释（FLAC / Ogg）
+
+// 注释块：厂商长度(4LE) 厂商 注释数(4LE) {长度(4LE) "KEY=value"}...
+static EmbeddedLyrics readVorbisComments(std::string_view block) {
+  if (block.size() < 8) {
+    return {};
+  }
+  size_t pos = 4 + static_cast<size_t>(readLE32(block, 0));
+  if (pos + 4 > block.size()) {
+    return {};
+  }
+  uint32_t count = readLE32(block, pos);
+  pos += 4;
+  for (uint32_t i = 0; i < count && pos + 4 <= block.size(); ++i) {
+    size_t length = readLE32(block, pos);
+    pos += 4;
+    if (length > block.size() - pos) {
+      break;
+    }
+    std::string_view comment = block.substr(pos, length);
+    pos += length;
+    size_t eq = comment.find('=');
+    if (eq == std::string_view::npos) {
+      continue;
+    }
+    std::string key(comment.substr(0, eq));
+    if (strcasecmp(key.c_str(), "LYRICS") != 0 &&
+        strcasecmp(key.c_str(), "SYNCEDLYRICS") != 0 &&
+        strcasecmp(key.c_str(), "UNSYNCEDLYRICS") != 0) {
+      continue;
+    }
+    std::string_view value = comment.substr(eq + 1);
+    if (hasTimedLines(value)) {
+      return {std::string(value), "VORBIS"};
+    }
+  }
+  return {};
+}
+
+// FLAC 元数据块：类型(1，最高位为最后一块标记) 长度(3BE)
+static EmbeddedLyrics readFlac(std::string_view data) {
+  size_t pos = 4;
+  while (pos + 4 <= data.size()) {
+    auto header = static_cast<unsigned char>(data[pos]);
+    size_t length = readBE24(data, pos + 1);
+    pos += 4;
+    if (length > data.size() - pos) {
+      break;
+    }
+    if ((header & 0x7f) == 4) { // VORBIS_COMMENT
+      return readVorbisComments(data.substr(pos, length));
+    }
+    if (header & 0x80) {
+      break;
+    }
+    pos += length;
+  }
+  return {};
+}
+
+// Ogg：拼出第一个逻辑流的第二个数据包（注释头），其大小不超过 limit
+static EmbeddedLyrics readOgg(std::string_view data) {
+  constexpr size_t limit = 16 * 1024 * 1024;
+  std::string packet;
+  int packets = 0;
+  size_t pos = 0;
+  uint32_t serial = 0;
+  bool first = true;
+  while (pos + 27 <= data.size() && data.substr(pos, 4) == "OggS") {
+    uint32_t pageSerial = readLE32(data, pos + 14);
+    size_t segments = static_cast<unsigned char>(data[pos + 26]);
+    if (pos + 27 + segments > data.size()) {
+      break;
+    }
+    std::string_view table = data.substr(pos + 27, segments);
+    size_t body = pos + 27 + segments;
+    if (first) {
+      serial = pageSerial;
+      first = false;
+    }
+    for (size_t i = 0; i < segments; ++i) {
+      size_t length = static_cast<unsigned char>(table[i]);
+      if (body + length > data.size()) {
+        return {};
+      }
+      if (pageSerial == serial) {
+        if (packets == 1) {
+          packet.append(data.substr(body, length));
+          if (packet.size() > limit) {
+            return {};
+          }
+        }
+        if (length < 255) { // 小于 255 的段表示数据包结束
+          if (++packets == 2) {
+            std::string_view view = packet;
+            if (view.starts_with("\x03vorbis")) {
+              return readVorbisComments(view.substr(7));
+            }
+            if (view.starts_with("OpusTags")) {
+              return readVorbisComments(view.substr(8));
+            }
+            return {};
+          }
+        }
+      }
+      body += length;
+    }
+    pos = body;
+  }
+  return {};
+}
+
+///////////////////////////////////////////////////////
+// MP4
+
+// 在 [begin, end) 中查找指定类型的子 atom，返回其内容
+static bool findAtom(std::string_view data, size_t begin, size_t end,
+                     std::string_view type, std::string_view &content) {
+  size_t pos = begin;
+  while (pos + 8 <= end) {
+    uint64_t size = readBE32(data, pos);
+    size_t header = 8;
+    if (size == 1) { // 64 位扩展长度
+      if (pos + 16 > end) {
+        return false;
+      }
+      size = static_cast<uint64_t>(readBE32(data, pos + 8)) << 32 |
+             readBE32(data, pos + 12);
+      header = 16;
+    } else if (size == 0) { // 延伸到父容器末尾
+      size = end - pos;
+    }
+    if (size < header || size > end - pos) {
+      return false;
+    }
+    if (data.substr(pos + 4, 4) == type) {
+      content = data.substr(pos + header, size - header);
+      return true;
+    }
+    pos += size;
+  }
+  return false;
+}
+
+static EmbeddedLyrics readMp4(std::string_view data) {
+  std::string_view moov, udta, meta, ilst, lyr, item;
+  if (!findAtom(data, 0, data.size(), "moov", moov)) {
+    return {};
+  }
+  // 之后的查找都在子视图内进行
+  if (!findAtom(moov, 0, moov.size(), "udta", udta) ||
+      !findAtom(udta, 0, udta.size(), "meta", meta)) {
+    return {};
+  }
+  // meta 通常是 full box（4 字节版本/标志），QuickTime 风格的文件则没有
+  size_t metaBegin = meta.size() >= 8 && meta.substr(4, 4) == "hdlr" ? 0 : 4;
+  if (!findAtom(meta, metaBegin, meta.size(), "ilst", ilst) ||
+      !findAtom(ilst, 0, ilst.size(), "\xa9lyr", lyr) ||
+      !findAtom(lyr, 0, lyr.size(), "data", item) || item.size() < 8) {
+    return {};
+  }
+  std::string_view value = item.substr(8); // 跳过类型(4) 和区域(4)
+  if (!hasTimedLines(value)) {
+    return {};
+  }
+  return {std::string(value), "MP4"};
+}
+
+///////////////////////////////////////////////////////
+
+EmbeddedLyrics readEmbeddedLyrics(std::string_view data) {
+  if (data.starts_with("ID3")) {
+    auto result = readId3(data);
+    if (!result.lrc.empty() || data.size() < 10) {
+      return result;
+    }
+    // 带 ID3 头的 FLAC 文件：跳过 ID3 标签继续识别
+    size_t skip = 10 + readSyncsafe(data, 6);
+    if (skip < data.size() && data.substr(skip).starts_with("fLaC")) {
+      return readFlac(data.substr(skip));
+    }
+    return result;
+  }
+  if (data.starts_with("fLaC")) {
+    return readFlac(data);
+  }
+  if (data.starts_with("OggS")) {
+    return readOgg(data);
+  }
+  if (data.size() >= 8 && data.substr(4, 4) == "ftyp") {
+    return readMp4(data);
+  }
+  return {};
+}
+
+EmbeddedLyrics readEmbeddedLyricsFile(const std::string &path) {
+  MappedFile file(path);
+  if (!file.valid()) {
+    return {};
+  }
+  auto result = readEmbeddedLyrics(file.view());
+  if (!result.lrc.empty()) {
+    DEBUG("  >> Embedded lyrics (%s) found: %s", result.source.c_str(),
+          path.c_str());
+  }
+  return result;
+}
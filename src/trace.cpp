@@ -0,0 +1,197 @@
+#include "../include/trace.h"
+#include "common.h"
+#include <chrono>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <nlohmann/json.hpp>
+#include <unistd.h>
+#include <vector>
+
+std::atomic<bool> traceActive{false};
+
+namespace {
+
+constexpr size_t bufferCapacity = 100000; // 每个线程最多保留的事件数
+
+struct TraceEvent {
+  const char *name;
+  char phase;   // 'X' 完整区间，'b'/'e' 异步区间开始/结束
+  double tsUs;  // 开始时间（微秒）
+  double durUs; // 区间耗时（仅 'X'）
+  uint64_t id;  // 异步区间 id（仅 'b'/'e'）
+  std::string arg;
+};
+
+// 单个线程的事件缓冲区：所属线程追加，导出时由导出线程读取（锁只在导出时有竞争）
+struct ThreadBuffer {
+  std::mutex mutex;
+  std::vector<TraceEvent> events;
+  int tid = 0;
+  const char *name = nullptr;
+  uint64_t dropped = 0;
+};
+
+struct TraceState {
+  std::mutex mutex; // 保护 buffers
+  std::vector<std::shared_ptr<ThreadBuffer>> buffers;
+  std::atomic<uint64_t> session{0};
+  std::atomic<uint64_t> nextId{0};
+  std::atomic<int> nextTid{0};
+};
+
+// 不析构：分离线程可能在进程退出时仍持有缓冲区
+TraceState &state() {
+  static TraceState *instance = new TraceState;
+  return *instance;
+}
+
+double nowUs() {
+  static const auto epoch = std::chrono::steady_clock::now();
+  return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - epoch)
+      .count();
+}
+
+thread_local const char *threadName = nullptr;
+// 线程退出后缓冲区仍由 state().buffers 持有，事件保留到导出
+thread_local std::shared_ptr<ThreadBuffer> threadBuffer;
+
+ThreadBuffer &buffer() {
+  if (!threadBuffer) {
+    threadBuffer = std::make_shared<ThreadBuffer>();
+    threadBuffer->tid = ++state().nextTid;
+    threadBuffer->name = threadName;
+    std::lock_guard<std::mutex> lock(state().mutex);
+    state().buffers.push_back(threadBuffer);
+  }
+  return *threadBuffer;
+}
+
+void record(TraceEvent event) {
+  auto &target = buffer();
+  std::lock_guard<std::mutex> lock(target.mutex);
+  if (target.events.size() >= bufferCapacity) {
+    ++target.dropped;
+    return;
+  }
+  target.events.push_back(std::move(event));
+}
+
+} // namespace
+
+void traceStart() {
+  auto &trace = state();
+  {
+    std::lock_guard<std::mutex> lock(trace.mutex);
+    // 丢弃已退出线程的缓冲区，清空其余线程的旧事件
+    std::erase_if(trace.buffers, [](const auto &buffer) { return buffer.use_count() == 1; });
+    for (auto &buffer : trace.buffers) {
+      std::lock_guard<std::mutex> bufferLock(buffer->mutex);
+      buffer->events.clear();
+      buffer->dropped = 0;
+    }
+  }
+  ++trace.session;
+  traceActive.store(true, std::memory_order_relaxed);
+  INFO("  >> Tracing started");
+}
+
+long traceStop(const std::filesystem::path &file) {
+  traceActive.store(false, std::memory_order_relaxed);
+  auto &trace = state();
+  const int pid = static_cast<int>(getpid());
+  nlohmann::json events = nlohmann::json::array();
+  uint64_t dropped = 0;
+  long count = 0;
+  {
+    std::lock_guard<std::mutex> lock(trace.mutex);
+    for (auto &buffer : trace.buffers) {
+      std::lock_guard<std::mutex> bufferLock(buffer->mutex);
+      if (buffer->events.empty()) {
+        continue;
+      }
+      events.push_back({{"name", "thread_name"},
+                        {"ph", "M"},
+                        {"pid", pid},
+                        {"tid", buffer->tid},
+                        {"args", {{"name", buffer->name ? buffer->name : "thread"}}}});
+      for (const auto &event : buffer->events) {
+        nlohmann::json entry = {{"name", event.name},
+                                {"cat", "waylyrics"},
+                                {"ph", std::string(1, event.phase)},
+                                {"ts", event.tsUs},
+                                {"pid", pid},
+                                {"tid", buffer->tid}};
+        if (event.phase == 'X') {
+          entry["dur"] = event.durUs;
+        } else {
+          entry["id"] = event.id;
+        }
+        if (!event.arg.empty()) {
+          entry["args"]["arg"] = event.arg;
+        }
+        events.push_back(std::move(entry));
+        ++count;
+      }
+      dropped += buffer->dropped;
+      buffer->events.clear();
+    }
+  }
+  std::ofstream out(file, std::ios::out | std::ios::trunc);
+  if (!out.is_open()) {
+    WARN("  >> Failed to write trace file: %s", file.c_str());
+    return -1;
+  }
+  // 非法 UTF-8（如播放器给出的残缺标题）替换为 U+FFFD，避免导出失败
+  out << nlohmann::json{{"traceEvents", std::move(events)},
+                        {"displayTimeUnit", "ms"},
+                        {"otherData", {{"dropped", dropped}}}}
+             .dump(-1, ' ', false, nlohmann::json::error_handler_t::replace);
+  INFO("  >> Tracing stopped: %ld events written to %s (%lu dropped)", count,
+       file.c_str(), static_cast<unsigned long>(dropped));
+  return count;
+}
+
+void traceThreadName(const char *name) {
+  if (threadName == name) {
+    return;
+  }
+  threadName = name;
+  if (threadBuffer) {
+    std::lock_guard<std::mutex> lock(threadBuffer->mutex);
+    threadBuffer->name = name;
+  }
+}
+
+uint64_t traceAsyncBegin(const char *name, const std::string &arg) {
+  if (!traceEnabled()) {
+    return 0;
+  }
+  uint64_t id = ++state().nextId;
+  record({name, 'b', nowUs(), 0, id, arg});
+  return id;
+}
+
+void traceAsyncEnd(const char *name, uint64_t id) {
+  if (id == 0 || !traceEnabled()) {
+    return;
+  }
+  record({name, 'e', nowUs(), 0, id, {}});
+}
+
+void TraceSpan::begin(const char *name, const std::string *arg) {
+  name_ = name;
+  session_ = state().session.load(std::memory_order_relaxed);
+  if (arg) {
+    arg_ = *arg;
+  }
+  startUs_ = nowUs();
+}
+
+void TraceSpan::end() {
+  if (!traceEnabled() || state().session.load(std::memory_order_relaxed) != session_) {
+    return;
+  }
+  double endUs = nowUs();
+  record({name_, 'X', startUs_, endUs - startUs_, 0, std::move(arg_)});
+}
@@ -0,0 +1,278 @@
+#include "../include/track_key.h"
+#include "../include/display_width.h"
+#include <algorithm>
+#include <cctype>
+#include <cstdio>
+
+// 单个码点的折叠（简单大小写折叠 + 宽度折叠 + 标点统一），返回 0 表示丢弃
+static uint32_t foldCodepoint(uint32_t cp) {
+  if (cp < 0x80) {
+    return static_cast<uint32_t>(std::tolower(static_cast<int>(cp)));
+  }
+  if (cp >= 0xFF01 && cp <= 0xFF5E) { // 全角 ASCII
+    return foldCodepoint(cp - 0xFEE0);
+  }
+  switch (cp) {
+  case 0x00A0: case 0x3000: // 不换行空格、全角空格
+    return ' ';
+  case 0x200B: case 0x200C: case 0x200D: case 0xFEFF: // 零宽字符
+    return 0;
+  case 0x2018: case 0x2019: case 0x201B: case 0x2032: case 0x00B4:
+    return '\'';
+  case 0x201C: case 0x201D: case 0x201E: case 0x2033:
+    return '"';
+  case 0x2010: case 0x2011: case 0x2012: case 0x2013: case 0x2014:
+  case 0x2015: case 0x2212:
+    return '-';
+  case 0x3010: case 0x3016: // 【 〖
+    return '[';
+  case 0x3011: case 0x3017: // 】 〗
+    return ']';
+  case 0x3014: // 〔
+    return '(';
+  case 0x3015: // 〕
+    return ')';
+  case 0x0178: // Ÿ
+    return 0x00FF;
+  case 0x03C2: // 词尾 ς
+    return 0x03C3;
+  }
+  if ((cp >= 0x00C0 && cp <= 0x00DE && cp != 0x00D7) || // Latin-1
+      (cp >= 0x0391 && cp <= 0x03AB && cp != 0x03A2) || // 希腊字母
+      (cp >= 0x0410 && cp <= 0x042F)) {                 // 西里尔字母
+    return cp + 0x20;
+  }
+  if (cp >= 0x0400 && cp <= 0x040F) {
+    return cp + 0x50;
+  }
+  // Latin Extended-A：大小写成对相邻
+  if ((cp >= 0x0100 && cp <= 0x0137) || (cp >= 0x014A && cp <= 0x0177)) {
+    return cp | 1;
+  }
+  if ((cp >= 0x0139 && cp <= 0x0148) || (cp >= 0x0179 && cp <= 0x017E)) {
+    return (cp & 1) ? cp + 1 : cp;
+  }
+  return cp;
+}
+
+std::string foldText(std::string_view text) {
+  std::string result;
+  result.reserve(text.size());
+  bool space = false;
+  size_t pos = 0;
+  while (pos < text.size()) {
+    uint32_t cp = foldCodepoint(decodeUtf8(text, pos));
+    if (cp == 0) {
+      continue;
+    }
+    if (cp == ' ' || cp == '\t' || cp == '\n' || cp == '\r' || cp == '\f' ||
+        cp == '\v') {
+      space = !result.empty();
+      continue;
+    }
+    if (space) {
+      result += ' ';
+      space = false;
+    }
+    if (cp == 0x00DF) { // ß 的完整折叠
+      result += "ss";
+    } else {
+      appendUtf8(result, cp);
+    }
+  }
+  return result;
+}
+
+// word 在 text 中作为完整的词出现：前后都不是字母或数字（"live" 不匹配 "lively"、"alive"）；
+// 以标点结尾的词（如 "ver."）只检查词首
+static bool containsWord(std::string_view text, std::string_view word) {
+  auto alnum = [](char c) { return std::isalnum(static_cast<unsigned char>(c)) != 0; };
+  for (size_t pos = text.find(word); pos != std::string_view::npos;
+       pos = text.find(word, pos + 1)) {
+    size_t end = pos + word.size();
+    if ((pos == 0 || !alnum(text[pos - 1])) &&
+        (end == text.size() || !alnum(word.back()) || !alnum(text[end]))) {
+      return true;
+    }
+  }
+  return false;
+}
+
+// 判断括号内容或 " - " 之后的部分是否只是装饰（text 已折叠）
+static bool isDecoration(std::string_view text) {
+  // 不同版本的歌词/编曲不同，保留
+  for (std::string_view keep : {"remix", "remixed", "instrumental", "inst.", "acoustic",
+                                "karaoke", "cover", "伴奏"}) {
+    if (containsWord(text, keep)) {
+      return false;
+    }
+  }
+  if (text.size() == 4 && std::all_of(text.begin(), text.end(), [](char c) {
+        return std::isdigit(static_cast<unsigned char>(c));
+      })) {
+    return true; // 年份
+  }
+  if (text.starts_with("from ")) {
+    return true; // 影视原声说明，如 (From "Frozen")
+  }
+  // 单独的 "version" 不算装饰："(10 Minute Version)" "(Taylor's Version)" 是不同的录音
+  for (std::string_view word :
+       {"remaster", "remastered", "live", "album version", "single version", "radio version",
+        "edited version", "ver.", "edit", "mono", "stereo", "explicit", "clean", "deluxe",
+        "bonus", "single", "feat", "ft.", "featuring", "现场"}) {
+    if (containsWord(text, word)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+static void trimTrailing(std::string &text) {
+  while (!text.empty() && (text.back() == ' ' || text.back() == '-')) {
+    text.pop_back();
+  }
+}
+
+std::string canonicalTitle(std::string_view title) {
+  std::string result = foldText(title);
+  // 正文中的 feat. 子句直接截断
+  for (std::string_view feat : {" feat. ", " ft. ", " featuring "}) {
+    size_t pos = result.find(feat);
+    if (pos != std::string::npos && pos > 0) {
+      result.erase(pos);
+    }
+  }
+  // 从尾部反复去除装饰：括号组 "(...)" "[...]" 或 " - ..." 后缀
+  for (bool changed = true; changed && !result.empty();) {
+    changed = false;
+    char close = result.back();
+    if (close == ')' || close == ']') {
+      size_t open = result.rfind(close == ')' ? '(' : '[');
+      if (open != std::string::npos && open > 0 &&
+          isDecoration(std::string_view(result).substr(open + 1, result.size() - open - 2))) {
+        result.erase(open);
+        trimTrailing(result);
+        changed = true;
+        continue;
+      }
+    }
+    size_t dash = result.rfind(" - ");
+    if (dash != std::string::npos && dash > 0 &&
+        isDecoration(std::string_view(result).substr(dash + 3))) {
+      result.erase(dash);
+      trimTrailing(result);
+      changed = true;
+    }
+  }
+  // 全部都是装饰时保留原折叠结果，避免得到空键
+  return result.empty() ? foldText(title) : result;
+}
+
+// 拆分多艺术家（保持原顺序，已折叠）。只按两侧带空格的分隔符和 ; 、 拆分；
+// 逗号、"&" 和不带空格的 "/" 常见于乐队名（"Earth, Wind & Fire"、"Simon & Garfunkel"、
+// "AC/DC"），不拆分
+static std::vector<std::string> splitArtists(std::string_view artist) {
+  std::string folded = foldText(artist);
+  for (std::string_view separator :
+       {" featuring ", " feat. ", " feat ", " ft. ", " ft ", " vs. ", " vs ", " x ", " / ",
+        ";", "、"}) {
+    for (size_t pos = folded.find(separator); pos != std::string::npos;
+         pos = folded.find(separator, pos + 1)) {
+      folded.replace(pos, separator.size(), ";");
+    }
+  }
+  std::vector<std::string> artists;
+  size_t start = 0;
+  while (start <= folded.size()) {
+    size_t end = folded.find(';', start);
+    if (end == std::string::npos) {
+      end = folded.size();
+    }
+    std::string name = folded.substr(start, end - start);
+    size_t first = name.find_first_not_of(' ');
+    size_t last = name.find_last_not_of(' ');
+    if (first != std::string::npos) {
+      artists.push_back(name.substr(first, last - first + 1));
+    }
+    start = end + 1;
+  }
+  return artists;
+}
+
+std::string canonicalArtist(std::string_view artist) {
+  auto artists = splitArtists(artist);
+  std::sort(artists.begin(), artists.end());
+  artists.erase(std::unique(artists.begin(), artists.end()), artists.end());
+  std::string result;
+  for (const auto &name : artists) {
+    if (!result.empty()) {
+      result += ", ";
+    }
+    result += name;
+  }
+  return result;
+}
+
+std::string primaryArtist(std::string_view artist) {
+  auto artists = splitArtists(artist);
+  return artists.empty() ? "" : artists.front();
+}
+
+uint64_t TrackKey::hashOf(std::string_view key) {
+  uint64_t hash = 0xcbf29ce484222325ULL;
+  for (unsigned char c : key) {
+    hash ^= c;
+    hash *= 0x100000001b3ULL;
+  }
+  return hash;
+}
+
+std::filesystem::path TrackKey::cachePath() const {
+  char hex[17];
+  snprintf(hex, sizeof(hex), "%016llx", static_cast<unsigned long long>(hash()));
+  return std::filesystem::path(std::string(hex, 2)) / (std::string(hex) + ".lrc");
+}
+
+// 标题中 "feat. X" 子句里的艺术家并入艺术家列表
+static std::string featuredArtists(std::string_view title) {
+  std::string folded = foldText(title);
+  for (std::string_view feat : {"feat. ", "ft. ", "featuring "}) {
+    size_t pos = folded.find(feat);
+    if (pos == std::string::npos || pos == 0) {
+      continue;
+    }
+    pos += feat.size();
+    size_t end = folded.find_first_of(")]", pos);
+    return folded.substr(pos, end == std::string::npos ? end : end - pos);
+  }
+  return "";
+}
+
+TrackKey makeTrackKey(std::string_view title, std::string_view artist) {
+  std::string featured = featuredArtists(title);
+  return {canonicalTitle(title),
+          canonicalArtist(featured.empty() ? std::string(artist)
+                                           : std::string(artist) + "; " + featured)};
+}
+
+std::vector<QueryVariant> queryVariants(std::string_view title,
+                                        std::string_view artist) {
+  std::vector<QueryVariant> variants;
+  std::vector<std::string> seen; // 按折叠后的内容去重
+  auto add = [&](std::string variantTitle, std::string variantArtist) {
+    if (variantTitle.empty()) {
+      return;
+    }
+    std::string key = foldText(variantTitle) + '\x1f' + foldText(variantArtist);
+    if (std::find(seen.begin(), seen.end(), key) != seen.end()) {
+      return;
+    }
+    seen.push_back(std::move(key));
+    variants.push_back({std::move(variantTitle), std::move(variantArtist)});
+  };
+  std::string cleanTitle = canonicalTitle(title);
+  add(std::string(title), std::string(artist));
+  add(cleanTitle, primaryArtist(artist));
+  add(cleanTitle, "");
+  return variants;
+}
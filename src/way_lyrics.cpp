@@ -1,11 +1,20 @@
 #include "../include/way_lyrics.h"
 #include "../include/utils.hpp"
+#include "../include/dbus_recorder.h"
+#include "../include/display_width.h"
+#include "../include/http_client.h"
+#include "../include/lyrics_library.h"
+#include "../include/lyrics_timeline.h"
+#include "../include/mapped_file.h"
+#include "../include/metrics.h"
+#include "../include/trace.h"
+#include "../include/track_key.h"
 #include "common.h"
 #include "player_manager.h"
 #include <chrono>
 #include <cstddef>
 #include <cstdint>
-#include <curl/curl.h>
+#include <cstdio>
 #include <filesystem>
 #include <fstream>
 #include <gtk/gtk.h>
@@ -14,6 +23,33 @@
 #include <nlohmann/json.hpp>
 #include <string>
 
+namespace {
+// 歌词查询、缓存和界面刷新的指标（首次使用时注册）
+struct PipelineMetrics {
+  Counter &requests = metrics().counter("lyrics.requests");     // 前台查询次数
+  Counter &coalesced = metrics().counter("lyrics.coalesced");   // 合并到进行中查询的请求
+  Counter &fetchErrors = metrics().counter("lyrics.fetch_errors");
+  Counter &notFound = metrics().counter("lyrics.not_found");
+  Counter &stale = metrics().counter("lyrics.stale_results");   // 换歌后到达被丢弃的结果
+  Counter &prefetches = metrics().counter("lyrics.prefetches");
+  Counter &localHits = metrics().counter("lyrics.local_hits");  // 本地来源命中（不经过缓存）
+  Counter &cacheHits = metrics().counter("cache.hits");
+  Counter &cacheMisses = metrics().counter("cache.misses");
+  Counter &cacheWrites = metrics().counter("cache.writes");
+  Counter &cacheWriteErrors = metrics().counter("cache.write_errors");
+  Counter &wakeups = metrics().counter("update.wakeups");       // 刷新线程从条件变量返回的次数（含超时和虚假唤醒）
+  Counter &idleWaits = metrics().counter("update.idle_waits");  // 无定时器的空闲等待次数
+  Counter &rendered = metrics().counter("update.rendered");     // 提交到 GTK 线程的更新
+  Counter &suppressed = metrics().counter("update.suppressed"); // 内容未变化而跳过的更新
+  Histogram &fetchMs = metrics().histogram("lyrics.fetch_ms");  // 查询耗时（含缓存）
+};
+
+PipelineMetrics &pipeline() {
+  static PipelineMetrics instance;
+  return instance;
+}
+} // namespace
+
 void displayState(const PlayerState &state) {
     DEBUG("Current Player State:");
     DEBUG("  Player Name: %s", state.playerName.c_str());
@@ -78,179 +114,539 @@ WayLyrics::WayLyrics(const ConfigParams &params)
   }
   
   DEBUG("  >> Cache directory: %s", cachePath.c_str());
+  traceFile_ = params_.traceFile.empty() ? cachePath / "trace.json"
+                                         : std::filesystem::path(expandHome(params_.traceFile));
+  if (params_.trace && !traceEnabled()) {
+    traceStart();
+  }
+  HttpPolicy policy;
+  policy.connectTimeoutMs = params_.httpConnectTimeout;
+  policy.timeoutMs = params_.httpTimeout;
+  policy.retries = params_.httpRetries;
+  policy.rateLimit = params_.httpRateLimit;
+  policy.breakerThreshold = params_.httpBreakerThreshold;
+  policy.breakerCooldownMs = params_.httpBreakerCooldown * 1000;
+  setHttpPolicy(policy);
+  providers_ = createProviderChain();
+  if (params_.prefetch) {
+    PrefetchOptions options;
+    options.depth = static_cast<size_t>(params_.prefetchDepth);
+    options.lookaheadMs = params_.prefetchLookahead * 1000;
+    options.concurrency = static_cast<size_t>(params_.prefetchConcurrency);
+    prefetcher_ = std::make_unique<LyricsPrefetcher>(
+        [this](const PlayerMetadata &metadata) { prefetchLyrics(metadata); },
+        [this](size_t limit) {
+          return playerManager_ ? playerManager_->getUpcomingTracks(limit)
+                                : std::vector<PlayerMetadata>{};
+        },
+        [this]() {
+          std::lock_guard<std::mutex> lock(fetchMutex_);
+          return activeFetches_ > 0;
+        },
+        cachePath / "history.tsv", options);
+  }
+  offsets_ = std::make_unique<SyncOffsets>(cachePath / "offsets.tsv", params_.offsetDefault);
   // 初始化D-Bus连接和PlayerManager
   auto dbusUniqueConn = sdbus::createSessionBusConnection();
   dbusConn_ = std::shared_ptr<sdbus::IConnection>(dbusUniqueConn.release());
-  playerManager_ = std::make_unique<PlayerManager>(dbusConn_, [this](const PlayerState &state) {
-        DEBUG("  >> PlayerState updated: %s", state.playerName.c_str());
-        currentState_ = state;
-        if(currentState_.metadata.title.empty()) {
-          DEBUG("  >> Title is empty, skipping lyrics query");
-          return;
-        }
-        // 如果标题长度超过限制，则不查询歌词
-        if (currentState_.metadata.title.length() > static_cast<size_t>(params_.lyricsTitleMaxLength)) {
-          DEBUG("  >> Title length exceeds limit, skipping lyrics query for: %s", currentState_.metadata.title.c_str());
-          return;
-        }
-        // 如果音频时长超过限制，则不查询歌词
-        if (currentState_.metadata.length > params_.lyricsMaxDuration * 1000) {
-          DEBUG("  >> Audio duration exceeds limit, skipping lyrics query for: %s , length:%ld s", currentState_.metadata.title.c_str(), currentState_.metadata.length/1000);
-          return;
-        }
-        // 如果歌词为空且状态为播放中，则尝试获取歌词(增加过滤条件：避免浏览器播放视频时获取歌词)
-        if (currentState_.metadata.lyrics.empty() &&
-            currentState_.status == PlaybackStatus::Playing) {
-            INFO("  >> Fetching lyrics for: %s by %s", currentState_.metadata.title.c_str(), currentState_.metadata.artist.c_str());
-            try {
-              currentState_.metadata.lyrics = getLyrics(currentState_.metadata.title, currentState_.metadata.artist);
-              if (currentState_.metadata.lyrics.empty()) {
-                currentState_.metadata.lyrics = getLyrics(currentState_.metadata.title, "");
-              }
-            } catch (const std::exception &e) {
-              WARN("  >> Failed to get lyrics: %s", e.what());
-            }
-        }
-        currentState_.position += 200; // 微调预览歌词的时间
-      });
+  std::shared_ptr<DbusRecorder> recorder;
+  if (!params_.dbusRecord.empty()) {
+    recorder = std::make_shared<DbusRecorder>(expandHome(params_.dbusRecord));
+    if (!recorder->isOpen()) {
+      recorder.reset();
+    }
+  }
+  playerManager_ = std::make_unique<PlayerManager>(
+      dbusConn_, [this](const PlayerState &state) { onPlayerStateChanged(state); },
+      std::move(recorder));
+  if (params_.dbusService) {
+    try {
+      service_ = std::make_unique<LyricsService>(
+          *dbusConn_, [this](const std::string &title, const std::string &artist,
+                             int64_t durationMs) {
+            return lookupLyrics(title, artist, durationMs);
+          });
+    } catch (const sdbus::Error &e) {
+      // 总线名已被占用（如另一个 waybar 实例）时只禁用服务，不影响歌词显示
+      WARN("  >> Failed to export lyrics service: %s", e.getMessage().c_str());
+    }
+  }
 }
 WayLyrics::~WayLyrics() {
   INFO("  >> WayLyrics destroyed");
+  // 预取线程会通过 playerManager_ 读取 TrackList，先停止预取再销毁播放器管理
+  if (prefetcher_) {
+    prefetcher_->stop();
+  }
   playerManager_.reset();
+  prefetcher_.reset();
   stop();
+  service_.reset(); // 等待进行中的 Lookup 结束
+  // 后台查询线程使用来源链和状态成员，必须在成员析构前结束
+  std::unique_lock<std::mutex> lock(fetchMutex_);
+  fetchDone_.wait(lock, [this]() { return activeFetches_ == 0; });
+  if (traceEnabled()) {
+    traceStop(traceFile_);
+  }
 }
-std::string WayLyrics::getLyrics(const std::string &trackName, const std::string &artist="") {
-  std::string trim_query = trackName + " " + artist;
-  trim_query = trim(trim_query);
-  if(trim_query.empty()) {
-    return "";
+// 判断是否需要查询歌词（过滤掉标题过长、时长过长等非歌曲音频）
+bool WayLyrics::wantLyrics(const PlayerMetadata &metadata) const {
+  if(metadata.title.empty()) {
+    DEBUG("  >> Title is empty, skipping lyrics query");
+    return false;
   }
-  std::string url =
-      "https://lrclib.net/api/search?track_name=" + url_encode(trackName);
-
-  // 如果提供了艺术家名称，添加到URL中
-  if(!artist.empty())
-      url += "&artist_name=" + url_encode(artist);
+  // 如果标题长度超过限制，则不查询歌词
+  if (metadata.title.length() > static_cast<size_t>(params_.lyricsTitleMaxLength)) {
+    DEBUG("  >> Title length exceeds limit, skipping lyrics query for: %s", metadata.title.c_str());
+    return false;
+  }
+  // 如果音频时长超过限制，则不查询歌词
+  if (metadata.length > params_.lyricsMaxDuration * 1000) {
+    DEBUG("  >> Audio duration exceeds limit, skipping lyrics query for: %s , length:%ld s", metadata.title.c_str(), metadata.length/1000);
+    return false;
+  }
+  return true;
+}
 
-  std::filesystem::path lyricsCachePath =
-      cachePath / std::string(replace_space(trim_query) + ".txt");
-  std::string content;
+bool WayLyrics::needLyrics(const PlayerState &state) const {
+  // 状态为播放中才尝试获取歌词(增加过滤条件：避免浏览器播放视频时获取歌词)
+  // 播放器自带的歌词（xesam:asText）由来源链中的 player 来源提供
+  return wantLyrics(state.metadata) && state.status == PlaybackStatus::Playing;
+}
 
-  std::string syncedLyrics = "";
-  if (std::filesystem::exists(lyricsCachePath)) {
-    DEBUG("  >> Lyrics found in cache: %s", lyricsCachePath.c_str());
-    std::ifstream file(lyricsCachePath, std::ios::binary);
-    if (!file.is_open()) {
-      ERROR("  >> Failed to open cache file: %s", lyricsCachePath.c_str());
-      return "";
+std::unique_ptr<LyricsProviderChain> WayLyrics::createProviderChain() const {
+  std::vector<std::shared_ptr<LyricsProvider>> providers;
+  std::vector<std::filesystem::path> dirs;
+  for (auto dir : split(params_.lyricsDirs, ",")) {
+    if (!trim(dir).empty()) {
+      dirs.push_back(expandHome(dir));
     }
-    return std::string(std::istreambuf_iterator<char>(file), {});
-  } else {
-    DEBUG("  >> Lyrics not found in cache[%s], fetching from: %s",
-          lyricsCachePath.c_str() , url.c_str());
-    CURL *curl = curl_easy_init();
-    if (curl) {
-      curl_easy_setopt(curl, CURLOPT_URL, url.c_str());
-      curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, WriteCallback);
-      curl_easy_setopt(curl, CURLOPT_WRITEDATA, &content);
-      CURLcode res = curl_easy_perform(curl);
-
-      if (res != CURLE_OK) {
-        ERROR("  >> CURL error: %s", curl_easy_strerror(res));
-        return "";
-      }
-      long http_code = 0;
-      curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &http_code);
-      if (http_code != 200) {
-        ERROR("  >> HTTP error: %ld", http_code);
-        return "";
+  }
+  for (auto name : split(params_.providers, ",")) {
+    trim(name);
+    if (name == "file") {
+      providers.push_back(std::make_shared<SidecarLrcProvider>(dirs));
+    } else if (name == "library") {
+      if (dirs.empty()) {
+        DEBUG("  >> Lyrics provider [library] requires lyrics-dirs, skipped");
+        continue;
       }
-      if (content.empty()) {
-        ERROR("  >> No content received");
-        return "";
+      // 索引在后台线程加载和扫描，不阻塞启动
+      auto library = std::make_shared<LyricsLibrary>(dirs, cachePath / "library.index");
+      library->start();
+      providers.push_back(std::make_shared<LibraryProvider>(std::move(library)));
+    } else if (name == "tags") {
+      providers.push_back(std::make_shared<EmbeddedTagProvider>());
+    } else if (name == "player") {
+      providers.push_back(std::make_shared<PlayerMetadataProvider>());
+    } else if (name == "lrclib") {
+      providers.push_back(std::make_shared<LrclibProvider>(params_.lrclibUrl));
+    } else if (name == "url") {
+      if (params_.lyricsUrl.empty()) {
+        WARN("  >> Lyrics provider [url] requires lyrics-url, skipped");
+        continue;
       }
-      curl_easy_cleanup(curl);
+      providers.push_back(
+          std::make_shared<UrlTemplateProvider>(name, params_.lyricsUrl));
+    } else if (!name.empty()) {
+      WARN("  >> Unknown lyrics provider: %s", name.c_str());
     }
   }
+  if (providers.empty()) {
+    WARN("  >> No lyrics provider configured, lyrics will only come from cache");
+  }
+  return std::make_unique<LyricsProviderChain>(
+      std::move(providers), params_.providerDeadline, params_.providerAdaptive);
+}
 
-  try {
-    auto json = nlohmann::json::parse(content, nullptr, false);
-    if (json.is_discarded())
-      return "";
+// 播放器状态变更回调（D-Bus线程）：校准播放时钟，新歌曲的歌词在后台线程获取，不阻塞 D-Bus 线程
+void WayLyrics::onPlayerStateChanged(const PlayerState &state) {
+  DEBUG("  >> PlayerState updated: %s", state.playerName.c_str());
+  TraceSpan span("onPlayerStateChanged");
+  PlayerState newState = state;
+  // 同一首歌的重复信号（播放/暂停、跳转等）沿用已获取的歌词，不再重新查询
+  std::string key = makeTrackKey(newState.metadata.title, newState.metadata.artist).str();
+  PlayerMetadata query; // 交给来源链的元数据，带播放器自带歌词（xesam:asText）
+  bool fetch = false;
+  {
+    std::lock_guard<std::mutex> lock(stateMutex_);
+    if (key != trackKey_) {
+      // 换歌的异步区间在新歌词首次显示到界面时结束
+      traceId_ = traceAsyncBegin("track-change", newState.metadata.title);
+      trackKey_ = key;
+      lyricsResolved_ = false;
+      lyricsRequested_ = false;
+      timeline_.reset();
+      playerLyrics_ = state.metadata.lyrics;
+      newState.metadata.lyrics.clear();
+    } else {
+      if (!state.metadata.lyrics.empty() && state.metadata.lyrics != playerLyrics_) {
+        // 播放器为同一首歌补发或更新了歌词（如 asText 晚于标题到达），按新歌词重新查询
+        playerLyrics_ = state.metadata.lyrics;
+        lyricsResolved_ = false;
+        lyricsRequested_ = false;
+      }
+      newState.metadata.lyrics = currentState_.metadata.lyrics; // 已解析的歌词
+    }
+    query = newState.metadata;
+    query.lyrics = playerLyrics_;
+    // 当前歌曲已有查询线程时不再重复发起，该线程完成后会更新时间轴
+    fetch = !lyricsResolved_ && !lyricsRequested_ && needLyrics(newState);
+    lyricsRequested_ = lyricsRequested_ || fetch;
+    clock_->reset(newState.position, newState.status == PlaybackStatus::Playing);
+    currentState_ = newState;
+    updatePending_ = true;
+  }
+  updateWake_.notify_one();
+  if (prefetcher_ && !newState.metadata.title.empty()) {
+    prefetcher_->onTrackChanged(newState.metadata);
+    prefetcher_->onPlayback(newState.position, newState.metadata.length,
+                            newState.status == PlaybackStatus::Playing);
+  }
+  if (fetch) {
+    requestLyrics(key, query);
+  }
+}
 
-    auto currentLyrics = json.get<std::vector<nlohmann::json>>();
-    if (currentLyrics.empty())
-      return "";
-    auto &first = currentLyrics[0];
-    if (first.count("syncedLyrics")) {
-      syncedLyrics = first["syncedLyrics"];
-
-      if (!syncedLyrics.empty()) {
-        std::thread([lyricsCachePath, syncedLyrics]() {
-            std::ofstream file(lyricsCachePath,
-                               std::ios::out | std::ios::trunc);
-            if (!file.is_open()) {
-              ERROR("  >> Failed to open cache file for writing: %s",
-                    lyricsCachePath.c_str());
-              return;
-            }
-            file << syncedLyrics;
-            if (file.fail()) {
-              ERROR("  >> Failed to write lyrics to cache file: %s",
-                    lyricsCachePath.c_str());
-              return;
-            }
-            DEBUG("  >> Lyrics cached successfully to: %s", lyricsCachePath.c_str());
-        }).detach();
+void WayLyrics::requestLyrics(const std::string &trackKey,
+                              const PlayerMetadata &metadata) {
+  // 带播放器歌词的查询单独合并：不能共享预取或歌词服务按标题发起的查询结果
+  std::string flightKey = trackKey;
+  if (!metadata.lyrics.empty()) {
+    flightKey += '\n' + std::to_string(std::hash<std::string>{}(metadata.lyrics));
+  }
+  // 同键的预取或歌词服务查询仍在进行时，run() 合并到该查询，并由本线程应用共享的结果
+  if (lyricsFlight_.pending(flightKey)) {
+    DEBUG("  >> Lyrics query already in flight for: %s", metadata.title.c_str());
+    pipeline().coalesced.add();
+  } else {
+    pipeline().requests.add();
+  }
+  {
+    std::lock_guard<std::mutex> lock(fetchMutex_);
+    ++activeFetches_;
+  }
+  std::thread([this, trackKey, flightKey, metadata]() {
+    traceThreadName("fetch");
+    INFO("  >> Fetching lyrics for: %s by %s", metadata.title.c_str(),
+         metadata.artist.c_str());
+    try {
+      TraceSpan span("fetchLyrics", metadata.title);
+      ScopedTimer timer(pipeline().fetchMs);
+      std::string lyrics =
+          lyricsFlight_.run(flightKey, [&]() { return getLyrics(metadata); });
+      if (lyrics.empty()) {
+        pipeline().notFound.add();
       }
-      return syncedLyrics;
-    }else {
-      WARN("  >> No syncedLyrics found in JSON");
-      return "";
-    } 
-  }catch (const std::exception &e) {
-    WARN("Error parsing JSON: %s", e.what());
-    return "";
+      applyLyrics(trackKey, metadata.lyrics, std::move(lyrics), true);
+    } catch (const std::exception &e) {
+      WARN("  >> Failed to get lyrics: %s", e.what());
+      pipeline().fetchErrors.add();
+      // 查询出错，下一次状态变更时重试
+      applyLyrics(trackKey, metadata.lyrics, "", false);
+    }
+    std::lock_guard<std::mutex> lock(fetchMutex_);
+    --activeFetches_;
+    fetchDone_.notify_all();
+  }).detach();
+}
+
+void WayLyrics::prefetchLyrics(const PlayerMetadata &metadata) {
+  if (!wantLyrics(metadata)) {
+    return;
+  }
+  // 结果只写入缓存（由 getLyrics 完成）；与前台查询共用 lyricsFlight_，换歌时若预取仍在进行，
+  // 前台查询合并到预取并自行应用结果
+  std::string key = makeTrackKey(metadata.title, metadata.artist).str();
+  TraceSpan span("prefetchLyrics", metadata.title);
+  pipeline().prefetches.add();
+  lyricsFlight_.run(key, [&]() { return getLyrics(metadata); });
+}
+
+std::string WayLyrics::lookupLyrics(const std::string &title, const std::string &artist,
+                                   int64_t durationMs) {
+  PlayerMetadata metadata;
+  metadata.title = title;
+  metadata.artist = artist;
+  metadata.length = durationMs;
+  std::string key = makeTrackKey(title, artist).str();
+  return lyricsFlight_.run(key, [&]() { return getLyrics(metadata); });
+}
+
+// 歌词查询完成：在锁外解析时间轴，只有仍是同一首歌、且播放器歌词未更新时才替换
+void WayLyrics::applyLyrics(const std::string &trackKey, const std::string &playerLyrics,
+                            std::string lyrics, bool resolved) {
+  TraceSpan span("applyLyrics");
+  std::string player;
+  size_t columns = 0;
+  {
+    std::lock_guard<std::mutex> lock(stateMutex_);
+    player = shortPlayerName(currentState_.playerName);
+    columns = lyricsColumns(currentState_);
   }
-  return "";
-}
-// 静态方法：提取指定时间戳的歌词行
-static std::string getSyncedLine(uint64_t pos, const std::string &syncedLyrics) {
-  auto strVec = split(syncedLyrics, "\n");
-  auto len = strVec.size();
-  DEBUG("  >> getSyncedLine: pos=%ld, len=%ld", pos, len);
-  size_t index = 0;
-  for (size_t i = 0; i < len; i++) {
-    auto &cur = strVec[i];
-    if (cur.empty()) {
-      continue;
+  // 歌词行按格式中剩余的列数预截断；同步偏移在解析时应用
+  auto timeline = parseLrc(lyrics, columns, offsets_->offsetFor(player, trackKey));
+  {
+    std::lock_guard<std::mutex> lock(stateMutex_);
+    if (trackKey != trackKey_ || playerLyrics != playerLyrics_) {
+      DEBUG("  >> Track changed while fetching lyrics, result dropped");
+      pipeline().stale.add();
+      return;
     }
-    uint64_t ms = timestampToMs(cur);
-    if (pos > ms) {
-        index = i;
-    } else {
-      break;
+    lyricsResolved_ = resolved;
+    lyricsRequested_ = false; // 查询出错时允许下一次状态变更重试
+    currentState_.metadata.lyrics = std::move(lyrics);
+    timeline_ = std::move(timeline);
+    updatePending_ = true;
+  }
+  updateWake_.notify_one(); // 歌词到达后立即显示，不等下一次定时刷新
+}
+
+void WayLyrics::adjustOffset(int steps) {
+  std::string player, key;
+  {
+    std::lock_guard<std::mutex> lock(stateMutex_);
+    if (currentState_.metadata.title.empty()) {
+      return;
+    }
+    player = shortPlayerName(currentState_.playerName);
+    key = trackKey_;
+  }
+  int64_t offset = offsets_->adjust(player, key, static_cast<int64_t>(steps) * params_.offsetStep);
+  INFO("  >> Lyrics offset for current track on %s: %+ld ms (player default %+ld ms)",
+       player.c_str(), offset, offsets_->playerDefault(player));
+  rebuildTimeline(key, offset);
+}
+
+void WayLyrics::resetOffset() {
+  std::string player, key;
+  {
+    std::lock_guard<std::mutex> lock(stateMutex_);
+    if (currentState_.metadata.title.empty()) {
+      return;
+    }
+    player = shortPlayerName(currentState_.playerName);
+    key = trackKey_;
+  }
+  int64_t offset = offsets_->reset(player, key);
+  INFO("  >> Lyrics offset for current track on %s reset to %+ld ms", player.c_str(), offset);
+  rebuildTimeline(key, offset);
+}
+
+// 偏移只在时间轴中生效：按新偏移重新解析当前歌词，之后的刷新没有额外开销
+void WayLyrics::rebuildTimeline(const std::string &trackKey, int64_t offsetMs) {
+  std::string lyrics;
+  size_t columns = 0;
+  {
+    std::lock_guard<std::mutex> lock(stateMutex_);
+    if (trackKey != trackKey_ || currentState_.metadata.lyrics.empty()) {
+      return; // 歌词还未到达时不需要重建，applyLyrics 会按新偏移解析
     }
+    lyrics = currentState_.metadata.lyrics;
+    columns = lyricsColumns(currentState_);
+  }
+  auto timeline = parseLrc(lyrics, columns, offsetMs);
+  {
+    std::lock_guard<std::mutex> lock(stateMutex_);
+    if (trackKey != trackKey_) {
+      return; // 解析期间已换歌，新歌曲的时间轴会按它自己的偏移构建
+    }
+    timeline_ = std::move(timeline);
+    updatePending_ = true;
+  }
+  updateWake_.notify_one();
+}
+
+size_t WayLyrics::lyricsColumns(const PlayerState &state) const {
+  if (params_.marquee) {
+    return 0; // 跑马灯模式滚动显示完整歌词
+  }
+  size_t fields = 0;
+  for (const char *name : {"{lyrics}", "{lyrics_tr}", "{lyrics_roma}"}) {
+    fields += params_.format.find(name) != std::string::npos;
   }
-  DEBUG("  >> getSyncedLine: index=%ld, len:%ld , line:[%s]", index, len, index >= len ? "out of size": strVec[index].c_str());
-  if (index >= len) {
+  if (fields == 0) {
+    return 0;
+  }
+  // {elapsed} 不会比 {duration} 宽，{status} 取最宽的 "playing"/"stopped"
+  std::string duration = formatMilliseconds(state.metadata.length);
+  std::string rest = renderFormat(params_.format,
+                                  {{"title", state.metadata.title},
+                                   {"artist", state.metadata.artist},
+                                   {"album", state.metadata.album},
+                                   {"status", "playing"},
+                                   {"elapsed", duration},
+                                   {"duration", duration},
+                                   {"player", shortPlayerName(state.playerName)},
+                                   {"lyrics", ""},
+                                   {"lyrics_tr", ""},
+                                   {"lyrics_roma", ""}});
+  size_t width = displayWidth(rest);
+  size_t maxLength = static_cast<size_t>(params_.maxLength);
+  return width < maxLength ? (maxLength - width) / fields : 0;
+}
+
+void WayLyrics::wakeUpdate() {
+  {
+    std::lock_guard<std::mutex> lock(stateMutex_);
+    updatePending_ = true;
+  }
+  updateWake_.notify_one();
+}
+
+// 旧版缓存文件名为 "<标题>_<艺术家>.txt"，命中时移动到新的哈希路径
+// （标题含 '/' 的旧文件名会越出缓存目录，不做迁移）
+void WayLyrics::migrateLegacyCache(const std::string &query,
+                                   const std::filesystem::path &target) const {
+  if (query.find('/') != std::string::npos) {
+    return;
+  }
+  std::filesystem::path legacy = cachePath / (replace_space(query) + ".txt");
+  std::error_code ec;
+  if (!std::filesystem::is_regular_file(legacy, ec)) {
+    return;
+  }
+  std::filesystem::create_directories(target.parent_path(), ec);
+  std::filesystem::rename(legacy, target, ec);
+  if (ec) {
+    WARN("  >> Failed to migrate cache file %s: %s", legacy.c_str(),
+         ec.message().c_str());
+  } else {
+    DEBUG("  >> Cache file migrated: %s -> %s", legacy.c_str(), target.c_str());
+  }
+}
+
+// 缓存文件开头的 [length:] 标签（写缓存时记录的歌曲时长），没有时返回 0
+static uint64_t cachedLengthMs(std::string_view lrc) {
+  size_t pos = lrc.substr(0, 512).find("[length:");
+  if (pos == std::string_view::npos) {
+    return 0;
+  }
+  pos += 8;
+  size_t end = lrc.find(']', pos);
+  if (end == std::string_view::npos) {
+    return 0;
+  }
+  std::string value(lrc.substr(pos, end - pos));
+  uint64_t ms = 0;
+  return parseLrcTimeTag(trim(value), ms) ? ms : 0;
+}
+
+// 写入缓存的内容：没有 [length:] 标签时在开头记录当前歌曲的时长，命中时用来排除不同版本
+static std::string withLengthTag(const std::string &lyrics, int64_t lengthMs) {
+  if (lengthMs <= 0 || cachedLengthMs(lyrics) != 0) {
+    return lyrics;
+  }
+  char tag[32];
+  snprintf(tag, sizeof(tag), "[length:%02lld:%02lld.%02lld]\n",
+           static_cast<long long>(lengthMs / 60000),
+           static_cast<long long>(lengthMs / 1000 % 60),
+           static_cast<long long>(lengthMs % 1000 / 10));
+  return tag + lyrics;
+}
+
+std::string WayLyrics::getLyrics(const PlayerMetadata &metadata) {
+  std::string trim_query = metadata.title + " " + metadata.artist;
+  trim_query = trim(trim_query);
+  if(trim_query.empty()) {
     return "";
   }
-  auto str = strVec[index];
-  const size_t time_len = 10; // 时间戳长度，例如 "[00:00.00]xxxx"
-  if (str.size() <= time_len) {
+  TraceSpan span("getLyrics", trim_query);
+
+  // 本地来源（歌词文件、播放器自带歌词）优先，不经过缓存，也不访问网络
+  auto result = providers_->fetchLocal(metadata);
+  if (!result.lyrics.empty()) {
+    pipeline().localHits.add();
+    return std::move(result.lyrics);
+  }
+
+  // 缓存按规范化键的哈希分目录存放（大小写、全角、Remastered/Live 等装饰不再产生重复文件）
+  auto key = makeTrackKey(metadata.title, metadata.artist);
+  std::filesystem::path lyricsCachePath = cachePath / "lyrics" / key.cachePath();
+
+  if (!std::filesystem::exists(lyricsCachePath)) {
+    migrateLegacyCache(trim_query, lyricsCachePath);
+  }
+  if (std::filesystem::exists(lyricsCachePath)) {
+    TraceSpan readSpan("cache.read");
+    MappedFile file(lyricsCachePath.string());
+    if (!file.valid()) {
+      ERROR("  >> Failed to open cache file: %s", lyricsCachePath.c_str());
+      return "";
+    }
+    // 规范化键不含时长：缓存记录的时长与当前歌曲相差过大时视为不同版本，重新查询并覆盖
+    uint64_t cachedMs = cachedLengthMs(file.view());
+    uint64_t lengthMs = metadata.length > 0 ? static_cast<uint64_t>(metadata.length) : 0;
+    if (cachedMs == 0 || lengthMs == 0 ||
+        (cachedMs > lengthMs ? cachedMs - lengthMs : lengthMs - cachedMs) <=
+            kTrackLengthToleranceMs) {
+      DEBUG("  >> Lyrics found in cache: %s", lyricsCachePath.c_str());
+      pipeline().cacheHits.add();
+      return std::string(file.view());
+    }
+    DEBUG("  >> Cached lyrics length %llu ms does not match %llu ms: %s",
+          static_cast<unsigned long long>(cachedMs), static_cast<unsigned long long>(lengthMs),
+          lyricsCachePath.c_str());
+  } else {
+    DEBUG("  >> Lyrics not found in cache[%s], querying providers",
+          lyricsCachePath.c_str());
+  }
+  pipeline().cacheMisses.add();
+
+  result = providers_->fetchRemote(metadata);
+  if (result.lyrics.empty() && result.failed) {
+    // 网络不可用或已熔断：只使用缓存，不把本次结果当作“没有歌词”，下次状态变更时重试
+    throw std::runtime_error("lyrics providers unavailable for: " + trim_query);
+  }
+  if (result.lyrics.empty()) {
+    WARN("  >> No syncedLyrics found for: %s", trim_query.c_str());
     return "";
   }
-  str = str.substr(time_len, str.size());
-  return trim(str);
+  if (!result.cacheable) {
+    return std::move(result.lyrics);
+  }
+  std::string syncedLyrics = std::move(result.lyrics);
+  std::thread([lyricsCachePath, cached = withLengthTag(syncedLyrics, metadata.length)]() {
+      traceThreadName("cache-write");
+      TraceSpan span("cache.write");
+      std::error_code ec;
+      std::filesystem::create_directories(lyricsCachePath.parent_path(), ec);
+      std::ofstream file(lyricsCachePath,
+                         std::ios::out | std::ios::trunc);
+      if (!file.is_open()) {
+        ERROR("  >> Failed to open cache file for writing: %s",
+              lyricsCachePath.c_str());
+        pipeline().cacheWriteErrors.add();
+        return;
+      }
+      file << cached;
+      if (file.fail()) {
+        ERROR("  >> Failed to write lyrics to cache file: %s",
+              lyricsCachePath.c_str());
+        pipeline().cacheWriteErrors.add();
+        return;
+      }
+      pipeline().cacheWrites.add();
+      DEBUG("  >> Lyrics cached successfully to: %s", lyricsCachePath.c_str());
+  }).detach();
+  return syncedLyrics;
 }
-// 定义结构体包装三个参数
+// 定义结构体包装标签更新参数
 struct UpdateData {
   GtkLabel *label;
   std::string text;
   std::string status;
+  std::shared_ptr<KaraokeRenderer> karaoke;        // 卡拉OK渲染器（未启用为空）
+  std::shared_ptr<const LyricsTimeline> timeline; // 当前时间轴
+  size_t lineIndex;    // 当前歌词行
+  size_t lyricsOffset; // 歌词在 text 中的字节偏移（npos 表示不含歌词）
+  std::shared_ptr<MarqueeView> marquee; // 跑马灯显示（启用时代替标签）
+  uint64_t lineStartMs; // 当前歌词行显示时间段（用于跑马灯滚动）
+  uint64_t lineEndMs;
+  uint64_t trackLengthMs; // 歌曲时长（卡拉OK最后一行的结束时间）
+  uint64_t traceId;     // 显示后结束的换歌追踪区间（0 表示无）
 };
-static void updateLabelText(GtkLabel *label, const std::string &text,const std::string &playerStatus = "playing") {
+static void updateLabelText(UpdateData *data) {
   
   // 使用 gdk_threads_add_idle 提交到主线程执行
   gdk_threads_add_idle(
@@ -258,9 +654,13 @@ static void updateLabelText(GtkLabel *label, const std::string &text,const std::
     auto *updateData = static_cast<UpdateData *>(data); // 转换为结构体指针
     if (updateData == nullptr)
       return FALSE;
+    traceThreadName("gtk");
+    TraceSpan span("gtk.idle");
 
-    // 检查标签是否存活
-    if (GTK_IS_LABEL(updateData->label)) {
+    // 检查标签是否存活（跑马灯模式下由 MarqueeView 自行跟踪部件生命周期）
+    GtkWidget *widget = updateData->marquee ? updateData->marquee->widget()
+                                            : GTK_WIDGET(updateData->label);
+    if (widget && (updateData->marquee || GTK_IS_LABEL(updateData->label))) {
       // 设置标签文本
       auto content = updateData->text;
       if(updateData->status == "paused") {
@@ -268,115 +668,229 @@ static void updateLabelText(GtkLabel *label, const std::string &text,const std::
       } else if (updateData->status == "stopped" ) {
         content = "[ " + updateData->status + " ]";
       }
-      gtk_label_set_text(updateData->label, content.c_str());
+      if (updateData->marquee) {
+        updateData->marquee->setText(content, updateData->lineStartMs,
+                                     updateData->lineEndMs);
+      } else {
+        gtk_label_set_text(updateData->label, content.c_str());
+      }
       // 添加播放状态对应的 CSS class（如 "playing" 或 "paused"）
-      auto context =
-          gtk_widget_get_style_context(GTK_WIDGET(updateData->label));
+      auto context = gtk_widget_get_style_context(widget);
       // 清理现有 所有class
       for (const auto &class_name : {"playing", "paused", "stopped"}) {
         gtk_style_context_remove_class(context, class_name);
       }
       gtk_style_context_add_class(context, updateData->status.c_str());
+
+      // 文本更新后重新定位卡拉OK高亮（只更新属性，不再改动文本）
+      if (updateData->karaoke) {
+        if (updateData->status == "playing" &&
+            updateData->lyricsOffset != std::string::npos) {
+          updateData->karaoke->setLine(updateData->timeline,
+                                       updateData->lineIndex,
+                                       updateData->lyricsOffset,
+                                       updateData->trackLengthMs);
+        } else {
+          updateData->karaoke->clear();
+        }
+      }
+      traceAsyncEnd("track-change", updateData->traceId);
     }
 
     delete updateData; // 释放动态分配的内存
     return FALSE;
-    }, new UpdateData{label, text, playerStatus}  // 传递结构体实例
+    }, data  // 传递结构体实例
   );
 }
 
-void WayLyrics::start(GtkLabel *label) {
+void WayLyrics::start(GtkLabel *label, GtkWidget *marqueeArea) {
   if (isRunning_)
     return;
   displayLabel_ = label;
   isRunning_ = true;
+  if (marqueeArea) {
+    marquee_ = std::make_shared<MarqueeView>(
+        marqueeArea, clock_, params_.maxLength, params_.marqueeFps);
+  }
+  if (params_.karaoke && label) {
+    karaoke_ = std::make_shared<KaraokeRenderer>(
+        label, clock_, params_.karaokeFps, params_.karaokeColor);
+  }
+  // 动态歌词工具提示：只在悬停查询时从共享时间轴生成
+  GtkWidget *display = marqueeArea ? marqueeArea : GTK_WIDGET(label);
+  if (params_.toggleTooltip && params_.tooltipLines > 0 && display) {
+    tooltip_ = std::make_unique<LyricsTooltip>(
+        display,
+        [this]() {
+          TooltipSnapshot snapshot;
+          std::lock_guard<std::mutex> lock(stateMutex_);
+          snapshot.timeline = timeline_;
+          snapshot.title = currentState_.metadata.title;
+          snapshot.artist = currentState_.metadata.artist;
+          snapshot.position = clock_->positionMs();
+          return snapshot;
+        },
+        params_.tooltipLines, params_.tooltipFormat);
+  }
 
   INFO("  >> Starting update thread");
   updateThread_ = std::thread([this]() {
+    // 上一次提交的显示内容：完全相同时不再提交到 GTK 线程
+    std::string lastContent;
+    std::string lastStatus;
+    size_t lastLineIndex = LyricsTimeline::npos;
+    const LyricsTimeline *lastTimeline = nullptr;
+    uint64_t lastTraceId = 0; // 已结束的换歌追踪区间
+    // 歌词行已按 lyricsColumns 预截断时，整行不会超长，刷新时不必再测量宽度
+    std::string columnsKey;
+    size_t columns = 0;
+    auto metricsInterval = std::chrono::seconds(params_.metricsInterval);
+    auto nextMetricsWrite = std::chrono::steady_clock::now() + metricsInterval;
+    traceThreadName("update");
     while (isRunning_) {
       DEBUG("  >> Update thread started");
+      applyTraceToggle(); // 追踪的开始/导出在刷新线程执行，不在信号或 GTK 回调中做文件读写
+      TraceSpan tick("update.tick");
       std::string lyricsLine = "";
       std::string playerStatus = "playing";
-      std::string realContent = params_.format;
-      static std::string lastText = ""; // 记录上一次的歌词行
+      std::string realContent;
       try {
-        // 解析 format 格式，替换为真实数据并保存到 realContent 中
-        // 替换 可能存在的参数 {title} {artist} {lyrics} {album} {status} {elapsed} {duration} {player}
-        size_t pos;
-
-        // 安全替换 {title}（长度7）
-        if ((pos = realContent.find("{title}")) != std::string::npos) {
-            realContent.replace(pos, 7, currentState_.metadata.title);
-        }
-
-        // 安全替换 {artist}（长度8）
-        if ((pos = realContent.find("{artist}")) != std::string::npos) {
-            realContent.replace(pos, 8, currentState_.metadata.artist);
-        }
-
-        // 安全替换 {album}（长度7）
-        if ((pos = realContent.find("{album}")) != std::string::npos) {
-            realContent.replace(pos, 7, currentState_.metadata.album);
-        }
-
-        // 安全替换 {status}（长度7）
-        if ((pos = realContent.find("{status}")) != std::string::npos) {
-            realContent.replace(pos, 7, playerStatus);
+        // 取当前状态快照，避免与D-Bus线程竞争
+        PlayerState currentState;
+        std::shared_ptr<const LyricsTimeline> timeline;
+        std::string trackKey;
+        uint64_t traceId = 0;
+        {
+          std::lock_guard<std::mutex> lock(stateMutex_);
+          currentState = currentState_;
+          timeline = timeline_;
+          trackKey = trackKey_;
+          traceId = traceId_;
+          updatePending_ = false; // 之后到达的事件会再次唤醒
         }
-
-        // 安全替换 {elapsed}（长度9）
-        if ((pos = realContent.find("{elapsed}")) != std::string::npos) {
-            realContent.replace(pos, 9, formatMilliseconds(currentState_.position));
-        }
-
-        // 安全替换 {duration}（长度10）
-        if ((pos = realContent.find("{duration}")) != std::string::npos) {
-            realContent.replace(pos, 10, formatMilliseconds(currentState_.metadata.length));
-        }
-        // {player} 替换为当前播放器名称,需要处理 currentState_.playerName 前缀和后缀信息(如 org.mpris.MediaPlayer2.firefox.instancexxx 只解析为 firefox) 
-        if((pos = realContent.find("{player}")) != std::string::npos) {
-            std::string playerName = "";
-            // 先判断是否包含 org.mpris.MediaPlayer2.
-            if (currentState_.playerName.find("org.mpris.MediaPlayer2.") != std::string::npos) {
-              // 提取 org.mpris.MediaPlayer2. 后的部分
-              playerName = currentState_.playerName.substr(23);
-              // 找到第一个点的位置
-              size_t dotPos = playerName.find('.');
-              if (dotPos != std::string::npos) {
-                // 提取第一个点之前的部分
-                playerName = playerName.substr(0, dotPos);
-              }
-            } else {
-              playerName = currentState_.playerName;
-            }
-            // 替换 {player}
-            realContent.replace(params_.format.find("{player}"), 8, playerName);
-        }
-
-        if (currentState_.status == PlaybackStatus::Playing) {
+        currentState.position = clock_->positionMs();
+        size_t lineIndex = LyricsTimeline::npos;
+        uint64_t lineStartMs = 0, lineEndMs = 0;
+        std::string translationLine = "";
+        std::string romanizationLine = "";
+        if (currentState.status == PlaybackStatus::Playing) {
           playerStatus = "playing";
-          if (currentState_.metadata.lyrics.empty()) {
+          if (!timeline || timeline->empty()) {
             lyricsLine = "no lyrics...";
           } else {
-            lyricsLine = getSyncedLine(currentState_.position, currentState_.metadata.lyrics);
+            // 原文/翻译/罗马音在解析时已合并，这里只需一次查找
+            lineIndex = timeline->indexAt(currentState.position);
+            const auto &line = timeline->lines[lineIndex];
+            lineStartMs = line.timeMs;
+            lineEndMs = timeline->lineEndMs(lineIndex, currentState.metadata.length);
+            lyricsLine = line.displayText();
+            translationLine = line.displayTranslation();
+            romanizationLine = line.displayRomanization();
           }
-        } else if(currentState_.status == PlaybackStatus::Paused) {
+        } else if(currentState.status == PlaybackStatus::Paused) {
           playerStatus = "paused";
         } else {
           playerStatus = "stopped";
         }
-        // 替换{lyrics}歌词行
-        if((pos = realContent.find("{lyrics}")) != std::string::npos) {
-          realContent.replace(pos, 8, lyricsLine);
+
+        // 解析 format 格式，一次扫描替换所有参数，并记录{lyrics}偏移供卡拉OK高亮定位
+        // 支持参数 {title} {artist} {album} {status} {elapsed} {duration} {player}
+        //          {lyrics} {lyrics_tr} {lyrics_roma}
+        size_t lyricsOffset = std::string::npos;
+        std::string elapsed = formatMilliseconds(currentState.position);
+        std::string duration = formatMilliseconds(currentState.metadata.length);
+        realContent = renderFormat(
+            params_.format,
+            {{"title", currentState.metadata.title},
+             {"artist", currentState.metadata.artist},
+             {"album", currentState.metadata.album},
+             {"status", playerStatus},
+             {"elapsed", elapsed},
+             {"duration", duration},
+             {"player", shortPlayerName(currentState.playerName)},
+             {"lyrics", lyricsLine},
+             {"lyrics_tr", translationLine},
+             {"lyrics_roma", romanizationLine}},
+            "lyrics", &lyricsOffset);
+        if (lineIndex == LyricsTimeline::npos) {
+          lyricsOffset = std::string::npos;
+        }
+        // 歌词行已在解析时按剩余列数截断，整行必然不超长；只有时间轴未按当前格式截断，
+        // 或格式其余部分本身超长（如标题过长）时才整体按列截断。
+        // 跑马灯模式下保留完整文本，由 MarqueeView 滚动显示
+        if (std::string key = trackKey + '\n' + currentState.playerName; key != columnsKey) {
+          columnsKey = std::move(key);
+          columns = lyricsColumns(currentState);
+        }
+        bool fitted = columns > 0 &&
+                      (lineIndex != LyricsTimeline::npos ? timeline->maxColumns == columns
+                                                         : displayWidth(lyricsLine) <= columns);
+        if (!marquee_ && !fitted &&
+            displayWidth(realContent) > static_cast<size_t>(params_.maxLength)) {
+          realContent = truncateColumns(realContent, params_.maxLength);
         }
         
-        // 只有 歌词行 不为空 并且 发生变化时才更新标签(需要更新时间情况下需要每秒钟都更新标签)
-        updateLabelText(displayLabel_, realContent, playerStatus);
-        // 短间隔睡眠并检查 isRunning_，减少退出延迟
-        for (int i = 0; i < params_.updateInterval && isRunning_; ++i) {
-          std::this_thread::sleep_for(std::chrono::seconds(1));
-          if (isRunning_ && currentState_.status == PlaybackStatus::Playing) {
-            currentState_.position += 1000;
+        // 只有显示内容发生变化时才更新标签（格式含 {elapsed} 时每次都会变化）
+        if (realContent == lastContent && playerStatus == lastStatus &&
+            lineIndex == lastLineIndex && timeline.get() == lastTimeline) {
+          pipeline().suppressed.add();
+        } else {
+          pipeline().rendered.add();
+          lastContent = realContent;
+          lastStatus = playerStatus;
+          lastLineIndex = lineIndex;
+          lastTimeline = timeline.get();
+          // 新歌词第一次显示时结束换歌区间
+          if (!timeline || traceId == lastTraceId) {
+            traceId = 0;
+          } else {
+            lastTraceId = traceId;
+          }
+          updateLabelText(new UpdateData{displayLabel_, realContent, playerStatus,
+                                         karaoke_, timeline, lineIndex,
+                                         lyricsOffset, marquee_, lineStartMs,
+                                         lineEndMs, static_cast<uint64_t>(currentState.metadata.length),
+                                         traceId});
+        }
+        if (params_.metricsInterval > 0 &&
+            std::chrono::steady_clock::now() >= nextMetricsWrite) {
+          nextMetricsWrite = std::chrono::steady_clock::now() + metricsInterval;
+          writeMetricsFile();
+        }
+        if (service_) {
+          service_->publish(trackKey, currentState.metadata.title,
+                            currentState.metadata.artist, timeline, currentState.position);
+        }
+        tick.finish();
+        // 导出歌词服务时在下一行开始时唤醒，LineChanged 按行准时发出
+        auto timeout = std::chrono::milliseconds(params_.updateInterval * 1000);
+        if (service_ && lineIndex != LyricsTimeline::npos &&
+            lineIndex + 1 < timeline->lines.size() &&
+            timeline->lines[lineIndex + 1].timeMs >= currentState.position) {
+          timeout = std::min(timeout, std::chrono::milliseconds(
+                                          timeline->lines[lineIndex + 1].timeMs -
+                                          currentState.position + 1));
+        }
+        // 播放时按 interval 定时刷新（播放位置由 clock_ 推算）；暂停、停止或没有播放器时
+        // 显示内容不会自行变化，不设定时器，直到状态变更、歌词到达或 stop() 唤醒
+        std::unique_lock<std::mutex> lock(stateMutex_);
+        auto woken = [this]() { return updatePending_ || !isRunning_ || traceToggle_; };
+        // 不用带谓词的 wait：每次从条件变量返回都计入 update.wakeups，空闲时的任何唤醒都可见
+        if (currentState.status == PlaybackStatus::Playing) {
+          auto deadline = std::chrono::steady_clock::now() + timeout;
+          while (!woken()) {
+            bool timedOut = updateWake_.wait_until(lock, deadline) == std::cv_status::timeout;
+            pipeline().wakeups.add();
+            if (timedOut) {
+              break;
+            }
+          }
+        } else {
+          DEBUG("  >> Player %s, update thread idle", playerStatus.c_str());
+          pipeline().idleWaits.add();
+          while (!woken()) {
+            updateWake_.wait(lock);
+            pipeline().wakeups.add();
           }
         }
       } catch (const std::exception &e) {
@@ -394,6 +908,7 @@ void WayLyrics::start(GtkLabel *label) {
 void WayLyrics::stop() {
   if(!isRunning_) return;
   isRunning_ = false;
+  wakeUpdate(); // 空闲等待中的刷新线程没有超时，需要主动唤醒
   // 主动等待线程退出
   try {
     DEBUG("  >> Waiting for update thread to finish");
@@ -402,6 +917,9 @@ void WayLyrics::stop() {
     }
     DEBUG("  >> Update thread stopped");
     // gdk_threads_add_idle([](gpointer data) { return FALSE; }, nullptr);
+    karaoke_.reset();
+    marquee_.reset();
+    tooltip_.reset();
     displayLabel_ = nullptr;
     INFO("  >> WayLyrics stopped");
   } catch (const std::exception &e) {
@@ -439,4 +957,89 @@ void WayLyrics::prevPlayer() {
 
 std::string WayLyrics::getCurrentPlayer() const {
   return playerManager_->getCurrentPlayerName();
+}
+
+void WayLyrics::toggleTrace() { requestTraceToggle(); }
+
+// 在锁内置位后通知：空闲等待中的刷新线程不会错过唤醒
+void WayLyrics::requestTraceToggle() {
+  {
+    std::lock_guard<std::mutex> lock(stateMutex_);
+    traceToggle_ = true;
+  }
+  updateWake_.notify_one();
+}
+
+void WayLyrics::applyTraceToggle() {
+  if (!traceToggle_.exchange(false)) {
+    return;
+  }
+  if (traceEnabled()) {
+    traceStop(traceFile_);
+  } else {
+    traceStart();
+  }
+}
+
+nlohmann::json WayLyrics::metricsSnapshot() const {
+  static const char *breakerNames[] = {"closed", "open", "half-open"};
+  auto snapshot = metrics().snapshot();
+  for (const auto &stats : providers_->stats()) {
+    snapshot["providers"][stats.name] = {{"calls", stats.calls},
+                                         {"hits", stats.hits},
+                                         {"errors", stats.errors},
+                                         {"latency_ms", stats.latencyMs}};
+  }
+  for (const auto &host : httpHostStats()) {
+    snapshot["http"][host.host] = {
+        {"breaker", breakerNames[static_cast<int>(host.breaker)]},
+        {"requests", host.requests},
+        {"retries", host.retries},
+        {"failures", host.failures},
+        {"rejected", host.rejected},
+        {"throttled_ms", host.throttledMs}};
+  }
+  snapshot["counters"]["lyrics.single_flight_joined"] = lyricsFlight_.joined();
+  snapshot["counters"]["log.dropped"] = logDropped();
+  return snapshot;
+}
+
+void WayLyrics::writeMetricsFile() const {
+  std::filesystem::path file = cachePath / "metrics.json";
+  std::filesystem::path temp = file;
+  temp += ".tmp";
+  {
+    std::ofstream out(temp, std::ios::out | std::ios::trunc);
+    if (!out.is_open()) {
+      WARN("  >> Failed to write metrics snapshot: %s", temp.c_str());
+      return;
+    }
+    out << metricsSnapshot().dump(2) << '\n';
+  }
+  std::error_code ec;
+  std::filesystem::rename(temp, file, ec);
+  if (ec) {
+    WARN("  >> Failed to replace metrics snapshot: %s", ec.message().c_str());
+  }
+}
+
+void WayLyrics::dumpMetrics() const {
+  INFO("  >> metrics:");
+  for (const auto &line : metrics().summary()) {
+    INFO("  >>   %s", line.c_str());
+  }
+  for (const auto &stats : providers_->stats()) {
+    INFO("  >>   provider[%s]: calls=%lu hits=%lu errors=%lu latency=%.1fms",
+         stats.name.c_str(), static_cast<unsigned long>(stats.calls),
+         static_cast<unsigned long>(stats.hits),
+         static_cast<unsigned long>(stats.errors), stats.latencyMs);
+  }
+  for (const auto &host : httpHostStats()) {
+    INFO("  >>   http[%s]: requests=%lu retries=%lu failures=%lu rejected=%lu",
+         host.host.c_str(), static_cast<unsigned long>(host.requests),
+         static_cast<unsigned long>(host.retries),
+         static_cast<unsigned long>(host.failures),
+         static_cast<unsigned long>(host.rejected));
+  }
+  writeMetricsFile();
 }
\ No newline at end of file
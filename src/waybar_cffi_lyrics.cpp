@@ -1,6 +1,8 @@
 #include "../include/way_lyrics.h"
 #include "../include/waybar_cffi_module.h"
 #include "common.h"
+#include <algorithm>
+#include <csignal>
 #include <cstring>
 #include <gtk/gtk.h>
 #include <memory>
@@ -18,14 +20,33 @@ constexpr int defaultUpdateInterval = 1; // 秒
 constexpr int defaultMaxLength = 30;    // 字符
 constexpr int defaultLyricsMaxDuration = 300; // 秒
 constexpr int defaultLyricsTitleMaxLength = 30; // 字符
+constexpr int defaultTooltipLines = 2; // 行
+constexpr int defaultKaraokeFps = 30; // 帧/秒
+constexpr const char *defaultKaraokeColor = "#ffcc00";
+constexpr int defaultMarqueeFps = 30; // 帧/秒
+constexpr int defaultOffset = 200;     // 毫秒，多数播放器报告的位置略落后于实际输出
+constexpr int defaultOffsetStep = 100; // 毫秒
 constexpr const char *loadingText = "加载歌词...";
 constexpr const char *defaultFormat = "{player}/{title} {lyrics}";
+constexpr const char *defaultLrclibUrl = "https://lrclib.net";
+constexpr const char *defaultProviders = "file,library,tags,player,lrclib";
+constexpr int defaultHttpConnectTimeout = 3000; // 毫秒
+constexpr int defaultHttpTimeout = 10000;       // 毫秒
+constexpr int defaultHttpRetries = 2;
+constexpr int defaultHttpRateLimit = 4;         // 请求/秒
+constexpr int defaultHttpBreakerThreshold = 5;  // 连续失败次数
+constexpr int defaultHttpBreakerCooldown = 30;  // 秒
+constexpr int defaultPrefetchDepth = 2;         // 首
+constexpr int defaultPrefetchLookahead = 30;    // 秒
+constexpr int defaultPrefetchConcurrency = 1;
+constexpr int defaultMetricsInterval = 60;      // 秒
 
 // 插件实例结构体（管理生命周期）
 struct Mod {
   void *waybar_module;                  // waybar模块对象
   GtkBox *container;                    // GTK容器
   std::unique_ptr<WayLyrics> wayLyrics; // 歌词显示管理器
+  int traceSignal;                      // 切换追踪的实时信号（SIGRTMIN+N，0 表示不响应）
 };
 
 // 全局实例计数（用于调试）
@@ -42,11 +63,41 @@ static ConfigParams parseConfig(const wbcffi_config_entry *config_entries,
       .cacheDir = std::string(getenv("HOME")) + "/.cache/waylyrics",
       .format = defaultFormat,
       .tooltipFormat = "",
+      .lrclibUrl = defaultLrclibUrl,
       .toggleTooltip = 0, // 默认禁用工具提示
+      .tooltipLines = defaultTooltipLines,
       .updateInterval = defaultUpdateInterval,
      .maxLength = defaultMaxLength,
      .lyricsTitleMaxLength = defaultLyricsTitleMaxLength,
     .lyricsMaxDuration = defaultLyricsMaxDuration,
+    .karaoke = 0, // 默认禁用卡拉OK高亮
+    .karaokeFps = defaultKaraokeFps,
+    .karaokeColor = defaultKaraokeColor,
+    .marquee = 0, // 默认禁用跑马灯
+    .marqueeFps = defaultMarqueeFps,
+    .providers = defaultProviders,
+    .lyricsUrl = "",
+    .lyricsDirs = "",
+    .providerDeadline = 0, // 默认按顺序查询
+    .providerAdaptive = 1, // 默认按耗时和命中率调整顺序
+    .httpConnectTimeout = defaultHttpConnectTimeout,
+    .httpTimeout = defaultHttpTimeout,
+    .httpRetries = defaultHttpRetries,
+    .httpRateLimit = defaultHttpRateLimit,
+    .httpBreakerThreshold = defaultHttpBreakerThreshold,
+    .httpBreakerCooldown = defaultHttpBreakerCooldown,
+    .prefetch = 1, // 默认预取后续曲目的歌词
+    .prefetchDepth = defaultPrefetchDepth,
+    .prefetchLookahead = defaultPrefetchLookahead,
+    .prefetchConcurrency = defaultPrefetchConcurrency,
+    .metricsInterval = defaultMetricsInterval,
+    .trace = 0, // 默认不追踪
+    .traceFile = "",
+    .traceSignal = 0,
+    .dbusRecord = "", // 默认不录制
+    .offsetDefault = defaultOffset,
+    .offsetStep = defaultOffsetStep,
+    .dbusService = 0, // 默认不导出歌词服务
   };
 
   for (size_t i = 0; i < config_entries_len; ++i) {
@@ -70,6 +121,8 @@ static ConfigParams parseConfig(const wbcffi_config_entry *config_entries,
       params.lyricsMaxDuration = std::max(10, atoi(entry.value));
     } else if(strncmp(entry.key, "lyrics-title-max-length", 23) == 0) {
       params.lyricsTitleMaxLength = std::max(10, atoi(entry.value));
+    } else if (strncmp(entry.key, "tooltip-lines", 13) == 0) {
+      params.tooltipLines = std::clamp(atoi(entry.value), 0, 10);
     } else if (strncmp(entry.key, "tooltip-format", 14) == 0) {
       params.tooltipFormat = entry.value;
     } else if (strncmp(entry.key, "tooltip", 7) == 0) {
@@ -77,6 +130,75 @@ static ConfigParams parseConfig(const wbcffi_config_entry *config_entries,
       if (strncmp(entry.value, "true", 4) == 0) {
         params.toggleTooltip = 1;
       }
+    } else if (strncmp(entry.key, "karaoke-fps", 11) == 0) {
+      params.karaokeFps = std::clamp(atoi(entry.value), 1, 60);
+    } else if (strncmp(entry.key, "karaoke-color", 13) == 0) {
+      params.karaokeColor = entry.value;
+    } else if (strncmp(entry.key, "karaoke", 7) == 0) {
+      // value取值： true: 启用卡拉OK逐字高亮, false: 禁用
+      if (strncmp(entry.value, "true", 4) == 0) {
+        params.karaoke = 1;
+      }
+    } else if (strncmp(entry.key, "marquee-fps", 11) == 0) {
+      params.marqueeFps = std::clamp(atoi(entry.value), 1, 60);
+    } else if (strncmp(entry.key, "marquee", 7) == 0) {
+      // value取值： true: 超长歌词滚动显示, false: 超长歌词截断显示
+      if (strncmp(entry.value, "true", 4) == 0) {
+        params.marquee = 1;
+      }
+    } else if (strncmp(entry.key, "lrclib-url", 10) == 0) {
+      params.lrclibUrl = entry.value;
+      while (!params.lrclibUrl.empty() && params.lrclibUrl.back() == '/') {
+        params.lrclibUrl.pop_back(); // 去掉末尾的 '/'
+      }
+    } else if (strncmp(entry.key, "lyrics-dirs", 11) == 0) {
+      params.lyricsDirs = entry.value;
+    } else if (strncmp(entry.key, "lyrics-url", 10) == 0) {
+      params.lyricsUrl = entry.value;
+    } else if (strncmp(entry.key, "provider-deadline", 17) == 0) {
+      params.providerDeadline = std::clamp(atoi(entry.value), 0, 60000);
+    } else if (strncmp(entry.key, "provider-adaptive", 17) == 0) {
+      // value取值： true: 按耗时和命中率调整来源顺序, false: 固定按配置顺序
+      params.providerAdaptive = strncmp(entry.value, "true", 4) == 0 ? 1 : 0;
+    } else if (strncmp(entry.key, "http-connect-timeout", 20) == 0) {
+      params.httpConnectTimeout = std::clamp(atoi(entry.value), 100, 60000);
+    } else if (strncmp(entry.key, "http-timeout", 12) == 0) {
+      params.httpTimeout = std::clamp(atoi(entry.value), 100, 120000);
+    } else if (strncmp(entry.key, "http-retries", 12) == 0) {
+      params.httpRetries = std::clamp(atoi(entry.value), 0, 5);
+    } else if (strncmp(entry.key, "http-rate-limit", 15) == 0) {
+      params.httpRateLimit = std::max(0, atoi(entry.value));
+    } else if (strncmp(entry.key, "http-breaker-threshold", 22) == 0) {
+      params.httpBreakerThreshold = std::max(0, atoi(entry.value));
+    } else if (strncmp(entry.key, "http-breaker-cooldown", 21) == 0) {
+      params.httpBreakerCooldown = std::clamp(atoi(entry.value), 1, 3600);
+    } else if (strncmp(entry.key, "prefetch-depth", 14) == 0) {
+      params.prefetchDepth = std::clamp(atoi(entry.value), 1, 10);
+    } else if (strncmp(entry.key, "prefetch-lookahead", 18) == 0) {
+      params.prefetchLookahead = std::clamp(atoi(entry.value), 0, 600);
+    } else if (strncmp(entry.key, "prefetch-concurrency", 20) == 0) {
+      params.prefetchConcurrency = std::clamp(atoi(entry.value), 1, 4);
+    } else if (strncmp(entry.key, "prefetch", 8) == 0) {
+      params.prefetch = strncmp(entry.value, "true", 4) == 0 ? 1 : 0;
+    } else if (strncmp(entry.key, "metrics-interval", 16) == 0) {
+      params.metricsInterval = std::max(0, atoi(entry.value));
+    } else if (strncmp(entry.key, "trace-file", 10) == 0) {
+      params.traceFile = entry.value;
+    } else if (strncmp(entry.key, "trace-signal", 12) == 0) {
+      params.traceSignal = std::max(0, atoi(entry.value));
+    } else if (strncmp(entry.key, "trace", 5) == 0) {
+      params.trace = strncmp(entry.value, "true", 4) == 0 ? 1 : 0;
+    } else if (strncmp(entry.key, "dbus-record", 11) == 0) {
+      params.dbusRecord = entry.value;
+    } else if (strncmp(entry.key, "offset-default", 14) == 0) {
+      params.offsetDefault = std::clamp(atoi(entry.value), -30000, 30000);
+    } else if (strncmp(entry.key, "offset-step", 11) == 0) {
+      params.offsetStep = std::clamp(atoi(entry.value), 10, 5000);
+    } else if (strncmp(entry.key, "dbus-service", 12) == 0) {
+      // value取值： true: 导出 org.waylyrics 歌词服务, false: 不导出
+      params.dbusService = strncmp(entry.value, "true", 4) == 0 ? 1 : 0;
+    } else if (strncmp(entry.key, "providers", 9) == 0) {
+      params.providers = entry.value;
     } else if (strncmp(entry.key, "log_level", 9) == 0) {
       // 启用调试模式 0-3
       log_level = atoi(entry.value);
@@ -106,6 +228,9 @@ static ConfigParams parseConfig(const wbcffi_config_entry *config_entries,
   if (params.updateInterval <= 0) {
     params.updateInterval = defaultUpdateInterval;
   }
+  if (params.lrclibUrl.empty()) {
+    params.lrclibUrl = defaultLrclibUrl;
+  }
   if (params.cacheDir.empty()) {
     params.cacheDir = std::string(getenv("HOME")) + "/.cache/waylyrics";
   }
@@ -132,6 +257,7 @@ void *wbcffi_init(const wbcffi_init_info *init_info,
     // 初始化
     inst->container = nullptr;
     inst->waybar_module = init_info->obj;
+    inst->traceSignal = configParams.traceSignal;
     try{
       inst->wayLyrics = std::make_unique<WayLyrics>(configParams);
     } catch (const std::exception &e) {
@@ -152,25 +278,29 @@ void *wbcffi_init(const wbcffi_init_info *init_info,
     inst->container = GTK_BOX(gtk_box_new(GTK_ORIENTATION_HORIZONTAL, 5));
     gtk_container_add(GTK_CONTAINER(root), GTK_WIDGET(inst->container));
 
-    GtkLabel *label = GTK_LABEL(gtk_label_new(loadingText));
-    GtkStyleContext *label_context =
-        gtk_widget_get_style_context(GTK_WIDGET(label));
+    // 跑马灯模式使用绘制区域显示歌词，否则使用标签
+    GtkLabel *label = nullptr;
+    GtkWidget *display = nullptr;
+    if (configParams.marquee) {
+      display = gtk_drawing_area_new();
+    } else {
+      label = GTK_LABEL(gtk_label_new(loadingText));
+      display = GTK_WIDGET(label);
+    }
+    GtkStyleContext *label_context = gtk_widget_get_style_context(display);
     gtk_style_context_add_class(label_context,
                                 configParams.cssClass.c_str());    // 应用CSS类
     gtk_style_context_add_class(label_context, "flat module"); // 应用CSS类
-    gtk_widget_set_name(GTK_WIDGET(label),
-                        configParams.labelId.c_str()); // 设置标签ID
-    gtk_container_add(GTK_CONTAINER(inst->container), GTK_WIDGET(label));
-    // 设置标签最大长度(超过部分用...显示)
-    gtk_label_set_max_width_chars(label, configParams.maxLength);
-    gtk_label_set_ellipsize(label, PANGO_ELLIPSIZE_END);
-
-    // 如果启用了工具提示，设置标签工具提示
-    if (configParams.toggleTooltip) {
-      gtk_widget_set_tooltip_text(GTK_WIDGET(label), configParams.tooltipFormat.c_str());
+    gtk_widget_set_name(display, configParams.labelId.c_str()); // 设置标签ID
+    gtk_container_add(GTK_CONTAINER(inst->container), display);
+    // 标签最大长度由歌词解析时预先截断（按显示列宽，CJK占2列），不再让Pango每次测量省略
+
+    // 如果启用了工具提示且不显示歌词上下文，设置静态工具提示（否则由 WayLyrics 动态生成）
+    if (configParams.toggleTooltip && configParams.tooltipLines == 0) {
+      gtk_widget_set_tooltip_text(display, configParams.tooltipFormat.c_str());
     }
 
-    inst->wayLyrics->start(label); // 启动歌词显示
+    inst->wayLyrics->start(label, configParams.marquee ? display : nullptr); // 启动歌词显示
 
     INFO("waylyrics: 实例 %p 初始化完成（总实例数: %d）", inst, ++instance_count);
     return inst;
@@ -211,12 +341,34 @@ void wbcffi_doaction(void *instance, const char *action_name) {
   */
   } else if (action == "shuffle") {
     inst->wayLyrics->playerManager_->setShuffle(!inst->wayLyrics->playerManager_->isShuffle());
+  } else if (action == "stats") {
+    inst->wayLyrics->dumpMetrics();
+  } else if (action == "trace") {
+    inst->wayLyrics->toggleTrace();
+  } else if (action == "offset+") {
+    inst->wayLyrics->adjustOffset(1);
+  } else if (action == "offset-") {
+    inst->wayLyrics->adjustOffset(-1);
+  } else if (action == "offset0") {
+    inst->wayLyrics->resetOffset();
   // }else if(action == "toggleLabel") {
   //   inst->wayLyrics->toggle(); // 切换显示/隐藏状态
   } else {
     DEBUG("waylyrics: 未处理的动作: %s", action_name);
   }
 }
+// waybar信号接口：收到 SIGRTMIN+trace-signal 时切换追踪（如 pkill -RTMIN+8 waybar）
+// waybar 在处理信号的线程中调用（不在异步信号处理函数中），开始/导出的文件读写由刷新线程执行
+void wbcffi_refresh(void *instance, int signal) {
+  if (!instance)
+    return;
+  Mod *inst = static_cast<Mod *>(instance);
+  if (!inst->wayLyrics || inst->traceSignal <= 0 ||
+      signal != SIGRTMIN + inst->traceSignal) {
+    return;
+  }
+  inst->wayLyrics->requestTraceToggle();
+}
 // waybar插件销毁接口（可选，根据需要实现）
 void wbcffi_finish(void *data) {
   if (!data)
@@ -228,5 +380,8 @@ void wbcffi_finish(void *data) {
   gtk_widget_destroy(GTK_WIDGET(inst->container)); // 销毁GTK部件
   delete inst;
   INFO("waylyrics: 实例销毁完成（剩余实例数: %d）", --instance_count);
+  if (instance_count == 0) {
+    logShutdown(); // 插件可能被卸载，输出剩余日志并停止日志线程
+  }
 }
 